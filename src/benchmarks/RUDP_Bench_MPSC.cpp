@@ -0,0 +1,170 @@
+/*
+ *  Reliable UDP implementation
+ *  Copyright (C) 2024  Roy Simanovich
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Send queue contention benchmark.
+ *
+ * Runs a receiver and a sender over loopback in the same process, then lets 1 to 32
+ * producer threads queue messages with sendAsync() on the same socket at once.
+ * For each producer count it reports how fast the producers could queue their messages,
+ * how often they found the queue full, and the end-to-end message rate seen by the receiver.
+ * The receiver also checks that the messages of each producer arrive in order.
+ * With -b, the sender coalesces the small messages into shared packets (send buffering) with the given delay.
+ */
+
+#include "include/RUDP_API.hpp"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+
+#define BENCH_DEFAULT_PORT 12350
+#define BENCH_DEFAULT_MESSAGES 20000
+#define BENCH_DEFAULT_MESSAGE_SIZE 64
+#define BENCH_MAX_PRODUCERS 32
+
+/*
+ * @brief The tag at the start of every message, used to check the per-producer ordering.
+ */
+struct BenchTag
+{
+	uint32_t producer;
+	uint32_t index;
+};
+
+int main(int argc, char **argv)
+{
+	int port = BENCH_DEFAULT_PORT, buffer_delay = -1;
+	uint32_t total_messages = BENCH_DEFAULT_MESSAGES, message_size = BENCH_DEFAULT_MESSAGE_SIZE;
+
+	for (int i = 1; i < argc; i += 2)
+	{
+		// A trailing option has no value to go with it, so it falls through to the usage.
+		const char *option = (i + 1 < argc) ? argv[i] : "";
+
+		if (strcmp(option, "-p") == 0) port = atoi(argv[i + 1]);
+		else if (strcmp(option, "-n") == 0) total_messages = (uint32_t)atoi(argv[i + 1]);
+		else if (strcmp(option, "-s") == 0) message_size = (uint32_t)atoi(argv[i + 1]);
+		else if (strcmp(option, "-b") == 0) buffer_delay = atoi(argv[i + 1]);
+		else
+		{
+			std::cerr << "Usage: " << *argv << " [-p <PORT>] [-n <MESSAGES>] [-s <MESSAGE SIZE>] [-b <SEND BUFFER DELAY (ms)>]" << std::endl;
+			return 1;
+		}
+	}
+
+	if (port < 1 || port > 65535 || total_messages == 0 || message_size < sizeof(BenchTag) || buffer_delay > 65535)
+	{
+		std::cerr << "Invalid arguments." << std::endl;
+		return 1;
+	}
+
+	RUDP_Socket receiver(true, port);
+	RUDP_Socket sender(false, 0);
+
+	std::thread accept_thread([&receiver] { receiver.accept(); });
+
+	if (!sender.connect("127.0.0.1", port))
+	{
+		accept_thread.join();
+		return 1;
+	}
+
+	accept_thread.join();
+
+	if (buffer_delay >= 0)
+	{
+		sender.setSendBuffering(true);
+		sender.setSendBufferDelay((uint16_t)buffer_delay);
+	}
+
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << "Queueing " << total_messages << " messages of " << message_size << " bytes per run";
+	if (buffer_delay >= 0) std::cout << ", with send buffering (" << buffer_delay << " ms delay)";
+	std::cout << "." << std::endl << std::endl;
+	std::cout << std::setw(10) << "producers" << std::setw(18) << "queue (Kmsg/s)" << std::setw(18) << "queue full" << std::setw(20) << "delivered (Kmsg/s)" << std::setw(12) << "ordering" << std::endl;
+
+	for (uint32_t producers = 1; producers <= BENCH_MAX_PRODUCERS; producers *= 2)
+	{
+		uint32_t per_producer = total_messages / producers, expected = per_producer * producers;
+		std::atomic<uint64_t> full_retries{0};
+		std::atomic<bool> ordered{true};
+
+		std::thread receive_thread([&] {
+			std::vector<uint32_t> next_index(producers, 0);
+			std::vector<char> buffer(message_size);
+
+			for (uint32_t i = 0; i < expected; i++)
+			{
+				if (receiver.recv(buffer.data(), buffer.size()) <= 0) break;
+
+				BenchTag tag;
+				memcpy(&tag, buffer.data(), sizeof(tag));
+
+				if (tag.producer >= producers || tag.index != next_index[tag.producer]++) ordered = false;
+			}
+		});
+
+		std::vector<std::thread> threads;
+		auto start = std::chrono::steady_clock::now();
+		std::atomic<int64_t> queue_time_ns{0};
+
+		for (uint32_t p = 0; p < producers; p++)
+		{
+			threads.emplace_back([&, p] {
+				std::vector<char> message(message_size, (char)p);
+				uint64_t retries = 0;
+				auto producer_start = std::chrono::steady_clock::now();
+
+				for (uint32_t i = 0; i < per_producer; i++)
+				{
+					BenchTag tag = { p, i };
+					memcpy(message.data(), &tag, sizeof(tag));
+
+					while (sender.sendAsync(message.data(), message.size()) == 0)
+					{
+						retries++;
+						std::this_thread::yield();
+					}
+				}
+
+				queue_time_ns.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - producer_start).count());
+				full_retries.fetch_add(retries);
+			});
+		}
+
+		for (auto &thread : threads) thread.join();
+		receive_thread.join();
+
+		double total_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		double queue_seconds = (double)queue_time_ns.load() / 1e9 / producers;
+
+		std::cout << std::setw(10) << producers
+				  << std::setw(18) << (expected / queue_seconds / 1000.0)
+				  << std::setw(18) << full_retries.load()
+				  << std::setw(20) << (expected / total_seconds / 1000.0)
+				  << std::setw(12) << (ordered ? "ok" : "BROKEN") << std::endl;
+	}
+
+	sender.disconnect();
+
+	return 0;
+}
@@ -0,0 +1,206 @@
+/*
+ *  Reliable UDP implementation
+ *  Copyright (C) 2024  Roy Simanovich
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Small message latency benchmark.
+ *
+ * Runs a client and an echo server over loopback in the same process. The client sends a message,
+ * waits for the echo and only then sends the next one, so every message is alone on the connection.
+ * For messages of 64 bytes, 512 bytes and 1 KB (or the size given with -s) it reports the round trip
+ * times (min, average, p50, p99, p99.9 and max), the round trips per second and the CPU time the process
+ * spent per round trip (both sides together).
+ * With -c and -C, the client and the server side are each pinned to a CPU: the application thread of the side
+ * and the I/O engine thread of its socket, which inherits the CPU of the thread that connects or accepts.
+ */
+
+#include "include/RUDP_API.hpp"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <ctime>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#define BENCH_DEFAULT_PORT 12351
+#define BENCH_DEFAULT_ROUND_TRIPS 10000
+#define BENCH_WARMUP_ROUND_TRIPS 100
+#define BENCH_MAX_MESSAGE_SIZE (1024 * 1024)
+#define BENCH_NO_CPU -1
+
+/*
+ * @brief Pins the calling thread to a CPU.
+ * @param cpu The CPU, or BENCH_NO_CPU to leave the thread where it is.
+ * @return True if the thread was pinned (or didn't need to be), false otherwise.
+ */
+static bool pin_thread(int cpu) {
+	if (cpu == BENCH_NO_CPU)
+		return true;
+
+#if defined(__linux__)
+	cpu_set_t cpus;
+
+	CPU_ZERO(&cpus);
+	CPU_SET(cpu, &cpus);
+
+	return (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) == 0);
+#else
+	return false;
+#endif
+}
+
+/*
+ * @brief Gets a percentile of sorted latencies (nearest rank).
+ */
+static double percentile(const std::vector<double> &sorted, double fraction) {
+	size_t rank = (size_t)(fraction * sorted.size());
+
+	return sorted[std::min(rank, sorted.size() - 1)];
+}
+
+int main(int argc, char **argv)
+{
+	int port = BENCH_DEFAULT_PORT, client_cpu = BENCH_NO_CPU, server_cpu = BENCH_NO_CPU;
+	uint32_t round_trips = BENCH_DEFAULT_ROUND_TRIPS;
+	std::vector<uint32_t> message_sizes = { 64, 512, 1024 };
+
+	for (int i = 1; i < argc; i += 2)
+	{
+		// Every option takes a value, an option without one matches nothing and gets the usage.
+		const char *option = (i + 1 < argc) ? argv[i] : "";
+
+		if (strcmp(option, "-p") == 0) port = atoi(argv[i + 1]);
+		else if (strcmp(option, "-n") == 0) round_trips = (uint32_t)atoi(argv[i + 1]);
+		else if (strcmp(option, "-s") == 0) message_sizes = { (uint32_t)atoi(argv[i + 1]) };
+		else if (strcmp(option, "-c") == 0) client_cpu = atoi(argv[i + 1]);
+		else if (strcmp(option, "-C") == 0) server_cpu = atoi(argv[i + 1]);
+		else
+		{
+			std::cerr << "Usage: " << *argv << " [-p <PORT>] [-n <ROUND TRIPS>] [-s <MESSAGE SIZE>] [-c <CLIENT CPU>] [-C <SERVER CPU>]" << std::endl;
+			return 1;
+		}
+	}
+
+	if (port < 1 || port > 65535 || round_trips == 0 || message_sizes[0] == 0 || message_sizes[0] > BENCH_MAX_MESSAGE_SIZE || client_cpu < BENCH_NO_CPU || server_cpu < BENCH_NO_CPU ||
+		client_cpu >= (int)std::thread::hardware_concurrency() || server_cpu >= (int)std::thread::hardware_concurrency())
+	{
+		std::cerr << "Invalid arguments." << std::endl;
+		return 1;
+	}
+
+	// Pinned before connecting, so the I/O engine thread of the client socket starts on the same CPU.
+	if (!pin_thread(client_cpu))
+	{
+		std::cerr << "Failed to pin the client to CPU " << client_cpu << "." << std::endl;
+		return 1;
+	}
+
+	RUDP_Socket server(true, port);
+	RUDP_Socket client(false, 0);
+	bool server_pinned = true;
+
+	// The server side runs on this thread from accept() on, so its I/O engine thread starts on the server CPU as well.
+	std::thread server_thread([&server, &server_pinned, server_cpu] {
+		if (!(server_pinned = pin_thread(server_cpu))) return;
+		if (!server.accept()) return;
+
+		// The server echoes every message back until the client disconnects.
+		std::vector<char> buffer(BENCH_MAX_MESSAGE_SIZE);
+		int64_t received = 0;
+
+		while ((received = server.recv(buffer.data(), buffer.size())) > 0) server.send(buffer.data(), (uint64_t)received);
+	});
+
+	if (!client.connect("127.0.0.1", port))
+	{
+		server_thread.join();
+
+		if (!server_pinned) std::cerr << "Failed to pin the server to CPU " << server_cpu << "." << std::endl;
+
+		return 1;
+	}
+
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << "Running " << round_trips << " round trips per message size";
+	if (client_cpu != BENCH_NO_CPU) std::cout << ", client on CPU " << client_cpu;
+	if (server_cpu != BENCH_NO_CPU) std::cout << ", server on CPU " << server_cpu;
+	std::cout << "." << std::endl << std::endl;
+	std::cout << std::setw(8) << "size" << std::setw(12) << "min (us)" << std::setw(12) << "avg (us)" << std::setw(12) << "p50 (us)" << std::setw(12) << "p99 (us)"
+			  << std::setw(14) << "p99.9 (us)" << std::setw(12) << "max (us)" << std::setw(18) << "round trips/s" << std::setw(16) << "CPU (us/rt)" << std::endl;
+
+	for (uint32_t message_size : message_sizes)
+	{
+		std::vector<char> message(message_size, 'x'), reply(message_size);
+		std::vector<double> latencies;
+		latencies.reserve(round_trips);
+
+		for (uint32_t i = 0; i < BENCH_WARMUP_ROUND_TRIPS; i++)
+		{
+			client.send(message.data(), message.size());
+			client.recv(reply.data(), reply.size());
+		}
+
+		std::clock_t cpu_start = std::clock();
+		auto start = std::chrono::steady_clock::now();
+
+		for (uint32_t i = 0; i < round_trips; i++)
+		{
+			auto sent_at = std::chrono::steady_clock::now();
+
+			client.send(message.data(), message.size());
+
+			if (client.recv(reply.data(), reply.size()) != (int64_t)message_size)
+			{
+				std::cerr << "The echo of a " << message_size << " bytes message came back wrong." << std::endl;
+				return 1;
+			}
+
+			latencies.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - sent_at).count());
+		}
+
+		double total_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		double cpu_us = (double)(std::clock() - cpu_start) * 1e6 / CLOCKS_PER_SEC;
+		double average = 0;
+
+		for (double latency : latencies) average += latency;
+		average /= round_trips;
+
+		std::sort(latencies.begin(), latencies.end());
+
+		std::cout << std::setw(8) << message_size
+				  << std::setw(12) << latencies.front()
+				  << std::setw(12) << average
+				  << std::setw(12) << percentile(latencies, 0.5)
+				  << std::setw(12) << percentile(latencies, 0.99)
+				  << std::setw(14) << percentile(latencies, 0.999)
+				  << std::setw(12) << latencies.back()
+				  << std::setw(18) << (round_trips / total_seconds)
+				  << std::setw(16) << (cpu_us / round_trips) << std::endl;
+	}
+
+	client.disconnect();
+	server_thread.join();
+
+	return 0;
+}
@@ -0,0 +1,296 @@
+/*
+ *  Reliable UDP implementation
+ *  Copyright (C) 2024  Roy Simanovich
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Connection scaling benchmark.
+ *
+ * Opens 1, 10, 100, 1000 and 10000 concurrent connections over loopback in the same process and
+ * pushes messages over all of them at once for a fixed time. For each connection count it reports
+ * how fast the connections were accepted, the aggregate goodput, how fairly it was shared between
+ * the connections (Jain's fairness index, 1 is perfectly fair) and the resident memory per connection.
+ * A server socket serves one peer, so every connection has its own server socket, on consecutive ports
+ * from the base port, and the memory per connection covers both of its ends.
+ * The connections are driven by a few worker threads, not one thread per connection.
+ */
+
+#include "include/RUDP_API.hpp"
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <string>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+
+#if defined(__linux__)
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+#define BENCH_DEFAULT_PORT 12353
+#define BENCH_DEFAULT_MAX_CONNECTIONS 10000
+#define BENCH_DEFAULT_SECONDS 2
+#define BENCH_DEFAULT_MESSAGE_SIZE 16384
+#define BENCH_DEFAULT_WORKERS 4
+#define BENCH_MAX_IN_FLIGHT 4
+
+/*
+ * @brief Both ends of a connection, and what went through it.
+ */
+struct BenchConnection
+{
+	std::unique_ptr<RUDP_Socket> server;
+	std::unique_ptr<RUDP_Socket> client;
+	std::atomic<uint64_t> sent{0};
+	std::atomic<uint64_t> consumed{0};
+	uint64_t bytes = 0;
+};
+
+/*
+ * @brief Gets the resident memory of the process, in bytes, or 0 if it isn't known on this platform.
+ */
+static uint64_t resident_memory() {
+#if defined(__linux__)
+	FILE *statm = fopen("/proc/self/statm", "r");
+	unsigned long long size = 0, resident = 0;
+
+	if (statm == nullptr)
+		return 0;
+
+	if (fscanf(statm, "%llu %llu", &size, &resident) != 2)
+		resident = 0;
+
+	fclose(statm);
+
+	return (uint64_t)resident * (uint64_t)sysconf(_SC_PAGESIZE);
+#else
+	return 0;
+#endif
+}
+
+/*
+ * @brief Gets the free physical memory, in bytes, or 0 if it isn't known on this platform.
+ */
+static uint64_t free_memory() {
+#if defined(__linux__)
+	return (uint64_t)sysconf(_SC_AVPHYS_PAGES) * (uint64_t)sysconf(_SC_PAGESIZE);
+#else
+	return 0;
+#endif
+}
+
+int main(int argc, char **argv)
+{
+	int port = BENCH_DEFAULT_PORT;
+	uint32_t max_connections = BENCH_DEFAULT_MAX_CONNECTIONS, seconds = BENCH_DEFAULT_SECONDS, message_size = BENCH_DEFAULT_MESSAGE_SIZE, workers = BENCH_DEFAULT_WORKERS;
+
+	for (int i = 1; i < argc; i += 2)
+	{
+		// Every option takes a value, an option without one matches nothing and gets the usage.
+		const char *option = (i + 1 < argc) ? argv[i] : "";
+
+		if (strcmp(option, "-p") == 0) port = atoi(argv[i + 1]);
+		else if (strcmp(option, "-c") == 0) max_connections = (uint32_t)atoi(argv[i + 1]);
+		else if (strcmp(option, "-t") == 0) seconds = (uint32_t)atoi(argv[i + 1]);
+		else if (strcmp(option, "-s") == 0) message_size = (uint32_t)atoi(argv[i + 1]);
+		else if (strcmp(option, "-w") == 0) workers = (uint32_t)atoi(argv[i + 1]);
+		else
+		{
+			std::cerr << "Usage: " << *argv << " [-p <BASE PORT>] [-c <MAX CONNECTIONS>] [-t <SECONDS PER RUN>] [-s <MESSAGE SIZE>] [-w <WORKER THREADS>]" << std::endl;
+			return 1;
+		}
+	}
+
+	if (port < 1 || max_connections == 0 || (uint64_t)port + max_connections > 65536 || seconds == 0 || message_size == 0 || workers == 0)
+	{
+		std::cerr << "Invalid arguments." << std::endl;
+		return 1;
+	}
+
+#if defined(__linux__)
+	// Two sockets per connection, raise the open files limit as far as allowed.
+	struct rlimit files;
+
+	if (getrlimit(RLIMIT_NOFILE, &files) == 0 && files.rlim_cur < files.rlim_max)
+	{
+		files.rlim_cur = files.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &files);
+	}
+#endif
+
+	std::cout << std::fixed << std::setprecision(2);
+	std::cout << "Sending " << message_size << " bytes messages over all connections for " << seconds << " seconds per run, with " << workers << " worker threads per side." << std::endl << std::endl;
+	std::cout << std::setw(12) << "connections" << std::setw(14) << "accept (c/s)" << std::setw(16) << "goodput (MB/s)" << std::setw(14) << "Jain index"
+			  << std::setw(16) << "min/max (KB)" << std::setw(18) << "memory (KB/conn)" << std::endl;
+
+	double memory_per_connection = 0;
+
+	for (uint32_t count = 1; count <= max_connections; count *= 10)
+	{
+		// Stop before a run that would (going by the last one) not fit in memory, rather than get the process killed.
+		uint64_t available = free_memory();
+
+		if (available != 0 && memory_per_connection * 1024 * count > available * 0.8)
+		{
+			std::cout << std::setw(12) << count << "  skipped, needs about " << (uint64_t)(memory_per_connection * count / 1024) << " MB of the " << (available >> 20) << " MB free." << std::endl;
+			break;
+		}
+
+		std::vector<BenchConnection> connections(count);
+		uint64_t memory_before = resident_memory();
+
+		try
+		{
+			for (uint32_t i = 0; i < count; i++)
+			{
+				connections[i].server.reset(new RUDP_Socket(true, (uint16_t)(port + i)));
+				connections[i].client.reset(new RUDP_Socket(false, 0));
+			}
+		}
+
+		catch (const std::exception &e)
+		{
+			std::cerr << "Failed to open the sockets for " << count << " connections: " << e.what() << std::endl;
+			return 1;
+		}
+
+		// Each worker accepts (or connects) its share of the connections in order, so the two sides pair up.
+		std::vector<std::thread> threads;
+		auto start = std::chrono::steady_clock::now();
+
+		for (uint32_t w = 0; w < workers; w++)
+		{
+			threads.emplace_back([&, w] {
+				for (uint32_t i = w; i < count; i += workers) connections[i].server->accept();
+			});
+
+			threads.emplace_back([&, w] {
+				for (uint32_t i = w; i < count; i += workers)
+				{
+					if (!connections[i].client->connect("127.0.0.1", (uint16_t)(port + i)))
+					{
+						// Its server socket waits in accept() forever, there is no clean way out.
+						std::cerr << "Failed to establish connection " << i << " of " << count << "." << std::endl;
+						std::_Exit(1);
+					}
+				}
+			});
+		}
+
+		for (std::thread &thread : threads) thread.join();
+		threads.clear();
+
+		double accept_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		uint64_t memory_after = resident_memory();
+
+		// Senders keep a few messages in flight on every connection, receivers only read the messages that already arrived, so nothing blocks.
+		std::atomic<bool> receiving{true};
+		auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(seconds);
+
+		for (uint32_t w = 0; w < workers; w++)
+		{
+			threads.emplace_back([&, w] {
+				std::vector<char> message(message_size, 'x');
+
+				while (std::chrono::steady_clock::now() < deadline)
+				{
+					bool progress = false;
+
+					for (uint32_t i = w; i < count; i += workers)
+					{
+						BenchConnection &connection = connections[i];
+
+						if (connection.sent.load(std::memory_order_relaxed) - connection.consumed.load(std::memory_order_relaxed) < BENCH_MAX_IN_FLIGHT &&
+							connection.client->sendAsync(message.data(), message.size()) > 0)
+						{
+							connection.sent.fetch_add(1, std::memory_order_relaxed);
+							progress = true;
+						}
+					}
+
+					if (!progress) std::this_thread::yield();
+				}
+			});
+
+			threads.emplace_back([&, w] {
+				std::vector<char> buffer(message_size);
+
+				while (receiving.load(std::memory_order_relaxed))
+				{
+					bool progress = false;
+					bool counting = (std::chrono::steady_clock::now() < deadline);
+
+					for (uint32_t i = w; i < count; i += workers)
+					{
+						BenchConnection &connection = connections[i];
+						uint64_t consumed = connection.consumed.load(std::memory_order_relaxed);
+						uint64_t arrived = connection.server->getStats().messages_received;
+
+						for (; consumed < arrived; consumed++)
+						{
+							int64_t received = connection.server->recv(buffer.data(), buffer.size());
+
+							if (received > 0 && counting) connection.bytes += (uint64_t)received;
+						}
+
+						if (consumed != connection.consumed.load(std::memory_order_relaxed))
+						{
+							connection.consumed.store(consumed, std::memory_order_relaxed);
+							progress = true;
+						}
+					}
+
+					if (!progress) std::this_thread::yield();
+				}
+			});
+		}
+
+		// The senders stop at the deadline, the receivers right after it, the messages still on their way are not counted.
+		for (uint32_t w = 0; w < workers; w++) threads[w * 2].join();
+
+		receiving.store(false, std::memory_order_relaxed);
+
+		for (uint32_t w = 0; w < workers; w++) threads[w * 2 + 1].join();
+
+		double total = 0, squares = 0, lowest = (double)connections[0].bytes, highest = 0;
+
+		for (const BenchConnection &connection : connections)
+		{
+			total += (double)connection.bytes;
+			squares += (double)connection.bytes * (double)connection.bytes;
+			lowest = std::min(lowest, (double)connection.bytes);
+			highest = std::max(highest, (double)connection.bytes);
+		}
+
+		double jain = (squares > 0) ? (total * total / (count * squares)) : 0;
+		memory_per_connection = (memory_after > memory_before) ? ((double)(memory_after - memory_before) / count / 1024) : 0;
+
+		std::cout << std::setw(12) << count
+				  << std::setw(14) << (count / accept_seconds)
+				  << std::setw(16) << (total / 1e6 / seconds)
+				  << std::setw(14) << std::setprecision(4) << jain << std::setprecision(2)
+				  << std::setw(16) << (std::to_string((uint64_t)(lowest / 1024)) + "/" + std::to_string((uint64_t)(highest / 1024)))
+				  << std::setw(18) << memory_per_connection << std::endl;
+	}
+
+	return 0;
+}
@@ -0,0 +1,466 @@
+/*
+ *  Reliable UDP implementation
+ *  Copyright (C) 2024  Roy Simanovich
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Bulk throughput benchmark.
+ *
+ * Runs a sender and a receiver over loopback in the same process, once for every combination of
+ * message size, MTU, window size, loss rate and one-way delay, and writes one CSV line (or JSON object)
+ * per run with the goodput, the retransmit ratio and the CPU time the process spent on the run.
+ * Loss and delay are added by a UDP relay thread between the two sockets, so no root access or
+ * traffic shaping is needed. The relay drops datagrams in both directions (data and ACKs alike)
+ * with a fixed random seed, so the same arguments give the same loss pattern.
+ * Runs without loss and delay connect the sockets directly.
+ * The results go to the file given with -o, as the library writes its connection messages to the standard output.
+ */
+
+#include "include/RUDP_API.hpp"
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <ctime>
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <winsock2.h>
+#include <ws2tcpip.h>
+typedef SOCKET bench_socket_t;
+#define BENCH_CLOSE_SOCKET closesocket
+#else
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+typedef int bench_socket_t;
+#define BENCH_CLOSE_SOCKET close
+#endif
+
+#define BENCH_DEFAULT_PORT 12352
+#define BENCH_DEFAULT_BYTES (8 * 1024 * 1024)
+#define BENCH_RELAY_BUFFER_SIZE 65536
+#define BENCH_RELAY_SOCKET_BUFFER (4 * 1024 * 1024)
+#define BENCH_RELAY_SEED 1
+
+/*
+ * @brief The parameters of one run.
+ */
+struct BenchRun
+{
+	uint32_t message_size;
+	uint16_t mtu;
+	uint16_t window;
+	double loss;
+	uint32_t delay_ms;
+};
+
+/*
+ * @brief The results of one run.
+ */
+struct BenchResult
+{
+	bool completed;
+	uint64_t bytes;
+	double seconds;
+	double cpu_seconds;
+	uint16_t path_mtu;
+	RUDP_stats stats;
+};
+
+/*
+ * @brief A datagram held back by the relay until its delay is over.
+ */
+struct BenchDatagram
+{
+	std::chrono::steady_clock::time_point release_at;
+	bool to_server;
+	std::vector<char> data;
+};
+
+/*
+ * @brief A UDP relay between the client and the server that drops and delays datagrams.
+ * @note The client connects to the relay, which forwards to the server from a second socket, so the server sees the relay as its peer.
+ */
+class BenchRelay
+{
+private:
+	bench_socket_t m_clientSide;
+	bench_socket_t m_serverSide;
+	sockaddr_in m_serverAddress;
+	double m_loss;
+	std::chrono::microseconds m_delay;
+	std::atomic<bool> m_running{true};
+	std::thread m_thread;
+
+	static bench_socket_t _open() {
+		bench_socket_t sock = socket(AF_INET, SOCK_DGRAM, 0);
+		sockaddr_in address;
+		int buffer_size = BENCH_RELAY_SOCKET_BUFFER;
+
+		memset(&address, 0, sizeof(address));
+		address.sin_family = AF_INET;
+		address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		address.sin_port = 0;
+
+		setsockopt(sock, SOL_SOCKET, SO_RCVBUF, (const char *)&buffer_size, sizeof(buffer_size));
+		setsockopt(sock, SOL_SOCKET, SO_SNDBUF, (const char *)&buffer_size, sizeof(buffer_size));
+
+		if (bind(sock, (sockaddr *)&address, sizeof(address)) != 0)
+			throw std::runtime_error("Failed to bind the relay socket.");
+
+		return sock;
+	}
+
+	void _run() {
+		std::mt19937 random(BENCH_RELAY_SEED);
+		std::uniform_real_distribution<double> chance(0.0, 100.0);
+		std::deque<BenchDatagram> pending;
+		std::vector<char> buffer(BENCH_RELAY_BUFFER_SIZE);
+		sockaddr_in client_address;
+		bool client_known = false;
+
+		while (m_running.load(std::memory_order_relaxed))
+		{
+			auto now = std::chrono::steady_clock::now();
+
+			// The delay is the same for every datagram, so the queue is sorted by release time.
+			while (!pending.empty() && pending.front().release_at <= now)
+			{
+				BenchDatagram &datagram = pending.front();
+
+				if (datagram.to_server)
+					sendto(m_serverSide, datagram.data.data(), (int)datagram.data.size(), 0, (sockaddr *)&m_serverAddress, sizeof(m_serverAddress));
+				else if (client_known)
+					sendto(m_clientSide, datagram.data.data(), (int)datagram.data.size(), 0, (sockaddr *)&client_address, sizeof(client_address));
+
+				pending.pop_front();
+			}
+
+			int64_t wait_us = 10000;
+
+			if (!pending.empty())
+				wait_us = std::min(wait_us, (int64_t)std::chrono::duration_cast<std::chrono::microseconds>(pending.front().release_at - now).count());
+
+			fd_set sockets;
+			timeval timeout = { 0, (long)std::max(wait_us, (int64_t)0) };
+
+			FD_ZERO(&sockets);
+			FD_SET(m_clientSide, &sockets);
+			FD_SET(m_serverSide, &sockets);
+
+			if (select((int)std::max(m_clientSide, m_serverSide) + 1, &sockets, nullptr, nullptr, &timeout) <= 0)
+				continue;
+
+			for (bench_socket_t sock : { m_clientSide, m_serverSide })
+			{
+				if (!FD_ISSET(sock, &sockets))
+					continue;
+
+				sockaddr_in from;
+				socklen_t from_length = sizeof(from);
+				int received = (int)recvfrom(sock, buffer.data(), (int)buffer.size(), 0, (sockaddr *)&from, &from_length);
+
+				if (received <= 0)
+					continue;
+
+				if (sock == m_clientSide)
+				{
+					client_address = from;
+					client_known = true;
+				}
+
+				if (m_loss > 0 && chance(random) < m_loss)
+					continue;
+
+				pending.push_back({ std::chrono::steady_clock::now() + m_delay, sock == m_clientSide, std::vector<char>(buffer.data(), buffer.data() + received) });
+			}
+		}
+	}
+
+public:
+	/*
+	 * @brief Starts a relay to a server on the loopback interface.
+	 * @param server_port The port of the server.
+	 * @param loss The chance of dropping a datagram, in percent.
+	 * @param delay_ms How long each datagram is held back, in milliseconds.
+	 */
+	BenchRelay(uint16_t server_port, double loss, uint32_t delay_ms) : m_loss(loss), m_delay(std::chrono::milliseconds(delay_ms)) {
+		m_clientSide = _open();
+		m_serverSide = _open();
+
+		memset(&m_serverAddress, 0, sizeof(m_serverAddress));
+		m_serverAddress.sin_family = AF_INET;
+		m_serverAddress.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		m_serverAddress.sin_port = htons(server_port);
+
+		m_thread = std::thread(&BenchRelay::_run, this);
+	}
+
+	~BenchRelay() {
+		m_running.store(false, std::memory_order_relaxed);
+		m_thread.join();
+		BENCH_CLOSE_SOCKET(m_clientSide);
+		BENCH_CLOSE_SOCKET(m_serverSide);
+	}
+
+	/*
+	 * @brief Gets the port the client should connect to.
+	 */
+	uint16_t port() const {
+		sockaddr_in address;
+		socklen_t length = sizeof(address);
+
+		getsockname(m_clientSide, (sockaddr *)&address, &length);
+
+		return ntohs(address.sin_port);
+	}
+};
+
+/*
+ * @brief Parses a comma separated list of numbers.
+ */
+template <typename T>
+static bool parse_list(const char *text, std::vector<T> &values) {
+	std::stringstream stream(text);
+	std::string item;
+
+	values.clear();
+
+	while (std::getline(stream, item, ','))
+	{
+		char *end = nullptr;
+		double value = strtod(item.c_str(), &end);
+
+		if (item.empty() || *end != '\0' || value < 0)
+			return false;
+
+		values.push_back((T)value);
+	}
+
+	return !values.empty();
+}
+
+/*
+ * @brief Transfers the bytes of one run and measures it.
+ */
+static BenchResult run_once(const BenchRun &run, uint16_t port, uint64_t total_bytes) {
+	BenchResult result = {};
+	RUDP_Socket server(true, port, run.mtu);
+	RUDP_Socket client(false, 0, run.mtu);
+
+	server.setWindowSize(run.window);
+	client.setWindowSize(run.window);
+
+	// The packet size is the MTU of the run, not whatever path MTU discovery settles on.
+	server.setPathMTUDiscovery(false);
+	client.setPathMTUDiscovery(false);
+
+	// Only bounce through the relay if there is something to impair.
+	bool impaired = (run.loss > 0 || run.delay_ms > 0);
+	std::unique_ptr<BenchRelay> relay(impaired ? new BenchRelay(port, run.loss, run.delay_ms) : nullptr);
+
+	std::thread accept_thread([&server] { server.accept(); });
+
+	if (!client.connect("127.0.0.1", impaired ? relay->port() : port))
+	{
+		accept_thread.join();
+		return result;
+	}
+
+	accept_thread.join();
+
+	uint64_t messages = (total_bytes + run.message_size - 1) / run.message_size;
+	std::atomic<uint64_t> received_bytes{0};
+
+	std::clock_t cpu_start = std::clock();
+	auto start = std::chrono::steady_clock::now();
+
+	std::thread receive_thread([&] {
+		std::vector<char> buffer(run.message_size);
+		uint64_t bytes = 0;
+
+		for (uint64_t i = 0; i < messages; i++)
+		{
+			int64_t received = server.recv(buffer.data(), buffer.size());
+
+			if (received <= 0)
+				break;
+
+			bytes += (uint64_t)received;
+		}
+
+		received_bytes.store(bytes);
+	});
+
+	std::vector<char> message(run.message_size, 'x');
+
+	for (uint64_t i = 0; i < messages && client.isConnected(); i++)
+	{
+		while (client.isConnected() && client.sendAsync(message.data(), message.size()) == 0)
+			std::this_thread::yield();
+	}
+
+	receive_thread.join();
+
+	result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	result.cpu_seconds = (double)(std::clock() - cpu_start) / CLOCKS_PER_SEC;
+	result.bytes = received_bytes.load();
+	result.completed = (result.bytes == messages * run.message_size);
+	result.stats = client.getStats();
+
+	if (client.isConnected()) result.path_mtu = client.getPathMTU();
+
+	client.disconnect();
+
+	return result;
+}
+
+int main(int argc, char **argv)
+{
+	int port = BENCH_DEFAULT_PORT;
+	uint64_t total_bytes = BENCH_DEFAULT_BYTES;
+	bool json = false;
+	const char *output_path = nullptr;
+	std::vector<uint32_t> message_sizes = { 1024, 65536, 1048576 };
+	std::vector<uint16_t> mtus = { RUDP_MTU_DEFAULT, 9000 };
+	std::vector<uint16_t> windows = { 16, RUDP_WINDOW_SIZE_DEFAULT, 256 };
+	std::vector<double> losses = { 0, 1 };
+	std::vector<uint32_t> delays = { 0, 2 };
+
+	for (int i = 1; i < argc; i += 2)
+	{
+		bool valid = true;
+
+		// Every option takes a value, a missing one is as wrong as an unknown option.
+		if (i + 1 >= argc) valid = false;
+		else if (strcmp(argv[i], "-p") == 0) port = atoi(argv[i + 1]);
+		else if (strcmp(argv[i], "-n") == 0) total_bytes = strtoull(argv[i + 1], nullptr, 10);
+		else if (strcmp(argv[i], "-s") == 0) valid = parse_list(argv[i + 1], message_sizes);
+		else if (strcmp(argv[i], "-m") == 0) valid = parse_list(argv[i + 1], mtus);
+		else if (strcmp(argv[i], "-w") == 0) valid = parse_list(argv[i + 1], windows);
+		else if (strcmp(argv[i], "-l") == 0) valid = parse_list(argv[i + 1], losses);
+		else if (strcmp(argv[i], "-d") == 0) valid = parse_list(argv[i + 1], delays);
+		else if (strcmp(argv[i], "-f") == 0)
+		{
+			json = (strcmp(argv[i + 1], "json") == 0);
+			valid = (json || strcmp(argv[i + 1], "csv") == 0);
+		}
+
+		else if (strcmp(argv[i], "-o") == 0) output_path = argv[i + 1];
+		else valid = false;
+
+		if (!valid)
+		{
+			std::cerr << "Usage: " << *argv << " -o <OUTPUT FILE> [-p <PORT>] [-n <BYTES PER RUN>] [-s <MESSAGE SIZES>] [-m <MTUS>] [-w <WINDOW SIZES>] [-l <LOSS RATES (%)>] [-d <DELAYS (ms)>] [-f csv|json]" << std::endl;
+			std::cerr << "Lists are comma separated, for example: -s 1024,65536 -l 0,0.5,2" << std::endl;
+			return 1;
+		}
+	}
+
+	if (output_path == nullptr)
+	{
+		std::cerr << "The output file (-o) is required, the library writes its connection messages to the standard output." << std::endl;
+		return 1;
+	}
+
+	if (port < 1 || port > 65535 || total_bytes == 0 ||
+		std::find(message_sizes.begin(), message_sizes.end(), 0) != message_sizes.end() ||
+		std::find(windows.begin(), windows.end(), 0) != windows.end() ||
+		std::any_of(losses.begin(), losses.end(), [](double loss) { return loss >= 100; }))
+	{
+		std::cerr << "Invalid arguments." << std::endl;
+		return 1;
+	}
+
+	std::ofstream out(output_path);
+
+	if (!out)
+	{
+		std::cerr << "Failed to open " << output_path << "." << std::endl;
+		return 1;
+	}
+	size_t total_runs = message_sizes.size() * mtus.size() * windows.size() * losses.size() * delays.size(), done = 0;
+
+	std::cerr << "Running " << total_runs << " runs of " << total_bytes << " bytes each." << std::endl;
+
+	out << std::fixed << std::setprecision(3);
+
+	if (json) out << "[" << std::endl;
+	else out << "message_size,mtu,window,loss_pct,delay_ms,path_mtu,completed,bytes,seconds,goodput_mbps,packets_sent,retransmits,retransmit_ratio,cpu_seconds,cpu_us_per_mb" << std::endl;
+
+	for (uint32_t message_size : message_sizes)
+	for (uint16_t mtu : mtus)
+	for (uint16_t window : windows)
+	for (double loss : losses)
+	for (uint32_t delay : delays)
+	{
+		BenchRun run = { message_size, mtu, window, loss, delay };
+		BenchResult result;
+
+		try
+		{
+			result = run_once(run, (uint16_t)port, total_bytes);
+		}
+
+		catch (const std::exception &e)
+		{
+			std::cerr << "Run failed: " << e.what() << std::endl;
+			result = {};
+		}
+
+		double goodput = (result.seconds > 0) ? (result.bytes * 8 / 1e6 / result.seconds) : 0;
+		double retransmit_ratio = (result.stats.packets_sent > 0) ? ((double)result.stats.retransmits / result.stats.packets_sent) : 0;
+		double cpu_us_per_mb = (result.bytes > 0) ? (result.cpu_seconds * 1e6 / (result.bytes / 1e6)) : 0;
+
+		if (json)
+		{
+			out << "  {\"message_size\": " << message_size << ", \"mtu\": " << mtu << ", \"window\": " << window
+				<< ", \"loss_pct\": " << loss << ", \"delay_ms\": " << delay << ", \"path_mtu\": " << result.path_mtu << ", \"completed\": " << (result.completed ? "true" : "false")
+				<< ", \"bytes\": " << result.bytes << ", \"seconds\": " << result.seconds << ", \"goodput_mbps\": " << goodput
+				<< ", \"packets_sent\": " << result.stats.packets_sent << ", \"retransmits\": " << result.stats.retransmits
+				<< ", \"retransmit_ratio\": " << retransmit_ratio << ", \"cpu_seconds\": " << result.cpu_seconds
+				<< ", \"cpu_us_per_mb\": " << cpu_us_per_mb << "}" << ((++done < total_runs) ? "," : "") << std::endl;
+		}
+
+		else
+		{
+			out << message_size << "," << mtu << "," << window << "," << loss << "," << delay << "," << result.path_mtu << "," << (result.completed ? 1 : 0) << ","
+				<< result.bytes << "," << result.seconds << "," << goodput << "," << result.stats.packets_sent << "," << result.stats.retransmits << ","
+				<< retransmit_ratio << "," << result.cpu_seconds << "," << cpu_us_per_mb << std::endl;
+			done++;
+		}
+
+		std::cerr << "\r" << done << "/" << total_runs << " runs done" << std::flush;
+	}
+
+	if (json) out << "]" << std::endl;
+
+	std::cerr << std::endl;
+
+	return 0;
+}
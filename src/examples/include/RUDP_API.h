@@ -25,6 +25,7 @@ extern "C"
 
 #include <stdbool.h>
 #include <stdint.h>
+#include "../../include/RUDP_Types.h"
 
 /*
  * @brief The MTU (Maximum Transmission Unit) of the network, default is 1458 bytes.
@@ -41,11 +42,51 @@ extern "C"
  */
 #define RUDP_MAX_RETRIES_DEFAULT 50
 
+/*
+ * @brief The number of packets that can be in flight (sent but not acknowledged yet), default is 64 packets.
+ */
+#define RUDP_WINDOW_SIZE_DEFAULT 64
+
+/*
+ * @brief The number of in-order data packets acknowledged by one ACK, default is 2 packets.
+ */
+#define RUDP_ACK_RATIO_DEFAULT 2
+
+/*
+ * @brief How long an ACK may be held back waiting for more data packets, in microseconds, default is 1000 microseconds.
+ */
+#define RUDP_ACK_DELAY_DEFAULT 1000
+
+/*
+ * @brief How long a small message may wait for more messages to share its packet when send buffering is enabled, default is 5 milliseconds.
+ */
+#define RUDP_SEND_BUFFER_DELAY_DEFAULT 5
+
+/*
+ * @brief The most bytes per second the sender puts on the wire (RUDP headers included), default is 0 (no limit).
+ */
+#define RUDP_MAX_RATE_DEFAULT 0
+
+/*
+ * @brief The most bytes of received messages that may wait for the application before the receiver closes its window, default is 4 MiB.
+ */
+#define RUDP_RECV_WINDOW_DEFAULT (4 * 1024 * 1024)
+
 	/*
 	 * @brief This represents a RUDP socket.
 	 */
 	typedef void *RUDP_socket;
 
+	/*
+	 * @brief A progress callback, called by the I/O engine while a message is sent or received.
+	 * @param sending True for a message being sent, false for a message being received.
+	 * @param bytes_done Number of bytes acknowledged by the peer (sending) or received in order (receiving).
+	 * @param bytes_total Size of the message, or 0 while receiving, as the size is known only once the whole message arrived.
+	 * @param user_data The pointer given when the callback was set.
+	 * @note Called every 1 MiB of progress and once when a message completes, from the I/O engine thread.
+	 */
+	typedef void (*RUDP_progress_callback)(bool sending, uint64_t bytes_done, uint64_t bytes_total, void *user_data);
+
 	/*
 	 * @brief Create a new RUDP socket.
 	 * @param isServer True if the RUDP socket acts like a server, false for client.
@@ -77,26 +118,61 @@ extern "C"
 
 	/*
 	 * @brief Receive data from the connected peer.
+	 * @note Can be called from one thread while another thread is inside rudp_send() on the same socket.
 	 * @param socket The RUDP socket to receive data from.
 	 * @param buffer Buffer to store the received data.
 	 * @param buffer_size Size of the buffer.
-	 * @return Number of bytes received or -1 if an error occurs (also prints an error message).
+	 * @return Number of bytes received, 0 if the peer closed the connection (a message is never empty, see rudp_send()), or -1 if an error occurs (also prints an error message).
 	 */
-	int rudp_recv(RUDP_socket socket, void *buffer, uint32_t buffer_size);
+	int64_t rudp_recv(RUDP_socket socket, void *buffer, uint64_t buffer_size);
 
 	/*
 	 * @brief Send data to the connected peer.
+	 * @note Can be called from several threads at once, and while another thread is inside rudp_recv() on the same socket.
 	 * @param socket The RUDP socket to send data to.
 	 * @param buffer Buffer containing the data to be sent.
 	 * @param buffer_size Size of the buffer.
 	 * @return Number of bytes sent or -1 if an error occurs (also prints an error message).
+	 * @note An empty buffer is an error, so rudp_recv() returns 0 only once the connection is closed.
+	 */
+	int64_t rudp_send(RUDP_socket socket, void *buffer, uint64_t buffer_size);
+
+	/*
+	 * @brief Queue data to be sent to the connected peer, without waiting for the network.
+	 * @param socket The RUDP socket to send data to.
+	 * @param buffer Buffer containing the data to be sent, copied before the call returns.
+	 * @param buffer_size Size of the buffer.
+	 * @return Number of bytes queued, 0 if the send queue is full (try again later), or -1 if an error occurs (also prints an error message).
+	 * @note Lock-free: any number of threads can queue messages on the same socket at once, messages from the same thread are sent in order.
+	 * @note rudp_disconnect() waits for the queued messages, and reports the ones it couldn't deliver.
+	 */
+	int64_t rudp_send_async(RUDP_socket socket, const void *buffer, uint64_t buffer_size);
+
+	/*
+	 * @brief Hold back small messages until rudp_uncork() or rudp_flush(), so they share packets.
+	 * @param socket The RUDP socket.
+	 * @note Full packets are still sent, and a message never waits longer than the send buffer delay (if not 0).
 	 */
-	int rudp_send(RUDP_socket socket, void *buffer, uint32_t buffer_size);
+	void rudp_cork(RUDP_socket socket);
+
+	/*
+	 * @brief Stop holding back small messages, and send the ones held back so far.
+	 * @param socket The RUDP socket.
+	 */
+	void rudp_uncork(RUDP_socket socket);
+
+	/*
+	 * @brief Send the messages held back by send buffering or rudp_cork() right away, without waiting for more to share their packet.
+	 * @param socket The RUDP socket.
+	 * @note Doesn't wait for the peer. Does nothing if the socket isn't connected.
+	 */
+	void rudp_flush(RUDP_socket socket);
 
 	/*
 	 * @brief Disconnect from the connected peer.
 	 * @param socket The RUDP socket to disconnect.
-	 * @return True if the disconnection is successful, false otherwise (also prints an error message).
+	 * @return True if the disconnection is successful, false otherwise or if messages were left undelivered (also prints an error message).
+	 * @note Waits for the peer to acknowledge everything sent so far first, also the messages queued by rudp_send_async() or held back by rudp_cork(), for at most the timeout times the maximum number of retries.
 	 */
 	bool rudp_disconnect(RUDP_socket socket);
 
@@ -127,12 +203,151 @@ extern "C"
 	 */
 	uint16_t rudp_get_maxretries(RUDP_socket socket);
 
+	/*
+	 * @brief Gets the window size.
+	 * @return The number of packets that can be in flight (sent but not acknowledged yet), or 0 if the socket is invalid.
+	 */
+	uint16_t rudp_get_window_size(RUDP_socket socket);
+
+	/*
+	 * @brief Gets the ACK ratio.
+	 * @return The number of in-order data packets acknowledged by one ACK, or 0 if the socket is invalid.
+	 */
+	uint16_t rudp_get_ack_ratio(RUDP_socket socket);
+
+	/*
+	 * @brief Gets the ACK delay.
+	 * @return How long an ACK may be held back waiting for more data packets, in microseconds, or 0 if the socket is invalid.
+	 */
+	uint16_t rudp_get_ack_delay(RUDP_socket socket);
+
 	/*
 	 * @brief Gets the MTU of the peer.
 	 * @return The MTU of the peer, in case the peer has a smaller MTU, or 0 on error.
 	 */
 	uint16_t rudp_get_peers_MTU(RUDP_socket socket);
 
+	/*
+	 * @brief Gets the path MTU.
+	 * @return The largest packet size currently used to send data, as found by path MTU discovery, or 0 on error.
+	 */
+	uint16_t rudp_get_path_MTU(RUDP_socket socket);
+
+	/*
+	 * @brief Checks if path MTU discovery is enabled.
+	 * @return True if path MTU discovery is enabled, false otherwise.
+	 */
+	bool rudp_is_path_MTU_discovery(RUDP_socket socket);
+
+	/*
+	 * @brief Checks if send buffering (coalescing of small messages) is enabled.
+	 * @return True if send buffering is enabled, false otherwise.
+	 */
+	bool rudp_is_send_buffering(RUDP_socket socket);
+
+	/*
+	 * @brief Gets the send buffer delay.
+	 * @return How long a small message may wait for more messages to share its packet, in milliseconds (0 means no timer).
+	 */
+	uint16_t rudp_get_send_buffer_delay(RUDP_socket socket);
+
+	/*
+	 * @brief Gets the maximum send rate.
+	 * @return The most bytes per second the sender puts on the wire, 0 means no limit.
+	 */
+	uint64_t rudp_get_max_rate(RUDP_socket socket);
+
+	/*
+	 * @brief Checks if kernel pacing (SO_TXTIME) is requested.
+	 * @return True if kernel pacing is requested, false otherwise.
+	 */
+	bool rudp_is_kernel_pacing(RUDP_socket socket);
+
+	/*
+	 * @brief Gets the receive window limit.
+	 * @return The most bytes of received messages that may wait for the application before the peer is asked to stop.
+	 */
+	uint64_t rudp_get_recv_window(RUDP_socket socket);
+
+	/*
+	 * @brief Checks if socket buffer auto-tuning is enabled.
+	 * @return True if buffer auto-tuning is enabled, false otherwise.
+	 */
+	bool rudp_is_buffer_auto_tuning(RUDP_socket socket);
+
+	/*
+	 * @brief Gets the statistics of the current (or last) connection.
+	 * @param stats Filled with the counters since the connection started, see RUDP_stats.
+	 * @return True on success, false if the socket or stats pointer is invalid.
+	 * @note Only reads counters, so it is cheap enough to call often, from any thread.
+	 */
+	bool rudp_get_stats(RUDP_socket socket, RUDP_stats *stats);
+
+	/*
+	 * @brief Gets a snapshot of the round trip time histogram of the current (or last) connection.
+	 * @param histogram Filled with the round trip time of every packet sent once and acknowledged, in microseconds.
+	 * @return True on success, false if the socket or histogram pointer is invalid.
+	 */
+	bool rudp_get_rtt_histogram(RUDP_socket socket, RUDP_histogram *histogram);
+
+	/*
+	 * @brief Gets a snapshot of the message latency histogram of the current (or last) connection.
+	 * @param histogram Filled with the time from rudp_send() (or rudp_send_async()) to the ACK of the message's last packet, in microseconds.
+	 * @return True on success, false if the socket or histogram pointer is invalid.
+	 */
+	bool rudp_get_latency_histogram(RUDP_socket socket, RUDP_histogram *histogram);
+
+	/*
+	 * @brief Adds the values of one histogram snapshot to another, for example to aggregate many connections.
+	 * @param into The snapshot to add to, its percentiles are updated.
+	 * @param from The snapshot to add.
+	 */
+	void rudp_merge_histogram(RUDP_histogram *into, const RUDP_histogram *from);
+
+	/*
+	 * @brief Gets any percentile of a histogram snapshot.
+	 * @param histogram The snapshot.
+	 * @param percentile The percentile, between 0 and 100 (99.9 for the 99.9th percentile).
+	 * @return The percentile in microseconds, within about 3%, 0 if the snapshot is empty or invalid.
+	 */
+	uint64_t rudp_get_histogram_percentile(const RUDP_histogram *histogram, double percentile);
+
+	/*
+	 * @brief Checks if tracing is enabled.
+	 * @return True if the I/O engine records trace events, false otherwise.
+	 */
+	bool rudp_is_tracing(RUDP_socket socket);
+
+	/*
+	 * @brief Checks if phase timing is enabled.
+	 * @return True if the I/O engine times the phases of the hot path, false otherwise.
+	 */
+	bool rudp_is_phase_timing(RUDP_socket socket);
+
+	/*
+	 * @brief Reads the oldest trace events, and removes them from the trace ring.
+	 * @param events Where to store the events.
+	 * @param max_events The most events to read.
+	 * @return The number of events read, 0 if there are none, tracing is disabled or on error.
+	 * @note The ring holds 65536 events, the events that find it full are lost (and reported by a RUDP_TRACE_EVENTS_LOST event).
+	 */
+	uint32_t rudp_read_trace(RUDP_socket socket, RUDP_trace_event *events, uint32_t max_events);
+
+	/*
+	 * @brief Gets the file the flight recorder is dumped to when the connection fails.
+	 * @return The path of the file, empty if the flight recorder isn't dumped automatically, NULL on error.
+	 */
+	const char *rudp_get_flight_recorder_file(RUDP_socket socket);
+
+	/*
+	 * @brief Writes the flight recorder, the headers of the last 1024 packets sent and received, to a pcap file.
+	 * @param path The path of the file, it is overwritten.
+	 * @return The number of packets written, oldest first, 0 on error.
+	 * @note Can be called at any time, from any thread. Packets recorded while the file is written may be left out.
+	 * @note The link type is USER0 (147), src/tools/RUDP_Wireshark.lua lets Wireshark dissect it.
+	 */
+	uint32_t rudp_dump_flight_recorder(RUDP_socket socket, const char *path);
+
 	/*
 	 * @brief Checks if the socket is in debug mode.
 	 * @return True if the socket is in debug mode, false otherwise.
@@ -158,6 +373,14 @@ extern "C"
 	 */
 	void rudp_set_debug_mode(RUDP_socket socket, bool debug_mode);
 
+	/*
+	 * @brief Sets the progress callback, to follow the progress of large messages.
+	 * @param callback The callback, or NULL to stop reporting progress.
+	 * @param user_data A pointer passed back to the callback as is.
+	 * @note The callback is called from the I/O engine thread, so it must be quick and must not call back into the socket.
+	 */
+	void rudp_set_progress_callback(RUDP_socket socket, RUDP_progress_callback callback, void *user_data);
+
 	/*
 	 * @brief Sets the MTU (Maximum Transmission Unit) of the network.
 	 * @param MTU The MTU of the network.
@@ -183,13 +406,118 @@ extern "C"
 	 */
 	void rudp_set_max_retries(RUDP_socket socket, uint16_t max_retries);
 
+	/*
+	 * @brief Sets the window size.
+	 * @param window_size The number of packets that can be in flight (sent but not acknowledged yet), default is 64 packets.
+	 * @note Messages share the window, so a larger window lets more messages be in flight back-to-back.
+	 * @attention This value can't be changed if the socket is connected, as it is negotiated with the peer (the smaller window is used).
+	 */
+	void rudp_set_window_size(RUDP_socket socket, uint16_t window_size);
+
+	/*
+	 * @brief Sets the ACK ratio.
+	 * @param ack_ratio The number of in-order data packets acknowledged by one ACK, default is 2 packets.
+	 * @note Out-of-order and duplicate packets, and the last packet of a message, are always acknowledged right away.
+	 * @attention This value can't be changed if the socket is connected, as it is negotiated with the peer (the smaller ratio is used).
+	 */
+	void rudp_set_ack_ratio(RUDP_socket socket, uint16_t ack_ratio);
+
+	/*
+	 * @brief Sets the ACK delay.
+	 * @param ack_delay How long an ACK may be held back waiting for more data packets, in microseconds, default is 1000 microseconds.
+	 * @note 0 acknowledges every data packet right away, whatever the ACK ratio.
+	 * @attention This value can't be changed if the socket is connected, as it is negotiated with the peer (the shorter delay is used).
+	 */
+	void rudp_set_ack_delay(RUDP_socket socket, uint16_t ack_delay);
+
 	/*
 	 * @brief Forces the socket to use its own MTU, instead of the peer's MTU.
 	 * @attention This is experimental, as it can cause failures in some cases.
 	 * @attention Use this only if you know what you are doing.
+	 * @note The I/O engine moves to the new MTU shortly after, with path MTU discovery on it probes up to it first.
 	 */
 	void rudp_force_use_own_MTU(RUDP_socket socket);
 
+	/*
+	 * @brief Enables or disables path MTU discovery.
+	 * @param enable True to fall back to smaller packets when the path stops carrying packets of the smaller of the two MTUs, and probe back up to it, false to always use the smaller of the two MTUs.
+	 * @note Enabled by default. When enabled, packets are sent with the don't fragment bit.
+	 * @attention This value can't be changed if the socket is connected.
+	 */
+	void rudp_set_path_MTU_discovery(RUDP_socket socket, bool enable);
+
+	/*
+	 * @brief Enables or disables send buffering (Nagle's algorithm).
+	 * @param enable True to coalesce small messages into shared packets, false to send every message in its own packets.
+	 * @note While data is unacknowledged, a message that doesn't fill a packet waits for more messages, for an ACK or for the send buffer delay, whichever comes first.
+	 * @note Each message keeps its boundaries, the peer receives them one by one as usual. Disabled by default.
+	 */
+	void rudp_set_send_buffering(RUDP_socket socket, bool enable);
+
+	/*
+	 * @brief Sets the send buffer delay.
+	 * @param delay How long a small message may wait for more messages to share its packet, in milliseconds, default is 5 milliseconds.
+	 * @note 0 means no timer: with send buffering, a message waits until an ACK arrives; with rudp_cork(), until rudp_uncork() or rudp_flush().
+	 */
+	void rudp_set_send_buffer_delay(RUDP_socket socket, uint16_t delay);
+
+	/*
+	 * @brief Sets the maximum send rate, the sender's packets are then spread out evenly to keep under it.
+	 * @param rate The most bytes per second the sender puts on the wire (RUDP headers included), default is 0 (no limit).
+	 * @note Retransmissions count towards the rate too, but are never held back by it.
+	 */
+	void rudp_set_max_rate(RUDP_socket socket, uint64_t rate);
+
+	/*
+	 * @brief Enables or disables kernel pacing: with a maximum rate, each packet carries its departure time (SO_TXTIME) and the kernel sends it on time.
+	 * @param enable True to hand the packet schedule to the kernel, false to pace in the I/O engine.
+	 * @note Disabled by default. Needs Linux and the fq qdisc on the outgoing interface, other qdiscs send the packets right away.
+	 * @note If the socket option is not available, the I/O engine paces the packets itself.
+	 * @attention This value can't be changed if the socket is connected.
+	 */
+	void rudp_set_kernel_pacing(RUDP_socket socket, bool enable);
+
+	/*
+	 * @brief Sets the receive window limit, the peer is asked to slow down to the pace of rudp_recv() once this much data waits to be read.
+	 * @param bytes The most bytes of received messages that may wait for the application, default is 4 MiB.
+	 * @note The window advertised in each ACK shrinks as the unread messages (and the message being reassembled) fill up the limit, down to 0.
+	 * @note A message larger than the limit is still received whole, the window closes only while there are unread messages.
+	 * @note Can be changed at any time, also while connected.
+	 */
+	void rudp_set_recv_window(RUDP_socket socket, uint64_t bytes);
+
+	/*
+	 * @brief Enables or disables socket buffer auto-tuning.
+	 * @param enable True to grow the kernel socket buffers (SO_RCVBUF / SO_SNDBUF) to hold a few send windows, and the receive buffer further whenever the kernel drops packets, false to keep the system defaults.
+	 * @note Enabled by default. The buffers only grow, up to 16 MiB, and past the system limits (net.core.rmem_max / wmem_max) only for privileged processes.
+	 * @attention This value can't be changed if the socket is connected.
+	 */
+	void rudp_set_buffer_auto_tuning(RUDP_socket socket, bool enable);
+
+	/*
+	 * @brief Enables or disables tracing.
+	 * @param enable True to record the packet events of the I/O engine into a trace ring, read with rudp_read_trace(), false to stop and drop the events not read yet.
+	 * @note Disabled by default. A disabled trace costs a single branch per event, an enabled one a timestamp and a copy of a small record.
+	 * @attention This value can't be changed if the socket is connected.
+	 */
+	void rudp_set_tracing(RUDP_socket socket, bool enable);
+
+	/*
+	 * @brief Enables or disables phase timing.
+	 * @param enable True to time the phases of the hot path (see RUDP_PHASE_*) into the phase_ns and phase_count counters of rudp_get_stats(), false to stop.
+	 * @note Disabled by default. Disabled phase timing costs a single branch per phase, enabled two clock reads. It can also be left out of the library (make PHASE_TIMING=0).
+	 * @attention This value can't be changed if the socket is connected, nor enabled if phase timing isn't built into the library.
+	 */
+	void rudp_set_phase_timing(RUDP_socket socket, bool enable);
+
+	/*
+	 * @brief Sets the file the flight recorder is dumped to when the connection fails, for example when a packet reached the maximum number of retries.
+	 * @param path The path of the file, NULL or empty to not dump the flight recorder automatically.
+	 * @note Not set by default. The packets are recorded anyway, rudp_dump_flight_recorder() writes them at any time.
+	 * @attention This value can't be changed if the socket is connected.
+	 */
+	void rudp_set_flight_recorder_file(RUDP_socket socket, const char *path);
+
 #ifdef __cplusplus
 }
 #endif // __cplusplus
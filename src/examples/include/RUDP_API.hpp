@@ -17,6 +17,7 @@
 
 #pragma once
 #include <cstdint>
+#include "../../include/RUDP_Types.h"
 
 /*
  * @brief The MTU (Maximum Transmission Unit) of the network, default is 1458 bytes.
@@ -33,11 +34,52 @@
  */
 #define RUDP_MAX_RETRIES_DEFAULT 50
 
+/*
+ * @brief The number of packets that can be in flight (sent but not acknowledged yet), default is 64 packets.
+ */
+#define RUDP_WINDOW_SIZE_DEFAULT 64
+
+/*
+ * @brief The number of in-order data packets acknowledged by one ACK, default is 2 packets.
+ */
+#define RUDP_ACK_RATIO_DEFAULT 2
+
+/*
+ * @brief How long an ACK may be held back waiting for more data packets, in microseconds, default is 1000 microseconds.
+ */
+#define RUDP_ACK_DELAY_DEFAULT 1000
+
+/*
+ * @brief How long a small message may wait for more messages to share its packet when send buffering is enabled, default is 5 milliseconds.
+ */
+#define RUDP_SEND_BUFFER_DELAY_DEFAULT 5
+
+/*
+ * @brief The most bytes per second the sender puts on the wire (RUDP headers included), default is 0 (no limit).
+ */
+#define RUDP_MAX_RATE_DEFAULT 0
+
+/*
+ * @brief The most bytes of received messages that may wait for the application before the receiver closes its window, default is 4 MiB.
+ */
+#define RUDP_RECV_WINDOW_DEFAULT (4 * 1024 * 1024)
+
+/*
+ * @brief A progress callback, called by the I/O engine while a message is sent or received.
+ * @param sending True for a message being sent, false for a message being received.
+ * @param bytes_done Number of bytes acknowledged by the peer (sending) or received in order (receiving).
+ * @param bytes_total Size of the message, or 0 while receiving, as the size is known only once the whole message arrived.
+ * @param user_data The pointer given when the callback was set.
+ * @note Called every 1 MiB of progress and once when a message completes, from the I/O engine thread.
+ */
+typedef void (*RUDP_progress_callback)(bool sending, uint64_t bytes_done, uint64_t bytes_total, void *user_data);
+
 class RUDP_Socket_p;
 
 /*
  * @brief This class represents a Reliable UDP socket.
- * @note This class is not thread-safe, do not use the same object in multiple threads.
+ * @note Each connection runs a background I/O engine thread, so one thread may call recv() while other threads call send() or sendAsync() on the same object (full-duplex).
+ * @note Any number of threads may send at once, but only a single thread should receive. The rest of the methods are not thread-safe.
  */
 class RUDP_Socket
 {
@@ -85,23 +127,53 @@ public:
 	 * @brief Receives data from the connected peer.
 	 * @param buffer Buffer to store the received data.
 	 * @param buffer_size Size of the buffer.
-	 * @return Number of bytes received or -1 if an error occurs.
+	 * @return Number of bytes received, 0 if the peer closed the connection (a message is never empty, see send()), or -1 if an error occurs.
 	 * @throws `std::runtime_error` if the socket is not connected, or if there is a socket error.
 	 */
-	int recv(void *buffer, uint32_t buffer_size);
+	int64_t recv(void *buffer, uint64_t buffer_size);
 
 	/*
 	 * @brief Sends data to the connected peer.
 	 * @param buffer Buffer containing the data to be sent.
 	 * @param buffer_size Size of the buffer.
 	 * @return Number of bytes sent, or -1 if an error occurs.
-	 * @throws `std::runtime_error` if the socket is not connected, or if there is a socket error.
+	 * @throws `std::runtime_error` if the socket is not connected, if the buffer is empty (recv() returns 0 only once the connection is closed) or larger than 1 TiB, or if there is a socket error.
+	 */
+	int64_t send(void *buffer, uint64_t buffer_size);
+
+	/*
+	 * @brief Queues data to be sent to the connected peer, without waiting for the network.
+	 * @param buffer Buffer containing the data to be sent, copied before the call returns.
+	 * @param buffer_size Size of the buffer.
+	 * @return Number of bytes queued, or 0 if the send queue is full (try again later).
+	 * @note Lock-free: any number of threads can queue messages at once, messages from the same thread are sent in order.
+	 * @note Delivery errors can't be reported back to the caller, they are printed in debug mode. disconnect() waits for the queued messages, and reports the ones it couldn't deliver.
+	 * @throws `std::runtime_error` if the socket is not connected, or if the buffer is empty or larger than 1 TiB.
 	 */
-	int send(void *buffer, uint32_t buffer_size);
+	int64_t sendAsync(const void *buffer, uint64_t buffer_size);
+
+	/*
+	 * @brief Holds back small messages until uncork() or flush(), so they share packets.
+	 * @note Full packets are still sent, and a message never waits longer than the send buffer delay (if not 0).
+	 * @note Can be called at any time, also before connecting.
+	 */
+	void cork();
+
+	/*
+	 * @brief Stops holding back small messages, and sends the ones held back so far.
+	 */
+	void uncork();
+
+	/*
+	 * @brief Sends the messages held back by send buffering or cork() right away, without waiting for more to share their packet.
+	 * @note Doesn't wait for the peer, use send() for that. Does nothing if the socket isn't connected.
+	 */
+	void flush();
 
 	/*
 	 * @brief Disconnects from the connected peer.
-	 * @return True if the disconnection is successful, false otherwise.
+	 * @return True if the disconnection is successful, false if messages were left undelivered.
+	 * @note Waits for the peer to acknowledge everything sent so far first, also the messages queued by sendAsync() or held back by cork(), for at most the timeout times the maximum number of retries.
 	 * @throws `std::runtime_error` if there is a socket error.
 	 */
 	bool disconnect();
@@ -125,12 +197,152 @@ public:
 	 */
 	uint16_t getMaxRetries() const;
 
+	/*
+	 * @brief Gets the window size.
+	 * @return The number of packets that can be in flight (sent but not acknowledged yet).
+	 */
+	uint16_t getWindowSize() const;
+
+	/*
+	 * @brief Gets the ACK ratio.
+	 * @return The number of in-order data packets acknowledged by one ACK.
+	 */
+	uint16_t getAckRatio() const;
+
+	/*
+	 * @brief Gets the ACK delay.
+	 * @return How long an ACK may be held back waiting for more data packets, in microseconds.
+	 */
+	uint16_t getAckDelay() const;
+
 	/*
 	 * @brief Gets the MTU of the peer.
 	 * @return The MTU of the peer, in case the peer has a smaller MTU.
 	 * @throws `std::runtime_error` if the socket isn't connected.
 	 */
 	uint16_t getPeersMTU() const;
+
+	/*
+	 * @brief Gets the path MTU.
+	 * @return The largest packet size currently used to send data, as found by path MTU discovery.
+	 * @throws `std::runtime_error` if the socket isn't connected.
+	 */
+	uint16_t getPathMTU() const;
+
+	/*
+	 * @brief Checks if path MTU discovery is enabled.
+	 * @return True if path MTU discovery is enabled, false otherwise.
+	 */
+	bool isPathMTUDiscovery() const;
+
+	/*
+	 * @brief Checks if send buffering (coalescing of small messages) is enabled.
+	 * @return True if send buffering is enabled, false otherwise.
+	 */
+	bool isSendBuffering() const;
+
+	/*
+	 * @brief Gets the send buffer delay.
+	 * @return How long a small message may wait for more messages to share its packet, in milliseconds (0 means no timer).
+	 */
+	uint16_t getSendBufferDelay() const;
+
+	/*
+	 * @brief Gets the maximum send rate.
+	 * @return The most bytes per second the sender puts on the wire, 0 means no limit.
+	 */
+	uint64_t getMaxRate() const;
+
+	/*
+	 * @brief Checks if kernel pacing (SO_TXTIME) is requested.
+	 * @return True if kernel pacing is requested, false otherwise.
+	 */
+	bool isKernelPacing() const;
+
+	/*
+	 * @brief Gets the receive window limit.
+	 * @return The most bytes of received messages that may wait for the application before the peer is asked to stop.
+	 */
+	uint64_t getRecvWindow() const;
+
+	/*
+	 * @brief Checks if socket buffer auto-tuning is enabled.
+	 * @return True if buffer auto-tuning is enabled, false otherwise.
+	 */
+	bool isBufferAutoTuning() const;
+
+	/*
+	 * @brief Gets the statistics of the current (or last) connection.
+	 * @return The counters since the connection started, see RUDP_stats.
+	 * @note Only reads counters, so it is cheap enough to call often, from any thread.
+	 */
+	RUDP_stats getStats() const;
+
+	/*
+	 * @brief Gets a snapshot of the round trip time histogram of the current (or last) connection.
+	 * @return The round trip time of every packet sent once and acknowledged, in microseconds, see RUDP_histogram.
+	 */
+	RUDP_histogram getRttHistogram() const;
+
+	/*
+	 * @brief Gets a snapshot of the message latency histogram of the current (or last) connection.
+	 * @return The time from send() (or sendAsync()) to the ACK of the message's last packet, in microseconds, see RUDP_histogram.
+	 */
+	RUDP_histogram getLatencyHistogram() const;
+
+	/*
+	 * @brief Adds the values of one histogram snapshot to another, for example to aggregate many connections.
+	 * @param into The snapshot to add to, its percentiles are updated.
+	 * @param from The snapshot to add.
+	 */
+	static void mergeHistogram(RUDP_histogram &into, const RUDP_histogram &from);
+
+	/*
+	 * @brief Gets any percentile of a histogram snapshot.
+	 * @param histogram The snapshot.
+	 * @param percentile The percentile, between 0 and 100 (99.9 for the 99.9th percentile).
+	 * @return The percentile in microseconds, within about 3%, 0 if the snapshot is empty.
+	 */
+	static uint64_t getHistogramPercentile(const RUDP_histogram &histogram, double percentile);
+
+	/*
+	 * @brief Checks if tracing is enabled.
+	 * @return True if the I/O engine records trace events, false otherwise.
+	 */
+	bool isTracing() const;
+
+	/*
+	 * @brief Checks if phase timing is enabled.
+	 * @return True if the I/O engine times the phases of the hot path, false otherwise.
+	 */
+	bool isPhaseTiming() const;
+
+	/*
+	 * @brief Reads the oldest trace events, and removes them from the trace ring.
+	 * @param events Where to store the events.
+	 * @param max_events The most events to read.
+	 * @return The number of events read, 0 if there are none or tracing is disabled.
+	 * @note The ring holds 65536 events, the events that find it full are lost (and reported by a RUDP_TRACE_EVENTS_LOST event).
+	 * @throws `std::runtime_error` if the events pointer is null.
+	 */
+	uint32_t readTrace(RUDP_trace_event *events, uint32_t max_events);
+
+	/*
+	 * @brief Gets the file the flight recorder is dumped to when the connection fails.
+	 * @return The path of the file, empty if the flight recorder isn't dumped automatically.
+	 */
+	const char *getFlightRecorderFile() const;
+
+	/*
+	 * @brief Writes the flight recorder, the headers of the last 1024 packets sent and received, to a pcap file.
+	 * @param path The path of the file, it is overwritten.
+	 * @return The number of packets written, oldest first.
+	 * @note Can be called at any time, from any thread. Packets recorded while the file is written may be left out.
+	 * @note The link type is USER0 (147), src/tools/RUDP_Wireshark.lua lets Wireshark dissect it.
+	 * @throws `std::runtime_error` if the path is null or the file can't be written.
+	 */
+	uint32_t dumpFlightRecorder(const char *path) const;
+
 	/*
 	 * @brief Checks if the socket is in debug mode.
 	 * @return True if the socket is in debug mode, false otherwise.
@@ -157,6 +369,14 @@ public:
 	 */
 	void setDebugMode(bool debug_mode);
 
+	/*
+	 * @brief Sets the progress callback, to follow the progress of large messages.
+	 * @param callback The callback, or nullptr to stop reporting progress.
+	 * @param user_data A pointer passed back to the callback as is.
+	 * @note The callback is called from the I/O engine thread, so it must be quick and must not call back into the socket.
+	 */
+	void setProgressCallback(RUDP_progress_callback callback, void *user_data);
+
 	/*
 	 * @brief Sets the MTU (Maximum Transmission Unit) of the network.
 	 * @param MTU The MTU of the network.
@@ -184,11 +404,129 @@ public:
 	 */
 	void setMaxRetries(uint16_t max_retries);
 
+	/*
+	 * @brief Sets the window size.
+	 * @param window_size The number of packets that can be in flight (sent but not acknowledged yet), default is RUDP_WINDOW_SIZE_DEFAULT.
+	 * @note Messages share the window, so a larger window lets more messages be in flight back-to-back.
+	 * @attention This value can't be changed if the socket is connected, as it is negotiated with the peer (the smaller window is used).
+	 * @throws `std::runtime_error` if the socket is connected, or if the window size is 0.
+	 */
+	void setWindowSize(uint16_t window_size);
+
+	/*
+	 * @brief Sets the ACK ratio.
+	 * @param ack_ratio The number of in-order data packets acknowledged by one ACK, default is RUDP_ACK_RATIO_DEFAULT.
+	 * @note Out-of-order and duplicate packets, and the last packet of a message, are always acknowledged right away.
+	 * @attention This value can't be changed if the socket is connected, as it is negotiated with the peer (the smaller ratio is used).
+	 * @throws `std::runtime_error` if the socket is connected, or if the ratio is 0.
+	 */
+	void setAckRatio(uint16_t ack_ratio);
+
+	/*
+	 * @brief Sets the ACK delay.
+	 * @param ack_delay How long an ACK may be held back waiting for more data packets, in microseconds, default is RUDP_ACK_DELAY_DEFAULT.
+	 * @note 0 acknowledges every data packet right away, whatever the ACK ratio.
+	 * @attention This value can't be changed if the socket is connected, as it is negotiated with the peer (the shorter delay is used).
+	 * @throws `std::runtime_error` if the socket is connected.
+	 */
+	void setAckDelay(uint16_t ack_delay);
+
 	/*
 	 * @brief Forces the socket to use its own MTU, instead of the peer's MTU.
 	 * @attention This is experimental, as it can cause failures in some cases.
 	 * @attention Use this only if you know what you are doing.
+	 * @note The I/O engine moves to the new MTU shortly after, with path MTU discovery on it probes up to it first.
 	 * @throws `std::runtime_error` if the socket isn't connected.
 	 */
 	void forceUseOwnMTU();
+
+	/*
+	 * @brief Enables or disables path MTU discovery.
+	 * @param enable True to fall back to smaller packets when the path stops carrying packets of the smaller of the two MTUs, and probe back up to it, false to always use the smaller of the two MTUs.
+	 * @note Enabled by default. When enabled, packets are sent with the don't fragment bit.
+	 * @attention This value can't be changed if the socket is connected.
+	 * @throws `std::runtime_error` if the socket is connected.
+	 */
+	void setPathMTUDiscovery(bool enable);
+
+	/*
+	 * @brief Enables or disables send buffering (Nagle's algorithm).
+	 * @param enable True to coalesce small messages into shared packets, false to send every message in its own packets.
+	 * @note While data is unacknowledged, a message that doesn't fill a packet waits for more messages, for an ACK or for the send buffer delay, whichever comes first.
+	 * @note Each message keeps its boundaries, the peer receives them one by one as usual. Disabled by default.
+	 * @note Can be changed at any time, also while connected.
+	 */
+	void setSendBuffering(bool enable);
+
+	/*
+	 * @brief Sets the send buffer delay.
+	 * @param delay How long a small message may wait for more messages to share its packet, in milliseconds, default is RUDP_SEND_BUFFER_DELAY_DEFAULT.
+	 * @note 0 means no timer: with send buffering, a message waits until an ACK arrives; with cork(), until uncork() or flush().
+	 * @note Can be changed at any time, also while connected.
+	 */
+	void setSendBufferDelay(uint16_t delay);
+
+	/*
+	 * @brief Sets the maximum send rate, the sender's packets are then spread out evenly to keep under it.
+	 * @param rate The most bytes per second the sender puts on the wire (RUDP headers included), default is RUDP_MAX_RATE_DEFAULT (0, no limit).
+	 * @note Retransmissions count towards the rate too, but are never held back by it.
+	 * @note Can be changed at any time, also while connected.
+	 */
+	void setMaxRate(uint64_t rate);
+
+	/*
+	 * @brief Enables or disables kernel pacing: with a maximum rate, each packet carries its departure time (SO_TXTIME) and the kernel sends it on time.
+	 * @param enable True to hand the packet schedule to the kernel, false to pace in the I/O engine.
+	 * @note Disabled by default. Needs Linux and the fq qdisc on the outgoing interface, other qdiscs send the packets right away.
+	 * @note If the socket option is not available, the I/O engine paces the packets itself.
+	 * @attention This value can't be changed if the socket is connected.
+	 * @throws `std::runtime_error` if the socket is connected.
+	 */
+	void setKernelPacing(bool enable);
+
+	/*
+	 * @brief Sets the receive window limit, the peer is asked to slow down to the pace of recv() once this much data waits to be read.
+	 * @param bytes The most bytes of received messages that may wait for the application, default is RUDP_RECV_WINDOW_DEFAULT.
+	 * @note The window advertised in each ACK shrinks as the unread messages (and the message being reassembled) fill up the limit, down to 0.
+	 * @note A message larger than the limit is still received whole, the window closes only while there are unread messages.
+	 * @note Can be changed at any time, also while connected.
+	 * @throws `std::runtime_error` if the limit is 0.
+	 */
+	void setRecvWindow(uint64_t bytes);
+
+	/*
+	 * @brief Enables or disables socket buffer auto-tuning.
+	 * @param enable True to grow the kernel socket buffers (SO_RCVBUF / SO_SNDBUF) to hold a few send windows, and the receive buffer further whenever the kernel drops packets, false to keep the system defaults.
+	 * @note Enabled by default. The buffers only grow, up to 16 MiB, and past the system limits (net.core.rmem_max / wmem_max) only for privileged processes.
+	 * @attention This value can't be changed if the socket is connected.
+	 * @throws `std::runtime_error` if the socket is connected.
+	 */
+	void setBufferAutoTuning(bool enable);
+
+	/*
+	 * @brief Enables or disables tracing.
+	 * @param enable True to record the packet events of the I/O engine into a trace ring, read with readTrace(), false to stop and drop the events not read yet.
+	 * @note Disabled by default. A disabled trace costs a single branch per event, an enabled one a timestamp and a copy of a small record.
+	 * @attention This value can't be changed if the socket is connected.
+	 * @throws `std::runtime_error` if the socket is connected.
+	 */
+	void setTracing(bool enable);
+
+	/*
+	 * @brief Enables or disables phase timing.
+	 * @param enable True to time the phases of the hot path (see RUDP_PHASE_*) into the phase_ns and phase_count counters of getStats(), false to stop.
+	 * @note Disabled by default. Disabled phase timing costs a single branch per phase, enabled two clock reads. It can also be left out of the library (make PHASE_TIMING=0).
+	 * @attention This value can't be changed if the socket is connected.
+	 * @throws `std::runtime_error` if the socket is connected, or if phase timing isn't built into the library.
+	 */
+	void setPhaseTiming(bool enable);
+
+	/*
+	 * @brief Sets the file the flight recorder is dumped to when the connection fails, for example when a packet reached the maximum number of retries.
+	 * @param path The path of the file, nullptr or empty to not dump the flight recorder automatically.
+	 * @note Not set by default. The packets are recorded anyway, dumpFlightRecorder() writes them at any time.
+	 * @attention This value can't be changed if the socket is connected.
+	 * @throws `std::runtime_error` if the socket is connected.
+	 */
+	void setFlightRecorderFile(const char *path);
 };
\ No newline at end of file
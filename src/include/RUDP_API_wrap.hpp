@@ -20,6 +20,19 @@
 #include <cstring>
 #include <string>
 #include <stdexcept>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <vector>
+#include "RUDP_Queue.hpp"
+#include "RUDP_Histogram.hpp"
+#include "RUDP_Log.hpp"
+#include "RUDP_Types.h"
 
 #if defined(_WIN32) || defined(_WIN64) // Windows NT (not Windows 9x)
 
@@ -46,6 +59,7 @@
 #include <poll.h>
 #include <unistd.h>
 #include <netinet/in.h>
+#include <fcntl.h>
 
 // Compatibility with Windows types, constants and functions.
 
@@ -76,6 +90,155 @@ typedef int SOCKET;
  */
 #define RUDP_MAX_RETRIES_DEFAULT 50
 
+/*
+ * @brief The number of packets that can be in flight (sent but not acknowledged yet), default is 64 packets.
+ * @note The window spans messages, so several messages can be in flight back-to-back.
+ */
+#define RUDP_WINDOW_SIZE_DEFAULT 64
+
+/*
+ * @brief The number of in-order data packets acknowledged by one ACK, default is 2 packets.
+ * @note Negotiated in the handshake (the smaller ratio is used), and capped at half of the window so the sender never stalls.
+ */
+#define RUDP_ACK_RATIO_DEFAULT 2
+
+/*
+ * @brief How long an ACK may be held back waiting for more data packets, in microseconds, default is 1000 microseconds.
+ * @note Negotiated in the handshake (the shorter delay is used), and capped at half of the timeout.
+ */
+#define RUDP_ACK_DELAY_DEFAULT 1000
+
+/*
+ * @brief The number of duplicate ACKs that trigger a retransmission of the oldest packet, before its timer expires.
+ */
+#define RUDP_FAST_RETRANSMIT_THRESHOLD 3
+
+/*
+ * @brief The progress callback is called each time a message moves this many bytes further, default is 1 MiB.
+ */
+#define RUDP_PROGRESS_INTERVAL (1024 * 1024)
+
+/*
+ * @brief The largest message that can be sent, 1 TiB. The receiver takes a message that grows past it as a protocol error.
+ */
+#define RUDP_MAX_MESSAGE_SIZE (1ULL << 40)
+
+/*
+ * @brief How long a small message may wait for more messages to share its packet when send buffering is enabled, default is 5 milliseconds.
+ * @note 0 means no timer: the message waits for an ACK (send buffering) or for uncork() / flush() (corked socket).
+ */
+#define RUDP_SEND_BUFFER_DELAY_DEFAULT 5
+
+/*
+ * @brief The most bytes per second the sender puts on the wire (RUDP headers included), default is 0 (no limit).
+ */
+#define RUDP_MAX_RATE_DEFAULT 0
+
+/*
+ * @brief The most bytes of received messages that may wait for the application before the receiver closes its window, default is 4 MiB.
+ */
+#define RUDP_RECV_WINDOW_DEFAULT (4 * 1024 * 1024)
+
+/*
+ * @brief The longest interval between two zero window probes, in milliseconds (the first one waits for the timeout, then it doubles).
+ */
+#define RUDP_WINDOW_PROBE_MAX_INTERVAL 2000
+
+/*
+ * @brief How many full packets the pacer lets out back to back, after the sender was idle.
+ */
+#define RUDP_PACER_BURST 2
+
+/*
+ * @brief The last part of a pacing gap that is spun instead of slept, as a sleep may oversleep by this much, in microseconds.
+ */
+#define RUDP_PACER_SPIN_USEC 100
+
+/*
+ * @brief With kernel pacing, how far ahead of time packets are handed to the kernel, in microseconds.
+ */
+#define RUDP_TXTIME_HORIZON_USEC 10000
+
+/*
+ * @brief Size of the length prefix of each message in a BATCH packet.
+ */
+#define RUDP_BATCH_RECORD_HEADER_SIZE sizeof(uint16_t)
+
+/*
+ * @brief Number of events the trace ring holds until the application reads them, must be a power of two.
+ */
+#define RUDP_TRACE_RING_SIZE 65536
+
+/*
+ * @brief Number of packets the flight recorder remembers, must be a power of two.
+ */
+#define RUDP_FLIGHT_RECORDER_SIZE 1024
+
+/*
+ * @brief The pcap link type of a flight recorder dump, LINKTYPE_USER0, which is reserved for private use.
+ * @note Each packet of the dump starts with a pseudo header: the direction and 3 reserved bytes, then the packet as it was on the wire, cut after the RUDP header.
+ */
+#define RUDP_FLIGHT_RECORDER_LINKTYPE 147
+
+/*
+ * @brief Size of the pseudo header in front of each packet of a flight recorder dump.
+ */
+#define RUDP_FLIGHT_RECORDER_PSEUDO_HEADER_SIZE 4
+
+/*
+ * @brief The direction of a packet in the flight recorder.
+ */
+#define RUDP_FLIGHT_RECORDER_RECEIVED 0
+#define RUDP_FLIGHT_RECORDER_SENT 1
+
+/*
+ * @brief Whether phase timing is built into the library, see setPhaseTiming().
+ * @note Set by the build (make PHASE_TIMING=0 leaves it out), built in by default.
+ */
+#ifndef RUDP_PHASE_TIMING
+#define RUDP_PHASE_TIMING 1
+#endif
+
+/*
+ * @brief A progress callback, called by the I/O engine while a message is sent or received.
+ * @param sending True for a message being sent, false for a message being received.
+ * @param bytes_done Number of bytes acknowledged by the peer (sending) or received in order (receiving).
+ * @param bytes_total Size of the message, or 0 while receiving, as the size is known only once the whole message arrived.
+ * @param user_data The pointer given to setProgressCallback().
+ */
+typedef void (*RUDP_progress_callback)(bool sending, uint64_t bytes_done, uint64_t bytes_total, void *user_data);
+
+/*
+ * @brief The largest packet size path MTU discovery probes for, default is 8972 bytes (a 9000 bytes jumbo frame, without the IP and UDP headers).
+ * @note The smaller of the two MTUs caps it further, a probe never goes above what either peer allows.
+ */
+#define RUDP_PMTU_MAX 8972
+
+/*
+ * @brief The packet size path MTU discovery falls back to when packets of the current size are black-holed.
+ */
+#define RUDP_PMTU_BASE 1200
+
+/*
+ * @brief Path MTU discovery stops searching once the largest confirmed and the smallest failed sizes are this close.
+ */
+#define RUDP_PMTU_SEARCH_GRANULARITY 32
+
+/*
+ * @brief Number of times a probe is sent before its size is considered too large for the path.
+ */
+#define RUDP_PMTU_MAX_PROBES 3
+
+/*
+ * @brief Number of timeouts in a row of the same packet that make the sender suspect a black hole, and fall back to RUDP_PMTU_BASE.
+ */
+#define RUDP_PMTU_BLACK_HOLE_TIMEOUTS 3
+
+/*
+ * @brief How long to wait after a search completes before probing for a larger size again, in seconds (RFC 8899 PMTU_RAISE_TIMER).
+ */
+#define RUDP_PMTU_RAISE_INTERVAL 600
+
 /*
  * @brief The minimal MTU (Maximum Transmission Unit) of the network.
  */
@@ -86,6 +249,33 @@ typedef int SOCKET;
  */
 #define RUDP_MINIMAL_TIMEOUT 10
 
+/*
+ * @brief The size of the I/O engine's receive buffer, large enough for any UDP datagram.
+ */
+#define RUDP_ENGINE_BUFFER_SIZE 65536
+
+/*
+ * @brief With buffer auto-tuning, how many send windows (window size times the negotiated MTU) the kernel socket buffers are sized for.
+ * @note The kernel counts its own overhead for each packet against the buffer too, which is about as much as a small packet itself.
+ */
+#define RUDP_SOCKET_BUFFER_WINDOWS 8
+
+/*
+ * @brief With buffer auto-tuning, the largest size the kernel socket buffers are grown to, default is 16 MiB.
+ */
+#define RUDP_SOCKET_BUFFER_MAX (16 * 1024 * 1024)
+
+/*
+ * @brief The number of send requests that can wait for the I/O engine at once, shared by all the sending threads.
+ */
+#define RUDP_SEND_QUEUE_SIZE 4096
+
+/*
+ * @brief The number of received messages that can wait for the application at once.
+ * @note The I/O engine holds any extra messages on its side until the application catches up.
+ */
+#define RUDP_RECV_QUEUE_SIZE 1024
+
 /* Flags for Reliable UDP Protocol */
 
 /*
@@ -113,170 +303,1327 @@ typedef int SOCKET;
  */
 #define RUDP_FLAG_FIN 0x10
 
+/*
+ * @brief The PROBE flag - a padded path MTU probe (with ACK, the probe's acknowledgement).
+ */
+#define RUDP_FLAG_PROBE 0x20
+
+/*
+ * @brief The BATCH flag - the payload holds several whole messages, each prefixed by its length (RUDP_BATCH_RECORD_HEADER_SIZE bytes).
+ */
+#define RUDP_FLAG_BATCH 0x40
+
+/*
+ * @brief The NAK flag - negative acknowledgement, the payload lists the packets to resend (RUDP_NAK_range records).
+ */
+#define RUDP_FLAG_NAK 0x80
+
 /*
  * @brief The RUDP header.
- * @param seq_num Sequence number of the packet (used for tracking which packet is which).
+ * @param seq_num Sequence number of the packet, counted over the whole connection.
+ * @param msg_id ID of the message the packet belongs to, counted over the whole connection.
+ * @param offset Offset of the data in the message, in bytes (64 bits, for messages larger than 4 GB).
+ * @param ack_seq_num With the ACK flag, the last packet received in order (cumulative acknowledgement).
+ * @param sack With the ACK flag, which of the 32 packets after the missing one were received out of order (selective acknowledgement hint).
  * @param length Length of the data in bytes, without the header.
  * @param checksum Checksum of the packet, including the header.
  * @param flags Flags of the packet.
  * @param _reserved Reserved for future use. Currently is set to 0.
- * @note This is the header of the RUDP packet, it is 12 bytes long.
+ * @param window With the ACK flag, how many packets after ack_seq_num the receiver has room for (flow control).
+ * @note This is the header of the RUDP packet, it is 32 bytes long.
  * @attention This is for internal use only, manipulating this directly can cause undefined behavior for the library.
  */
 struct RUDP_header
 {
 	/*
-	 * @brief Sequence number field.
-	 * @note Sequence number of the packet.
+	 * @brief Sequence number field.
+	 * @note Sequence number of the packet. Data packets of a connection are numbered from 1, and the numbers keep growing across messages (wrapping around at 2^32).
+	 */
+	uint32_t seq_num = 0;
+
+	/*
+	 * @brief Message ID field.
+	 * @note ID of the message the data packet belongs to. Messages of a connection are numbered from 1.
+	 */
+	uint32_t msg_id = 0;
+
+	/*
+	 * @brief Offset field.
+	 * @note Offset of the data of the packet in its message, in bytes. The receiver places the data by this offset, so packets don't have to be of the same size.
+	 */
+	uint64_t offset = 0;
+
+	/*
+	 * @brief Acknowledgement number field.
+	 * @note With the ACK flag, the sequence number of the last packet received in order, which acknowledges every packet up to it.
+	 * @note Data packets carry it too (piggybacked ACK), so a peer that sends data doesn't need separate ACK packets.
+	 */
+	uint32_t ack_seq_num = 0;
+
+	/*
+	 * @brief Selective acknowledgement hint field.
+	 * @note With the ACK flag, bit i is set if packet ack_seq_num + 2 + i was received (ack_seq_num + 1 is the one missing).
+	 */
+	uint32_t sack = 0;
+
+	/*
+	 * @brief Length field.
+	 * @note Length of the data in bytes.
+	 */
+	uint16_t length = 0;
+
+	/*
+	 * @brief Checksum field.
+	 * @note Checksum is calculated for the entire packet, including the header.
+	 */
+	uint16_t checksum = 0;
+
+	/*
+	 * @brief Flags field.
+	 * @note Possible flags:
+	 * @note RUDP_FLAG_SYN - connection is being established.
+	 * @note RUDP_FLAG_ACK - acknowledgement of data.
+	 * @note RUDP_FLAG_PSH - data is pushed to the application.
+	 * @note RUDP_FLAG_LAST - this is the last packet of the message.
+	 * @note RUDP_FLAG_FIN - connection is closing.
+	 * @note RUDP_FLAG_PROBE - path MTU probe.
+	 * @note RUDP_FLAG_BATCH - the payload holds several whole messages.
+	 * @note RUDP_FLAG_NAK - negative acknowledgement, the payload lists the packets to resend.
+	 */
+	uint8_t flags = 0;
+
+	/*
+	 * @brief Reserved field.
+	 * @note 1 byte reserved for future use.
+	 * @note Must be set to 0.
+	 */
+	uint8_t _reserved = 0;
+
+	/*
+	 * @brief Receive window field.
+	 * @note With the ACK flag, the number of packets (of the negotiated MTU) after ack_seq_num the receiver has room for. 0 asks the sender to stop until the window opens again.
+	 */
+	uint16_t window = 0;
+};
+
+/*
+ * @brief A range of sequence numbers in the payload of a NAK packet.
+ * @param first The first packet to resend.
+ * @param last The last packet to resend (inclusive).
+ * @note Both fields are in network byte order.
+ * @attention This is for internal use only, manipulating this directly can cause undefined behavior for the library.
+ */
+struct RUDP_NAK_range
+{
+	uint32_t first = 0;
+	uint32_t last = 0;
+};
+
+/*
+ * @brief A packet in the flight recorder.
+ * @param time_us When the packet was sent or received, in microseconds of the steady clock.
+ * @param size Size of the whole packet, in bytes.
+ * @param direction RUDP_FLIGHT_RECORDER_SENT or RUDP_FLIGHT_RECORDER_RECEIVED.
+ * @param header_size How many bytes of the packet were kept, at most the size of the RUDP header.
+ * @param header The first bytes of the packet as they were on the wire, in network byte order.
+ * @attention This is for internal use only, manipulating this directly can cause undefined behavior for the library.
+ */
+struct RUDP_flight_record
+{
+	uint64_t time_us = 0;
+	uint32_t size = 0;
+	uint8_t direction = 0;
+	uint8_t header_size = 0;
+	uint8_t header[sizeof(RUDP_header)] = {0};
+};
+
+/*
+ * @brief A slot of the flight recorder: a record stored as atomic words, guarded by a sequence number (a seqlock).
+ * @param seq 2 * n + 1 while packet n is written into the slot, 2 * n + 2 once it is complete.
+ * @param words The record, copied word by word.
+ * @note The application may copy the slot while the I/O engine overwrites it, the sequence number tells it whether the copy is intact.
+ * @attention This is for internal use only, manipulating this directly can cause undefined behavior for the library.
+ */
+struct RUDP_flight_recorder_slot
+{
+	static_assert(sizeof(RUDP_flight_record) % sizeof(uint64_t) == 0, "A flight record must be a whole number of words.");
+
+	std::atomic<uint64_t> seq{0};
+	std::atomic<uint64_t> words[sizeof(RUDP_flight_record) / sizeof(uint64_t)] = {};
+};
+
+/*
+ * @brief The RUDP SYN packet.
+ * @param MTU Maximum Transmission Unit (MTU) of the network.
+ * @param timeout Maximum waiting time for an ACK / SYN-ACK packet in milliseconds.
+ * @param max_retries The maximum number of retries for a packet, before giving up.
+ * @param debug_mode Debug mode.
+ * @param window_size The number of packets the peer is willing to buffer ahead of the one it waits for.
+ * @param ack_ratio The number of in-order data packets the peer wants acknowledged by one ACK.
+ * @param ack_delay How long the peer is willing to wait for a delayed ACK, in microseconds.
+ * @note This is the SYN packet that is sent when a connection is being established, to inform the other side about the connection parameters and settings.
+ * @attention This is for internal use only, manipulating this directly can cause undefined behavior for the library.
+ */
+typedef struct _RUDP_SYN_packet
+{
+	uint16_t MTU = RUDP_MTU_DEFAULT;
+	uint16_t timeout = RUDP_SOCKET_TIMEOUT_DEFAULT;
+	uint16_t max_retries = RUDP_MAX_RETRIES_DEFAULT;
+	uint16_t debug_mode = 0;
+	uint16_t window_size = RUDP_WINDOW_SIZE_DEFAULT;
+	uint16_t ack_ratio = RUDP_ACK_RATIO_DEFAULT;
+	uint16_t ack_delay = RUDP_ACK_DELAY_DEFAULT;
+} RUDP_SYN_packet;
+
+struct RUDP_send_request;
+
+/*
+ * @brief A slot of the send window, holds a packet until it is acknowledged.
+ * @attention This is for internal use only, manipulating this directly can cause undefined behavior for the library.
+ */
+struct RUDP_tx_slot
+{
+	/*
+	 * @brief The packet (header and payload), allocated once for the MTU.
+	 */
+	std::vector<uint8_t> packet;
+
+	/*
+	 * @brief Number of bytes of the packet in use.
+	 */
+	uint32_t size = 0;
+
+	/*
+	 * @brief The request the packet belongs to, and the offset right after its payload in the message (used for progress reports).
+	 */
+	RUDP_send_request *request = nullptr;
+	uint64_t end_offset = 0;
+
+	/*
+	 * @brief When the packet was last sent.
+	 */
+	std::chrono::steady_clock::time_point sent_at;
+
+	/*
+	 * @brief When the packet was first sent, used for phase timing.
+	 */
+	std::chrono::steady_clock::time_point first_sent_at;
+
+	/*
+	 * @brief Number of times the packet was sent.
+	 */
+	size_t tries = 0;
+
+	/*
+	 * @brief True once the packet was retransmitted before its timeout (duplicate ACKs, the SACK hint or a NAK), so it isn't again.
+	 */
+	bool fast_retransmitted = false;
+};
+
+/*
+ * @brief The state of a send request.
+ * @note RUDP_REQUEST_PENDING - the request is queued or being transmitted by the I/O engine.
+ * @note RUDP_REQUEST_DONE - all the packets of the message were acknowledged by the peer.
+ * @note RUDP_REQUEST_CLOSED - the connection was closed before the message was delivered.
+ * @note RUDP_REQUEST_FAILED - the message could not be delivered, see the error field.
+ */
+enum RUDP_request_state
+{
+	RUDP_REQUEST_PENDING = 0,
+	RUDP_REQUEST_DONE,
+	RUDP_REQUEST_CLOSED,
+	RUDP_REQUEST_FAILED
+};
+
+/*
+ * @brief A send request (message descriptor), passed from the application threads to the I/O engine.
+ * @note A blocking request lives on the stack of the sending thread, which waits until the state is no longer pending.
+ * @note A detached request (sendAsync) owns a copy of the message and is deleted by the I/O engine once it completes.
+ * @attention This is for internal use only, manipulating this directly can cause undefined behavior for the library.
+ */
+struct RUDP_send_request
+{
+	/*
+	 * @brief The message to send, owned by the application.
+	 */
+	const uint8_t *data = nullptr;
+
+	/*
+	 * @brief Size of the message in bytes.
+	 */
+	uint64_t size = 0;
+
+	/*
+	 * @brief True if nobody waits for the request, the I/O engine deletes it once it completes.
+	 */
+	bool detached = false;
+
+	/*
+	 * @brief The copy of the message of a detached request, data points into it.
+	 */
+	std::vector<uint8_t> storage;
+
+	/*
+	 * @brief The message ID, assigned by the I/O engine.
+	 */
+	uint32_t msg_id = 0;
+
+	/*
+	 * @brief Sequence number of the last packet of the message, valid once packetized is true.
+	 */
+	uint32_t last_seq_num = 0;
+
+	/*
+	 * @brief True once all the packets of the message were put in the send window.
+	 */
+	bool packetized = false;
+
+	/*
+	 * @brief When send() or sendAsync() was called, used for the message latency histogram.
+	 */
+	std::chrono::steady_clock::time_point submitted_at;
+
+	/*
+	 * @brief When the I/O engine took the request from the send queue, used to bound how long a buffered message waits.
+	 */
+	std::chrono::steady_clock::time_point staged_at;
+
+	/*
+	 * @brief The state of the request, see RUDP_request_state.
+	 */
+	std::atomic<int> state{RUDP_REQUEST_PENDING};
+
+	/*
+	 * @brief Number of bytes sent, valid once the state is RUDP_REQUEST_DONE.
+	 */
+	int64_t result = 0;
+
+	/*
+	 * @brief The error message, valid once the state is RUDP_REQUEST_FAILED.
+	 */
+	std::string error;
+};
+/*
+ * @brief A class that represents a Reliable UDP socket.
+ * @attention Only use this internally in the library. For external usage, use the wrapper class RUDP_Socket (C++) or RUDP_socket (C).
+ */
+class RUDP_Socket_p
+{
+private:
+	/*
+	 * @brief UDP socket file descriptor
+	 */
+	SOCKET m_socketHandle = INVALID_SOCKET;
+
+	/*
+	 * @brief True if the RUDP socket acts like a server, false for client.
+	 */
+	bool m_isServer = false;
+
+	/*
+	 * @brief True if there is an active connection, false otherwise.
+	 * @note Atomic, as the I/O engine clears it when the peer closes the connection.
+	 */
+	std::atomic<bool> m_isConnected{false};
+
+	/*
+	 * @brief True for debug mode (slower), false for normal mode.
+	 */
+	bool m_debugMode = false;
+
+	/*
+	 * @brief Destination address (IPv4).
+	 * @note Client fills it when it connects via rudp_connect(), server fills it when it accepts a connection via rudp_accept().
+	 */
+	struct sockaddr_in m_destinationAddress4;
+
+	/*
+	 * @brief Whether the UDP socket itself is connected to the destination address.
+	 * @note A connected socket uses plain send() / recv(), and the kernel drops packets from other sources before they reach us.
+	 * @note Client sockets connect before the handshake and stay connected, as dissolving the association also releases their (automatically bound) port.
+	 * @note Server sockets connect once the handshake is done, and go back to accepting any source when the next accept() starts.
+	 */
+	bool m_socketConnected = false;
+
+	/*
+	 * @brief The MTU (Maximum Transmission Unit) of the network.
+	 * @attention This value is used to calculate the maximum size of the data in a packet, be careful when changing it.
+	 */
+	uint16_t m_protocolMTU;
+
+	/*
+	 * @brief Maximum waiting time for an ACK / SYN-ACK packet in milliseconds.
+	 */
+	uint16_t m_protocolTimeout;
+
+	/*
+	 * @brief The maximum number of retries for a packet, before giving up.
+	 */
+	uint16_t m_protocolMaximumRetries;
+
+	/*
+	 * @brief The MTU of the peer, in case the peer has a smaller MTU.
+	 * @note Atomic, as forceUseOwnMTU() changes it while the I/O engine reads it.
+	 */
+	std::atomic<uint16_t> m_peersMTU{0};
+
+	/*
+	 * @brief The number of packets that can be in flight, see RUDP_WINDOW_SIZE_DEFAULT.
+	 */
+	uint16_t m_windowSize = RUDP_WINDOW_SIZE_DEFAULT;
+
+	/*
+	 * @brief The window size of the peer, the sender uses the smaller of the two.
+	 */
+	uint16_t m_peersWindowSize = 0;
+
+	/*
+	 * @brief The number of in-order data packets acknowledged by one ACK, see RUDP_ACK_RATIO_DEFAULT.
+	 */
+	uint16_t m_ackRatio = RUDP_ACK_RATIO_DEFAULT;
+
+	/*
+	 * @brief How long an ACK may be held back, in microseconds, see RUDP_ACK_DELAY_DEFAULT.
+	 */
+	uint16_t m_ackDelay = RUDP_ACK_DELAY_DEFAULT;
+
+	/*
+	 * @brief The ACK ratio and delay of the peer, the receiver uses the smaller of the two.
+	 */
+	uint16_t m_peersAckRatio = 0;
+	uint16_t m_peersAckDelay = 0;
+
+	/*
+	 * @brief True to discover the path MTU while connected, see setPathMTUDiscovery().
+	 */
+	bool m_pathMTUDiscovery = true;
+
+	/*
+	 * @brief The largest packet size the sender currently uses, starts as the smaller of the two MTUs and moves with path MTU discovery.
+	 * @note Atomic, as the I/O engine changes it while the application may read it.
+	 */
+	std::atomic<uint16_t> m_pathMTU{0};
+
+	/*
+	 * @brief True to coalesce small messages into shared packets, see setSendBuffering().
+	 * @note The send buffering settings are atomic, the application may change them while the I/O engine reads them.
+	 */
+	std::atomic<bool> m_sendBuffering{false};
+
+	/*
+	 * @brief How long a small message may wait for more messages to share its packet, in milliseconds, see RUDP_SEND_BUFFER_DELAY_DEFAULT.
+	 */
+	std::atomic<uint16_t> m_sendBufferDelay{RUDP_SEND_BUFFER_DELAY_DEFAULT};
+
+	/*
+	 * @brief True while partial packets are held back, see cork().
+	 */
+	std::atomic<bool> m_sendCorked{false};
+
+	/*
+	 * @brief The most bytes per second the sender puts on the wire, 0 for no limit, see setMaxRate().
+	 * @note Atomic, the application may change it while the I/O engine reads it.
+	 */
+	std::atomic<uint64_t> m_maxRate{RUDP_MAX_RATE_DEFAULT};
+
+	/*
+	 * @brief The most bytes of received messages that may wait for the application, see setRecvWindow().
+	 * @note Atomic, the application may change it while the I/O engine reads it.
+	 */
+	std::atomic<uint64_t> m_recvWindow{RUDP_RECV_WINDOW_DEFAULT};
+
+	/*
+	 * @brief True to let the kernel pace the packets (SO_TXTIME), see setKernelPacing().
+	 */
+	bool m_kernelPacing = false;
+
+	/*
+	 * @brief True to size the kernel socket buffers for the window and grow them on drops, see setBufferAutoTuning().
+	 */
+	bool m_bufferAutoTuning = true;
+
+	/*
+	 * @brief Set by flush() to make the I/O engine send the held back messages right away.
+	 */
+	std::atomic<bool> m_sendFlush{false};
+
+	/*
+	 * @brief Set by forceUseOwnMTU() to make the I/O engine move the path MTU, the byte budget and the probe search to our own MTU.
+	 */
+	std::atomic<bool> m_useOwnMTU{false};
+
+/* I/O engine */
+private:
+	/*
+	 * @brief The I/O engine thread, owns the socket while a connection is active.
+	 * @note The engine routes ACK packets to the sender state and data packets to the receiver state, so send() and recv() can run in parallel.
+	 */
+	std::thread m_engineThread;
+
+	/*
+	 * @brief True while the I/O engine thread is running.
+	 */
+	std::atomic<bool> m_engineRunning{false};
+
+	/*
+	 * @brief Set by the application to ask the I/O engine to stop.
+	 */
+	std::atomic<bool> m_engineStop{false};
+
+	/*
+	 * @brief Set by disconnect() to ask the I/O engine to send everything queued so far, wait for the peer to acknowledge it, and then stop.
+	 * @note m_engineDrainUntil is set before it, the engine gives up on the rest of the data once it passes.
+	 */
+	std::atomic<bool> m_engineDraining{false};
+	std::chrono::steady_clock::time_point m_engineDrainUntil;
+
+	/*
+	 * @brief Number of messages the I/O engine completed as closed or failed when it stopped, without the peer acknowledging them.
+	 * @note Written by the engine before it exits, read only once the engine thread is joined.
+	 */
+	uint64_t m_engineDiscarded = 0;
+
+	/*
+	 * @brief Number of sending threads currently handing a request to the I/O engine.
+	 * @note The engine waits for this to drop to zero before it completes the leftover requests on exit.
+	 */
+	std::atomic<int> m_sendersInside{0};
+
+	/*
+	 * @brief A loopback UDP socket connected to itself, used to wake up the I/O engine from poll().
+	 */
+	SOCKET m_wakeSocket = INVALID_SOCKET;
+
+	/*
+	 * @brief True if a wake up datagram is already on its way to the I/O engine.
+	 */
+	std::atomic<bool> m_wakePending{false};
+
+	/*
+	 * @brief True while received messages wait in m_rxBacklog, so recv() wakes up the I/O engine to hand them over.
+	 */
+	std::atomic<bool> m_rxBacklogged{false};
+
+	/*
+	 * @brief Number of bytes of complete messages the application didn't read yet (in m_rxBacklog and m_recvQueue).
+	 * @note The I/O engine adds each message as it completes, recv() takes it off once the message is read.
+	 */
+	std::atomic<uint64_t> m_rxBufferedBytes{0};
+
+	/*
+	 * @brief True while the window advertised to the peer is less than half open, so recv() wakes up the I/O engine to announce the room it makes.
+	 */
+	std::atomic<bool> m_rxWindowLow{false};
+
+	/*
+	 * @brief When the I/O engine of the current (or last) connection started and stopped, for getStats().
+	 * @note Set before m_engineRunning changes, so the application sees them once it sees the engine running (or stopped).
+	 */
+	std::chrono::steady_clock::time_point m_engineStartedAt;
+	std::chrono::steady_clock::time_point m_engineStoppedAt;
+
+	/*
+	 * @brief The error that stopped the I/O engine, empty if the engine stopped normally.
+	 * @note Guarded by m_waitMutex.
+	 */
+	std::string m_engineError;
+
+	/*
+	 * @brief Send requests from the sending threads to the I/O engine.
+	 */
+	RUDP_MPSC_Queue<RUDP_send_request *, RUDP_SEND_QUEUE_SIZE> m_sendQueue;
+
+	/*
+	 * @brief Complete messages from the I/O engine to the receiving thread.
+	 */
+	RUDP_SPSC_Queue<std::vector<uint8_t> *, RUDP_RECV_QUEUE_SIZE> m_recvQueue;
+
+	/*
+	 * @brief Mutex and condition variables used only to put the application threads to sleep, the data itself moves through the lock-free queues.
+	 */
+	std::mutex m_waitMutex;
+	std::condition_variable m_sendCondition;
+	std::condition_variable m_recvCondition;
+
+	/*
+	 * @brief The engine's receive buffer, large enough for any datagram.
+	 */
+	std::vector<uint8_t> m_engineBuffer;
+
+	/*
+	 * @brief The trace ring, nullptr if tracing is disabled.
+	 * @note Written by the I/O engine only. It is created and destroyed only while the socket isn't connected, and read under m_traceMutex.
+	 */
+	std::unique_ptr<RUDP_SPSC_Queue<RUDP_trace_event, RUDP_TRACE_RING_SIZE>> m_traceRing;
+	std::mutex m_traceMutex;
+
+	/*
+	 * @brief Number of events that found the trace ring full, reported by the next event that fits.
+	 */
+	uint64_t m_traceLost = 0;
+
+	/*
+	 * @brief True to time the phases of the hot path, see setPhaseTiming().
+	 */
+	bool m_phaseTiming = false;
+
+	/*
+	 * @brief Nanoseconds spent in each phase of the hot path and number of times it was timed, see RUDP_PHASE_*.
+	 * @note Written by the I/O engine only, atomic as the application may read them at any time.
+	 */
+	std::atomic<uint64_t> m_phaseNs[RUDP_PHASE_COUNT] = {};
+	std::atomic<uint64_t> m_phaseCount[RUDP_PHASE_COUNT] = {};
+
+	/*
+	 * @brief The flight recorder, the headers of the last RUDP_FLIGHT_RECORDER_SIZE packets sent and received, always on.
+	 * @note Written by one thread at a time: the I/O engine, or the application thread during the handshakes, while the engine isn't running.
+	 * @note m_flightRecorderNext counts the packets recorded, each slot tells a reader whether it was overwritten while the reader copied it.
+	 */
+	RUDP_flight_recorder_slot m_flightRecorder[RUDP_FLIGHT_RECORDER_SIZE];
+	std::atomic<uint64_t> m_flightRecorderNext{0};
+
+	/*
+	 * @brief The file the flight recorder is dumped to when the connection fails, empty if it isn't dumped.
+	 */
+	std::string m_flightRecorderFile;
+
+	/*
+	 * @brief The progress callback and its user data, nullptr if progress isn't reported.
+	 * @note Guarded by m_progressMutex, as the application may replace it while the I/O engine reports progress.
+	 */
+	std::mutex m_progressMutex;
+	RUDP_progress_callback m_progressCallback = nullptr;
+	void *m_progressUserData = nullptr;
+
+	/* Sender state, touched only by the I/O engine. */
+
+	/*
+	 * @brief Requests with packets in the send window, oldest first. They complete in this order.
+	 */
+	std::deque<RUDP_send_request *> m_txInFlight;
+
+	/*
+	 * @brief The request being split into packets, nullptr if none (it is also the newest request in m_txInFlight).
+	 */
+	RUDP_send_request *m_txRequest = nullptr;
+
+	/*
+	 * @brief Number of bytes of m_txRequest already put in the send window.
+	 */
+	uint64_t m_txOffset = 0;
+
+	/*
+	 * @brief Requests taken from the send queue that have no packet yet, oldest first (they are also the newest requests in m_txInFlight).
+	 * @note Only about one packet worth of messages is staged, the rest stays in the send queue so sendAsync() still sees it fill up.
+	 */
+	std::deque<RUDP_send_request *> m_txStaged;
+
+	/*
+	 * @brief Number of bytes the staged messages take in a BATCH packet, including their length prefixes.
+	 */
+	uint64_t m_txStagedBytes = 0;
+
+	/*
+	 * @brief True while the staged messages are held back for more, and until when (time_point::max() if there is no timer).
+	 */
+	bool m_txHolding = false;
+	std::chrono::steady_clock::time_point m_txHoldUntil;
+
+	/*
+	 * @brief The pacer's token bucket: bytes the sender may put on the wire now (negative while in debt), and when they were last counted.
+	 */
+	double m_txPaceTokens = 0;
+	std::chrono::steady_clock::time_point m_txPaceUpdatedAt;
+
+	/*
+	 * @brief True while the pacer holds the next packet back, and until when.
+	 */
+	bool m_txPaced = false;
+	std::chrono::steady_clock::time_point m_txPaceNextAt;
+
+	/*
+	 * @brief True if the kernel paces the packets of this connection (SO_TXTIME), and the departure time of the next new packet.
+	 */
+	bool m_txTimeEnabled = false;
+	std::chrono::steady_clock::time_point m_txNextDeparture;
+
+	/*
+	 * @brief True from a flush() until everything staged at the time is sent.
+	 */
+	bool m_txFlushing = false;
+
+	/*
+	 * @brief The send window, indexed by sequence number modulo the window size.
+	 */
+	std::vector<RUDP_tx_slot> m_txSlots;
+
+	/*
+	 * @brief The effective window size, the smaller of ours and the peer's.
+	 */
+	uint16_t m_txWindowSize = 0;
+
+	/*
+	 * @brief The next message ID and sequence number to assign, and the oldest unacknowledged sequence number.
+	 */
+	uint32_t m_txNextMsgId = 1;
+	uint32_t m_txNextSeqNum = 1;
+	uint32_t m_txUnackedSeqNum = 1;
+
+	/*
+	 * @brief Number of bytes in flight, and how many may be in flight.
+	 * @note The budget is the window size times the negotiated MTU, the peer sized its socket buffer for it.
+	 */
+	uint64_t m_txBytesInFlight = 0;
+	uint64_t m_txBytesBudget = 0;
+
+	/*
+	 * @brief Number of bytes the peer last said it has room for, counted from its last ACK (its receive window).
+	 */
+	uint64_t m_txPeerWindow = 0;
+
+	/*
+	 * @brief True while the peer's window is closed with nothing in flight, until when to wait before probing it, and the current wait.
+	 * @note Without data in flight no ACK would come to reopen the window, so a lost window update is recovered by sending one packet anyway.
+	 */
+	bool m_txPersisting = false;
+	std::chrono::steady_clock::time_point m_txPersistAt;
+	std::chrono::milliseconds m_txPersistInterval{0};
+
+	/*
+	 * @brief Number of duplicate ACKs received for the oldest unacknowledged packet.
+	 */
+	uint32_t m_txDupAcks = 0;
+
+	/*
+	 * @brief Number of bytes of the oldest in-flight message last reported to the progress callback.
+	 */
+	uint64_t m_txProgressReported = 0;
+
+	/*
+	 * @brief Counters of the sender over the whole connection, see getStats().
+	 * @note Atomic, the application may read them while the I/O engine counts.
+	 */
+	std::atomic<uint64_t> m_txActualPackets{0};
+	std::atomic<uint64_t> m_txActualBytes{0};
+	std::atomic<uint64_t> m_txRetryPackets{0};
+	std::atomic<uint64_t> m_txTimeouts{0};
+	std::atomic<uint64_t> m_txMessages{0};
+	std::atomic<uint64_t> m_txMessageBytes{0};
+
+	/*
+	 * @brief The smoothed round trip time and its variation (RFC 6298), in microseconds, 0 before the first sample.
+	 * @note Atomic, the application may read them while the I/O engine updates them.
+	 */
+	std::atomic<uint64_t> m_txSrtt{0};
+	std::atomic<uint64_t> m_txRttVar{0};
+
+	/*
+	 * @brief Histograms of the round trip time of every timed packet, and of the time from send() to the ACK of the message's last packet.
+	 * @note Recorded by the I/O engine, the application may take snapshots of them at any time.
+	 */
+	RUDP_Histogram m_txRttHistogram;
+	RUDP_Histogram m_txLatencyHistogram;
+
+	/* Path MTU discovery state (RFC 8899), touched only by the I/O engine. */
+
+	/*
+	 * @brief The largest confirmed and the smallest failed packet sizes of the current search.
+	 */
+	uint16_t m_probeLow = 0;
+	uint16_t m_probeHigh = 0;
+
+	/*
+	 * @brief Size and sequence number of the outstanding probe, the size is 0 if no probe is outstanding.
+	 * @note Probes have their own sequence numbers, apart from the data packets.
+	 */
+	uint16_t m_probeSize = 0;
+	uint32_t m_probeSeqNum = 0;
+
+	/*
+	 * @brief Number of times the outstanding probe was sent, and when it was last sent.
+	 */
+	size_t m_probeTries = 0;
+	std::chrono::steady_clock::time_point m_probeSentAt;
+
+	/*
+	 * @brief When to start the next search, if no search is running.
+	 */
+	std::chrono::steady_clock::time_point m_probeNextSearch;
+
+	/*
+	 * @brief True while a search is running.
+	 */
+	bool m_probeSearching = false;
+
+	/*
+	 * @brief The probe packet (header and padding).
+	 */
+	std::vector<uint8_t> m_probePacket;
+
+	/*
+	 * @brief True while the don't fragment bit is off, and the sequence number it goes back on at (once the peer acknowledged everything before it).
+	 * @note Packets built before the path MTU was lowered can't be split as their sequence numbers are taken, so they go out fragmented; no probes are sent meanwhile.
+	 */
+	bool m_txFragmenting = false;
+	uint32_t m_txFragmentUntil = 0;
+
+	/* Receiver state, touched only by the I/O engine. */
+
+	/*
+	 * @brief The message currently being reassembled and its ID, nullptr if no message is in progress.
+	 */
+	std::vector<uint8_t> *m_rxMessage = nullptr;
+	uint32_t m_rxMessageId = 0;
+
+	/*
+	 * @brief Messages waiting for room in m_recvQueue.
+	 */
+	std::deque<std::vector<uint8_t> *> m_rxBacklog;
+
+	/*
+	 * @brief The next expected sequence number.
+	 */
+	uint32_t m_rxExpectedSeqNum = 1;
+
+	/*
+	 * @brief Packets that arrived ahead of m_rxExpectedSeqNum (within our window), keyed by sequence number.
+	 */
+	std::map<uint32_t, std::vector<uint8_t>> m_rxOutOfOrder;
+
+	/*
+	 * @brief True if the kernel reports how many packets it dropped for lack of room in the socket receive buffer (SO_RXQ_OVFL), and the last count it reported.
+	 */
+	bool m_rxDropCounting = false;
+	uint32_t m_rxDropCountSeen = 0;
+
+	/*
+	 * @brief Number of packets the kernel dropped for lack of room in the socket receive buffer, over the whole connection.
+	 * @note Atomic, the application may read it while the I/O engine counts.
+	 */
+	std::atomic<uint64_t> m_rxKernelDrops{0};
+
+	/*
+	 * @brief The size of the socket receive buffer as reported by the kernel, grown with buffer auto-tuning when packets are dropped.
+	 */
+	uint32_t m_rxSocketBuffer = 0;
+
+	/*
+	 * @brief The highest sequence number seen so far (or reported as missing), so every gap is reported by a NAK only once.
+	 */
+	uint32_t m_rxHighestSeqNum = 0;
+
+	/*
+	 * @brief The receive window last advertised to the peer, in packets.
+	 */
+	uint16_t m_rxAdvertisedWindow = 0;
+
+	/*
+	 * @brief The negotiated ACK ratio and delay of this connection.
+	 */
+	uint16_t m_rxAckRatio = RUDP_ACK_RATIO_DEFAULT;
+	std::chrono::microseconds m_rxAckDelay{RUDP_ACK_DELAY_DEFAULT};
+
+	/*
+	 * @brief Number of in-order data packets received since the last ACK, and when the ACK for them is due.
+	 */
+	uint16_t m_rxUnacked = 0;
+	std::chrono::steady_clock::time_point m_rxAckDue;
+
+	/*
+	 * @brief True if the pending ACK covers the end of a message, held back for the reply to carry it.
+	 */
+	bool m_rxAckHeldLast = false;
+
+	/*
+	 * @brief True while the peer's messages get quick replies, so their ACKs are left to the replies (piggybacked).
+	 */
+	bool m_rxReplyExpected = false;
+
+	/*
+	 * @brief When the last message of the peer was completed, used to tell whether our next data is a reply.
+	 */
+	std::chrono::steady_clock::time_point m_rxMessageEndedAt;
+
+	/*
+	 * @brief Number of bytes of the message being reassembled last reported to the progress callback.
+	 */
+	uint64_t m_rxProgressReported = 0;
+
+	/*
+	 * @brief Counters of the receiver over the whole connection, see getStats().
+	 * @note Atomic, the application may read them while the I/O engine counts.
+	 */
+	std::atomic<uint64_t> m_rxActualPackets{0};
+	std::atomic<uint64_t> m_rxActualBytes{0};
+	std::atomic<uint64_t> m_rxDupPackets{0};
+	std::atomic<uint64_t> m_rxChecksumFailures{0};
+	std::atomic<uint64_t> m_rxMessages{0};
+
+private:
+	/*
+	 * @brief A checksum function that returns 16 bit checksum for data.
+	 * @param data The data to do the checksum for.
+	 * @param bytes The length of the data in bytes.
+	 * @return The checksum itself as 16 bit unsigned number.
+	 * @attention This is an internal method, its not exposed to the user.
+	 */
+	static uint16_t _calculate_checksum(void *data, uint32_t data_size);
+
+
+	/*
+	 * @brief Prints a socket error message.
+	 * @param message The message to be printed.
+	 * @param throw_exception True to throw an exception, false otherwise.
+	 * @attention This is an internal method, its not exposed to the user.
+	 */
+	void _print_socket_error(std::string message, bool throw_exception = false);
+
+	/*
+	 * @brief Sends a control packet (SYN, ACK, FIN) to the connected peer.
+	 * @param flags Flags to be set in the control packet.
+	 * @param seq_num Sequence number of the control packet.
+	 * @param destination Destination address. Use nullptr for the connected peer (if the socket is connected).
+	 * @param destination_size Size of the destination address. Ignored if destination is nullptr.
+	 * @note This function doesn't actually check if the packet is received by the peer.
+	 * @attention This is an internal method, its not exposed to the user.
+	 */
+	void _send_control_packet(uint8_t flags, uint32_t seq_num, struct sockaddr *destination, uint32_t destination_size);
+
+	/*
+	 * @brief Dumps the flight recorder to the file set by setFlightRecorderFile(), if any, after the connection failed.
+	 * @note Reports the outcome on the standard error, it doesn't throw.
+	 * @attention This is an internal method, its not exposed to the user.
+	 */
+	void _flight_recorder_dump_on_failure();
+
+	/*
+	 * @brief Checks if the packet is valid.
+	 * @param packet The packet to be checked.
+	 * @param packet_size Size of the packet in bytes.
+	 * @param expected_flags Expected flags in the packet.
+	 * @return 1 if the packet is valid, 0 if not, -1 if the packet if a FIN packet.
+	 * @attention This is an internal method, its not exposed to the user.
+	 */
+	int _check_packet_validity(void *packet, uint32_t packet_size, uint8_t expected_flags);
+
+	/*
+	 * @brief Switches a socket between blocking and non-blocking mode.
+	 * @param socket The socket to switch.
+	 * @param non_blocking True for non-blocking mode, false for blocking mode.
+	 * @attention This is an internal method, its not exposed to the user.
+	 */
+	void _set_non_blocking(SOCKET socket, bool non_blocking);
+
+	/*
+	 * @brief Sets or clears the don't fragment bit on the outgoing packets of a socket.
+	 * @param socket The socket.
+	 * @param dont_fragment True to never fragment (path MTU discovery), false to let the IP layer fragment large packets.
+	 * @return True on success, false if the platform doesn't support it.
+	 * @attention This is an internal method, its not exposed to the user.
+	 */
+	bool _set_dont_fragment(SOCKET socket, bool dont_fragment);
+
+	/*
+	 * @brief Lets the packets of a socket carry a departure time (SO_TXTIME, on the monotonic clock), for the kernel to pace them.
+	 * @param socket The socket.
+	 * @return True on success, false if the platform doesn't support it.
+	 * @attention This is an internal method, its not exposed to the user.
+	 */
+	bool _set_txtime(SOCKET socket);
+
+	/*
+	 * @brief Grows a kernel socket buffer to at least the given size, past the system limit if the process is privileged (SO_RCVBUFFORCE / SO_SNDBUFFORCE).
+	 * @param socket The socket.
+	 * @param receive True for the receive buffer (SO_RCVBUF), false for the send buffer (SO_SNDBUF).
+	 * @param bytes The size to grow to, in bytes, as the kernel counts it (with its overhead). A buffer that is already as large is left as is.
+	 * @return The size of the buffer afterwards as reported by the kernel, or 0 if it can't be read.
+	 * @attention This is an internal method, its not exposed to the user.
+	 */
+	uint32_t _grow_socket_buffer(SOCKET socket, bool receive, uint32_t bytes);
+
+	/*
+	 * @brief Asks the kernel to report, with each received packet, how many packets it dropped as the socket receive buffer was full (SO_RXQ_OVFL).
+	 * @param socket The socket.
+	 * @return True on success, false if the platform doesn't support it.
+	 * @attention This is an internal method, its not exposed to the user.
+	 */
+	bool _set_drop_counting(SOCKET socket);
+
+	/*
+	 * @brief Connects the UDP socket to the destination address, or dissolves that association.
+	 * @param connect True to connect the socket to m_destinationAddress4, false to accept packets from any source again.
+	 * @return True on success, false if the socket can't be connected.
+	 * @attention This is an internal method, its not exposed to the user.
+	 */
+	bool _connect_socket(bool connect);
+
+	/*
+	 * @brief Starts the I/O engine thread, called once the handshake is done.
+	 * @throws `std::runtime_error` if the wake up socket can't be created.
+	 * @attention This is an internal method, its not exposed to the user.
+	 */
+	void _engine_start();
+
+	/*
+	 * @brief Stops the I/O engine thread and waits for it to exit.
+	 * @param drain True to let the engine send everything queued so far and wait for the peer to acknowledge it first, for at most the timeout times the maximum number of retries.
+	 * @note Pending send requests are completed as closed, and counted in m_engineDiscarded.
+	 * @attention This is an internal method, its not exposed to the user.
+	 */
+	void _engine_stop(bool drain);
+
+	/*
+	 * @brief Hands a send request to the I/O engine.
+	 * @param request The request to hand over.
+	 * @param wait_for_room True to wait for room in the send queue, false to give up if it is full.
+	 * @return True if the request was queued, false if the queue is full.
+	 * @throws `std::runtime_error` if the I/O engine isn't running.
+	 * @attention This is an internal method, its not exposed to the user.
+	 */
+	bool _engine_submit(RUDP_send_request *request, bool wait_for_room);
+
+	/*
+	 * @brief Wakes up the I/O engine if it is waiting in poll().
+	 * @attention This is an internal method, its not exposed to the user.
+	 */
+	void _engine_wake();
+
+	/*
+	 * @brief The main loop of the I/O engine thread.
+	 * @attention This is an internal method, its not exposed to the user.
+	 */
+	void _engine_main();
+
+	/*
+	 * @brief Reads and dispatches all the datagrams waiting on the socket.
+	 * @attention This is an internal method, its not exposed to the user.
+	 */
+	void _engine_receive();
+
+	/*
+	 * @brief Counts the packets the kernel dropped for lack of room in the socket receive buffer, and grows the buffer with buffer auto-tuning.
+	 * @param drop_count The number of drops of the socket so far, as reported by the kernel with the last packet (SO_RXQ_OVFL).
+	 * @attention This is an internal method, its not exposed to the user.
+	 */
+	void _engine_count_drops(uint32_t drop_count);
+
+	/*
+	 * @brief Records a trace event, if tracing is enabled.
+	 * @param type The type of the event, see RUDP_trace_type.
+	 * @param reason The reason of the event, see RUDP_trace_reason.
+	 * @param seq_num The sequence number of the packet, if any.
+	 * @param size The size of the packet, if any.
+	 * @param value A value that depends on the type of the event.
+	 * @note Kept inline, so a disabled trace costs a single branch.
+	 * @attention This is an internal method, its not exposed to the user.
+	 */
+	void _engine_trace(uint8_t type, uint8_t reason, uint32_t seq_num, uint16_t size, uint64_t value) {
+		if (m_traceRing != nullptr) _engine_trace_record(type, reason, seq_num, size, value);
+	}
+
+	/*
+	 * @brief Writes a trace event into the trace ring, see _engine_trace().
+	 * @attention This is an internal method, its not exposed to the user.
+	 */
+	void _engine_trace_record(uint8_t type, uint8_t reason, uint32_t seq_num, uint16_t size, uint64_t value);
+
+	/*
+	 * @brief Checks if the phases of the hot path are timed.
+	 * @return True if phase timing is built in and enabled, false otherwise.
+	 * @attention This is an internal method, its not exposed to the user.
+	 */
+	bool _phase_timing() const { return (RUDP_PHASE_TIMING && m_phaseTiming); }
+
+	/*
+	 * @brief Starts timing a phase of the hot path.
+	 * @return The time in nanoseconds, or 0 if phase timing is disabled, then the phase isn't timed.
+	 * @note Kept inline, so disabled phase timing costs a single branch, and nothing at all if it isn't built in.
+	 * @attention This is an internal method, its not exposed to the user.
+	 */
+	uint64_t _phase_start() const {
+		if (!_phase_timing()) return 0;
+		return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	/*
+	 * @brief Ends timing a phase of the hot path, and counts its time.
+	 * @param phase The phase, RUDP_PHASE_*.
+	 * @param start What _phase_start() (or the previous _phase_end()) returned.
+	 * @return The time in nanoseconds, to time the next phase from it, or 0 if the phase isn't timed.
+	 * @attention This is an internal method, its not exposed to the user.
+	 */
+	uint64_t _phase_end(int phase, uint64_t start) {
+		if (!_phase_timing() || start == 0) return 0;
+
+		uint64_t now = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+
+		_phase_add(phase, now - start);
+		return now;
+	}
+
+	/*
+	 * @brief Counts time spent in a phase of the hot path.
+	 * @param phase The phase, RUDP_PHASE_*.
+	 * @param ns The time in nanoseconds.
+	 * @note Only the I/O engine writes the counters, so a plain load and store is enough.
+	 * @attention This is an internal method, its not exposed to the user.
+	 */
+	void _phase_add(int phase, uint64_t ns) {
+		m_phaseNs[phase].store(m_phaseNs[phase].load(std::memory_order_relaxed) + ns, std::memory_order_relaxed);
+		m_phaseCount[phase].store(m_phaseCount[phase].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	}
+
+	/*
+	 * @brief Records a packet in the flight recorder.
+	 * @param direction RUDP_FLIGHT_RECORDER_SENT or RUDP_FLIGHT_RECORDER_RECEIVED.
+	 * @param packet The packet, as it is on the wire.
+	 * @param size The size of the packet, nothing is recorded if it is not positive (a failed send or receive).
+	 * @note Costs a timestamp and a copy of the header, so it is always on.
+	 * @attention This is an internal method, its not exposed to the user.
+	 */
+	void _flight_record(uint8_t direction, const void *packet, int size) {
+		if (size <= 0) return;
+
+		uint64_t next = m_flightRecorderNext.load(std::memory_order_relaxed);
+		RUDP_flight_recorder_slot &slot = m_flightRecorder[next % RUDP_FLIGHT_RECORDER_SIZE];
+		RUDP_flight_record record;
+		uint64_t words[sizeof(RUDP_flight_record) / sizeof(uint64_t)];
+
+		record.time_us = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+		record.size = (uint32_t)size;
+		record.direction = direction;
+		record.header_size = (uint8_t)std::min<int>(size, sizeof(RUDP_header));
+		memcpy(record.header, packet, record.header_size);
+		memcpy(words, &record, sizeof(words));
+
+		// Marks the slot as being written before any word changes, see dumpFlightRecorder().
+		slot.seq.store(2 * next + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+
+		for (size_t i = 0; i < sizeof(words) / sizeof(uint64_t); i++) slot.words[i].store(words[i], std::memory_order_relaxed);
+
+		slot.seq.store(2 * next + 2, std::memory_order_release);
+		m_flightRecorderNext.store(next + 1, std::memory_order_release);
+	}
+
+	/*
+	 * @brief Updates the smoothed round trip time and its variation with a new sample (RFC 6298).
+	 * @param rtt The time from sending a packet to receiving its ACK.
+	 * @attention This is an internal method, its not exposed to the user.
+	 */
+	void _engine_sample_rtt(std::chrono::steady_clock::duration rtt);
+
+	/*
+	 * @brief Handles an ACK packet, slides the send window and completes the messages it acknowledges.
+	 * @param header The header of the ACK packet.
+	 * @attention This is an internal method, its not exposed to the user.
+	 */
+	void _engine_handle_ack(RUDP_header *header);
+
+	/*
+	 * @brief Handles a data packet: takes it in order, or keeps it until the packets before it arrive, and acknowledges it.
+	 * @param packet The packet, including the header.
+	 * @note In-order packets are acknowledged together, every m_rxAckRatio packets or after m_rxAckDelay; anything else right away.
+	 * @note A packet that shows new missing packets before it is answered by a NAK for them instead of a plain ACK.
+	 * @attention This is an internal method, its not exposed to the user.
+	 */
+	void _engine_handle_data(uint8_t *packet);
+
+	/*
+	 * @brief Sends a cumulative ACK for everything received in order so far.
+	 * @attention This is an internal method, its not exposed to the user.
+	 */
+	void _engine_send_ack();
+
+	/*
+	 * @brief Puts the cumulative ACK, the SACK hint and the receive window in the header of an outgoing packet, which settles any pending ACK.
+	 * @param header The header of the packet, its checksum is calculated afterwards.
+	 * @param with_data True for a data packet (piggybacked ACK), false for an ACK packet.
+	 * @attention This is an internal method, its not exposed to the user.
+	 */
+	void _engine_fill_ack(RUDP_header *header, bool with_data);
+
+	/*
+	 * @brief Calculates the receive window, from the room left for messages the application didn't read yet.
+	 * @return Number of packets (of the negotiated MTU) the peer may send after the last one received in order, at most our window size.
+	 * @note While the application has read everything, the window is fully open, so a message larger than setRecvWindow() still gets through.
+	 * @attention This is an internal method, its not exposed to the user.
+	 */
+	uint16_t _engine_rx_window();
+
+	/*
+	 * @brief Retransmits the oldest unacknowledged packet once the peer reports enough packets after it, without waiting for the timeout.
+	 * @param sack The SACK hint of the last ACK.
+	 * @attention This is an internal method, its not exposed to the user.
+	 */
+	void _engine_fast_retransmit(uint32_t sack);
+
+	/*
+	 * @brief Handles a NAK packet, retransmits the packets it lists that are still in flight.
+	 * @param packet The packet, including the header.
+	 * @attention This is an internal method, its not exposed to the user.
+	 */
+	void _engine_handle_nak(const uint8_t *packet);
+
+	/*
+	 * @brief Sends a NAK for a range of missing packets, together with the cumulative ACK.
+	 * @param first The first missing packet.
+	 * @param last The last missing packet (inclusive).
+	 * @attention This is an internal method, its not exposed to the user.
+	 */
+	void _engine_send_nak(uint32_t first, uint32_t last);
+
+	/*
+	 * @brief Asks the peer to resend a packet that failed the checksum.
+	 * @param header The header of the corrupted packet, its sequence number is used only if it looks sane.
+	 * @attention This is an internal method, its not exposed to the user.
+	 */
+	void _engine_handle_corrupt(const RUDP_header *header);
+
+	/*
+	 * @brief Places an in-order data packet at its offset in the message being reassembled, and hands the message over if it is complete.
+	 * @param packet The packet, including the header.
+	 * @attention This is an internal method, its not exposed to the user.
 	 */
-	uint32_t seq_num = 0;
+	void _engine_accept_data(const uint8_t *packet);
 
 	/*
-	 * @brief Length field.
-	 * @note Length of the data in bytes.
+	 * @brief Splits a BATCH packet into its messages and hands them over.
+	 * @param packet The packet, including the header.
+	 * @attention This is an internal method, its not exposed to the user.
 	 */
-	uint16_t length = 0;
+	void _engine_accept_batch(const uint8_t *packet);
 
 	/*
-	 * @brief Checksum field.
-	 * @note Checksum is calculated for the entire packet, including the header.
+	 * @brief Splits queued messages into packets and sends them, as long as the send window has room.
+	 * @attention This is an internal method, its not exposed to the user.
 	 */
-	uint16_t checksum = 0;
+	void _engine_fill_window();
 
 	/*
-	 * @brief Flags field.
-	 * @note Possible flags:
-	 * @note RUDP_FLAG_SYN - connection is being established.
-	 * @note RUDP_FLAG_ACK - acknowledgement of data.
-	 * @note RUDP_FLAG_PSH - data is pushed to the application.
-	 * @note RUDP_FLAG_LAST - this is the last packet of the message.
-	 * @note RUDP_FLAG_FIN - connection is closing.
+	 * @brief Takes requests from the send queue until about one packet worth of messages is staged (or just one, without send buffering).
+	 * @return Number of staged messages, from the oldest, that fit whole in the next BATCH packet (0 without send buffering).
+	 * @attention This is an internal method, its not exposed to the user.
 	 */
-	uint8_t flags = 0;
+	uint32_t _engine_stage();
 
 	/*
-	 * @brief Reserved field.
-	 * @note 3 byte reserved for future use.
-	 * @note Must be set to 0.
+	 * @brief Checks with the pacer whether the next packet may go out now, refilling its token bucket at the maximum rate.
+	 * @return True to send the packet now; false to wait until m_txPaceNextAt.
+	 * @note With kernel pacing, the packet is handed over now unless the schedule already runs RUDP_TXTIME_HORIZON_USEC ahead.
+	 * @attention This is an internal method, its not exposed to the user.
 	 */
-	uint8_t _reserved[3] = {0};
-};
-/*
- * @brief The RUDP SYN packet.
- * @param MTU Maximum Transmission Unit (MTU) of the network.
- * @param timeout Maximum waiting time for an ACK / SYN-ACK packet in milliseconds.
- * @param max_retries The maximum number of retries for a packet, before giving up.
- * @param debug_mode Debug mode.
- * @note This is the SYN packet that is sent when a connection is being established, to inform the other side about the connection parameters and settings.
- * @attention This is for internal use only, manipulating this directly can cause undefined behavior for the library.
- */
-typedef struct _RUDP_SYN_packet
-{
-	uint16_t MTU = RUDP_MTU_DEFAULT;
-	uint16_t timeout = RUDP_SOCKET_TIMEOUT_DEFAULT;
-	uint16_t max_retries = RUDP_MAX_RETRIES_DEFAULT;
-	uint16_t debug_mode = 0;
-} RUDP_SYN_packet;
-/*
- * @brief A class that represents a Reliable UDP socket.
- * @attention Only use this internally in the library. For external usage, use the wrapper class RUDP_Socket (C++) or RUDP_socket (C).
- */
-class RUDP_Socket_p
-{
-private:
+	bool _engine_pace_ready();
+
 	/*
-	 * @brief UDP socket file descriptor
+	 * @brief Waits for a pacing gap shorter than poll() can time: sleeps through most of it and spins the rest.
+	 * @attention This is an internal method, its not exposed to the user.
 	 */
-	SOCKET m_socketHandle = INVALID_SOCKET;
+	void _engine_pace_wait();
 
 	/*
-	 * @brief True if the RUDP socket acts like a server, false for client.
+	 * @brief Decides whether the staged messages, which don't fill a packet, should wait for more (Nagle's algorithm, or a corked socket).
+	 * @return True to hold them back until m_txHoldUntil, an ACK, uncork() or flush(); false to send them now.
+	 * @attention This is an internal method, its not exposed to the user.
 	 */
-	bool m_isServer = false;
+	bool _engine_hold_batch();
 
 	/*
-	 * @brief True if there is an active connection, false otherwise.
+	 * @brief Builds a BATCH packet of the oldest staged messages in the send window, with the next sequence number.
+	 * @param records Number of staged messages to put in the packet, as returned by _engine_stage().
+	 * @attention This is an internal method, its not exposed to the user.
 	 */
-	bool m_isConnected = false;
+	void _engine_build_batch(uint32_t records);
 
 	/*
-	 * @brief True for debug mode (slower), false for normal mode.
+	 * @brief Builds the next packet of the current send request in the send window, with the next sequence number.
+	 * @attention This is an internal method, its not exposed to the user.
 	 */
-	bool m_debugMode = false;
+	void _engine_build_packet();
 
 	/*
-	 * @brief Destination address (IPv4).
-	 * @note Client fills it when it connects via rudp_connect(), server fills it when it accepts a connection via rudp_accept().
+	 * @brief Transmits (or retransmits) a packet of the send window.
+	 * @param seq_num Sequence number of the packet.
+	 * @throws `std::runtime_error` if the packet reached the maximum number of retries, the connection is considered lost.
+	 * @attention This is an internal method, its not exposed to the user.
 	 */
-	struct sockaddr_in m_destinationAddress4;
+	void _engine_transmit(uint32_t seq_num);
 
 	/*
-	 * @brief The MTU (Maximum Transmission Unit) of the network.
-	 * @attention This value is used to calculate the maximum size of the data in a packet, be careful when changing it.
+	 * @brief Completes a send request and wakes up the sending thread.
+	 * @param request The request to complete.
+	 * @param state The final state of the request.
+	 * @param error The error message, for RUDP_REQUEST_FAILED.
+	 * @attention This is an internal method, its not exposed to the user.
 	 */
-	uint16_t m_protocolMTU;
+	void _engine_complete_request(RUDP_send_request *request, int state, const std::string &error = "");
 
 	/*
-	 * @brief Maximum waiting time for an ACK / SYN-ACK packet in milliseconds.
+	 * @brief Starts a path MTU search between the given sizes.
+	 * @param low The largest size known to work.
+	 * @param high The largest size to try.
+	 * @attention This is an internal method, its not exposed to the user.
 	 */
-	uint16_t m_protocolTimeout;
+	void _engine_probe_start(uint16_t low, uint16_t high);
 
 	/*
-	 * @brief The maximum number of retries for a packet, before giving up.
+	 * @brief Gets the largest packet size path MTU discovery may use: the smaller of the two MTUs, and RUDP_PMTU_MAX at most.
+	 * @attention This is an internal method, its not exposed to the user.
 	 */
-	uint16_t m_protocolMaximumRetries;
+	uint16_t _engine_probe_max() const { return std::min<uint16_t>(std::min(m_protocolMTU, m_peersMTU.load()), RUDP_PMTU_MAX); }
 
 	/*
-	 * @brief The MTU of the peer, in case the peer has a smaller MTU.
+	 * @brief Sends the next probe of the search, retries the outstanding probe, or ends the search, as needed.
+	 * @attention This is an internal method, its not exposed to the user.
 	 */
-	uint16_t m_peersMTU = 0;
+	void _engine_probe();
 
-private:
 	/*
-	 * @brief A checksum function that returns 16 bit checksum for data.
-	 * @param data The data to do the checksum for.
-	 * @param bytes The length of the data in bytes.
-	 * @return The checksum itself as 16 bit unsigned number.
+	 * @brief Handles the acknowledgement of a probe, raises the path MTU to the probe's size.
+	 * @param header The header of the PROBE-ACK packet.
 	 * @attention This is an internal method, its not exposed to the user.
 	 */
-	static uint16_t _calculate_checksum(void *data, uint32_t data_size);
+	void _engine_handle_probe_ack(RUDP_header *header);
 
 	/*
-	 * @brief Checks if the packet source is valid (connected peer).
-	 * @param source The source address of the packet.
-	 * @param source_size Size of the source address.
-	 * @return 0 if the source is valid, non-zero if the source is invalid (also sends a FIN packet if the source is invalid).
-	*/
-	bool _check_packet_source(struct sockaddr *source, uint32_t source_size);
+	 * @brief Ends the outstanding probe as failed, the path can't carry packets of its size.
+	 * @attention This is an internal method, its not exposed to the user.
+	 */
+	void _engine_probe_failed();
 
 	/*
-	 * @brief Prints a socket error message.
-	 * @param message The message to be printed.
-	 * @param throw_exception True to throw an exception, false otherwise.
+	 * @brief Lowers the path MTU after the path stopped carrying packets of the current size, and searches again from RUDP_PMTU_BASE.
+	 * @param failed_size The packet size that failed.
 	 * @attention This is an internal method, its not exposed to the user.
 	 */
-	void _print_socket_error(std::string message, bool throw_exception = false);
+	void _engine_lower_path_mtu(uint16_t failed_size);
 
 	/*
-	 * @brief Sends a control packet (SYN, ACK, FIN) to the connected peer.
-	 * @param flags Flags to be set in the control packet.
-	 * @param seq_num Sequence number of the control packet.
-	 * @param destination Destination address. Use nullptr for the connected peer (if the socket is connected).
-	 * @param destination_size Size of the destination address. Ignored if destination is nullptr.
-	 * @note This function doesn't actually check if the packet is received by the peer.
+	 * @brief Turns the don't fragment bit off until the peer acknowledged every packet sent so far, see m_txFragmenting.
 	 * @attention This is an internal method, its not exposed to the user.
 	 */
-	void _send_control_packet(uint8_t flags, uint32_t seq_num, struct sockaddr *destination, uint32_t destination_size);
+	void _engine_allow_fragments();
 
 	/*
-	 * @brief Checks if the packet is valid.
-	 * @param packet The packet to be checked.
-	 * @param packet_size Size of the packet in bytes.
-	 * @param expected_flags Expected flags in the packet.
-	 * @return 1 if the packet is valid, 0 if not, -1 if the packet if a FIN packet.
+	 * @brief Applies forceUseOwnMTU(): the byte budget follows our own MTU, and the path MTU moves to it (or path MTU discovery searches up to it).
 	 * @attention This is an internal method, its not exposed to the user.
 	 */
-	int _check_packet_validity(void *packet, uint32_t packet_size, uint8_t expected_flags);
+	void _engine_use_own_mtu();
+
+	/*
+	 * @brief Calls the progress callback, if there is one.
+	 * @param sending True for a message being sent, false for a message being received.
+	 * @param bytes_done Number of bytes done so far.
+	 * @param bytes_total Size of the message, 0 if unknown.
+	 * @attention This is an internal method, its not exposed to the user.
+	 */
+	void _engine_report_progress(bool sending, uint64_t bytes_done, uint64_t bytes_total);
+
+	/*
+	 * @brief Moves complete messages to the receive queue and wakes up the receiving thread.
+	 * @attention This is an internal method, its not exposed to the user.
+	 */
+	void _engine_deliver();
 
 public:
 	/*
@@ -319,23 +1666,58 @@ public:
 	 * @brief Receives data from the connected peer.
 	 * @param buffer Buffer to store the received data.
 	 * @param buffer_size Size of the buffer.
-	 * @return Number of bytes received.
-	 * @throws `std::runtime_error` if the socket is not connected.
+	 * @return Number of bytes received, or 0 if the peer closed the connection (a message is never empty, see send()).
+	 * @note Blocks until the I/O engine has a complete message. If the message is larger than the buffer, the rest of it is discarded.
+	 * @note Can be called while another thread is inside send().
+	 * @throws `std::runtime_error` if the socket is not connected, or if the I/O engine failed.
 	 */
-	int recv(void *buffer, uint32_t buffer_size);
+	int64_t recv(void *buffer, uint64_t buffer_size);
 
 	/*
 	 * @brief Sends data to the connected peer.
 	 * @param buffer Buffer containing the data to be sent.
 	 * @param buffer_size Size of the buffer.
-	 * @return Number of bytes sent.
-	 * @throws `std::runtime_error` if the socket is not connected.
+	 * @return Number of bytes sent, or 0 if the peer closed the connection.
+	 * @note Blocks until the whole message is acknowledged by the peer.
+	 * @note Can be called from several threads at once, and while another thread is inside recv().
+	 * @throws `std::runtime_error` if the socket is not connected, if the buffer is empty or larger than RUDP_MAX_MESSAGE_SIZE, or if the maximum number of retries is reached.
+	 */
+	int64_t send(void *buffer, uint64_t buffer_size);
+
+	/*
+	 * @brief Queues data to be sent to the connected peer, without waiting for the network.
+	 * @param buffer Buffer containing the data to be sent, copied before the call returns.
+	 * @param buffer_size Size of the buffer.
+	 * @return Number of bytes queued, or 0 if the send queue is full (try again later).
+	 * @note Lock-free: any number of threads can queue messages at once, messages from the same thread are sent in order.
+	 * @note Delivery errors can't be reported back to the caller, they are printed in debug mode.
+	 * @throws `std::runtime_error` if the socket is not connected, or if the buffer is empty or larger than RUDP_MAX_MESSAGE_SIZE.
+	 */
+	int64_t sendAsync(const void *buffer, uint64_t buffer_size);
+
+	/*
+	 * @brief Holds back small messages until uncork() or flush(), so they share packets.
+	 * @note Full packets are still sent, and a message never waits longer than the send buffer delay (if not 0).
+	 * @note Can be called at any time, also before connecting.
+	 */
+	void cork();
+
+	/*
+	 * @brief Stops holding back small messages, and sends the ones held back so far.
+	 */
+	void uncork();
+
+	/*
+	 * @brief Sends the messages held back by send buffering or cork() right away, without waiting for more to share their packet.
+	 * @note Doesn't wait for the peer, use send() for that. Does nothing if the socket isn't connected.
 	 */
-	int send(void *buffer, uint32_t buffer_size);
+	void flush();
 
 	/*
 	 * @brief Disconnects from the connected peer.
-	 * @return True if the disconnection is successful, false otherwise.
+	 * @return True if the disconnection is successful, false if messages were left undelivered.
+	 * @note Sends everything queued so far first (by sendAsync() too, or held back by cork()) and waits for the peer to acknowledge it, for at most the timeout times the maximum number of retries.
+	 * @note Then stops the I/O engine, sends that still wait return 0.
 	 */
 	bool disconnect();
 
@@ -359,6 +1741,24 @@ public:
 	 */
 	uint16_t getMaxRetries() const { return m_protocolMaximumRetries; }
 
+	/*
+	 * @brief Gets the window size.
+	 * @return The number of packets that can be in flight (sent but not acknowledged yet).
+	 */
+	uint16_t getWindowSize() const { return m_windowSize; }
+
+	/*
+	 * @brief Gets the ACK ratio.
+	 * @return The number of in-order data packets acknowledged by one ACK.
+	 */
+	uint16_t getAckRatio() const { return m_ackRatio; }
+
+	/*
+	 * @brief Gets the ACK delay.
+	 * @return How long an ACK may be held back waiting for more data packets, in microseconds.
+	 */
+	uint16_t getAckDelay() const { return m_ackDelay; }
+
 	/*
 	 * @brief Gets the MTU of the peer.
 	 * @return The MTU of the peer, in case the peer has a smaller MTU.
@@ -369,6 +1769,123 @@ public:
 		return m_peersMTU;
 	}
 
+	/*
+	 * @brief Gets the path MTU.
+	 * @return The largest packet size currently used to send data, as found by path MTU discovery.
+	 * @throws `std::runtime_error` if the socket isn't connected.
+	 */
+	uint16_t getPathMTU() const {
+		if (!m_isConnected) throw std::runtime_error("Can't get the path MTU if the socket is not connected. Please make a connection with the peer first.");
+		return m_pathMTU;
+	}
+
+	/*
+	 * @brief Checks if path MTU discovery is enabled.
+	 * @return True if path MTU discovery is enabled, false otherwise.
+	 */
+	bool isPathMTUDiscovery() const { return m_pathMTUDiscovery; }
+
+	/*
+	 * @brief Checks if send buffering (coalescing of small messages) is enabled.
+	 * @return True if send buffering is enabled, false otherwise.
+	 */
+	bool isSendBuffering() const { return m_sendBuffering; }
+
+	/*
+	 * @brief Gets the send buffer delay.
+	 * @return How long a small message may wait for more messages to share its packet, in milliseconds (0 means no timer).
+	 */
+	uint16_t getSendBufferDelay() const { return m_sendBufferDelay; }
+
+	/*
+	 * @brief Gets the maximum send rate.
+	 * @return The most bytes per second the sender puts on the wire, 0 means no limit.
+	 */
+	uint64_t getMaxRate() const { return m_maxRate; }
+
+	/*
+	 * @brief Gets the receive window limit.
+	 * @return The most bytes of received messages that may wait for the application before the peer is asked to stop.
+	 */
+	uint64_t getRecvWindow() const { return m_recvWindow; }
+
+	/*
+	 * @brief Checks if kernel pacing (SO_TXTIME) is requested.
+	 * @return True if kernel pacing is requested, false otherwise.
+	 */
+	bool isKernelPacing() const { return m_kernelPacing; }
+
+	/*
+	 * @brief Checks if socket buffer auto-tuning is enabled.
+	 * @return True if buffer auto-tuning is enabled, false otherwise.
+	 */
+	bool isBufferAutoTuning() const { return m_bufferAutoTuning; }
+
+	/*
+	 * @brief Gets the statistics of the current (or last) connection.
+	 * @return The counters since the connection started, see RUDP_stats.
+	 * @note Only reads counters, so it is cheap enough to call often, from any thread.
+	 */
+	RUDP_stats getStats() const;
+
+	/*
+	 * @brief Gets a snapshot of the round trip time histogram of the current (or last) connection.
+	 * @return The round trip time of every packet sent once and acknowledged, in microseconds.
+	 */
+	RUDP_histogram getRttHistogram() const {
+		RUDP_histogram histogram;
+		m_txRttHistogram.snapshot(histogram);
+		return histogram;
+	}
+
+	/*
+	 * @brief Gets a snapshot of the message latency histogram of the current (or last) connection.
+	 * @return The time from send() (or sendAsync()) to the ACK of the message's last packet, in microseconds.
+	 */
+	RUDP_histogram getLatencyHistogram() const {
+		RUDP_histogram histogram;
+		m_txLatencyHistogram.snapshot(histogram);
+		return histogram;
+	}
+
+	/*
+	 * @brief Checks if tracing is enabled.
+	 * @return True if the I/O engine records trace events, false otherwise.
+	 */
+	bool isTracing() const { return m_traceRing != nullptr; }
+
+	/*
+	 * @brief Checks if phase timing is enabled.
+	 * @return True if the I/O engine times the phases of the hot path, false otherwise.
+	 */
+	bool isPhaseTiming() const { return m_phaseTiming; }
+
+	/*
+	 * @brief Reads the oldest trace events, and removes them from the trace ring.
+	 * @param events Where to store the events.
+	 * @param max_events The most events to read.
+	 * @return The number of events read, 0 if there are none or tracing is disabled.
+	 * @note The ring holds RUDP_TRACE_RING_SIZE events, the events that find it full are lost (and reported by a RUDP_TRACE_EVENTS_LOST event).
+	 * @throws `std::runtime_error` if the events pointer is null.
+	 */
+	uint32_t readTrace(RUDP_trace_event *events, uint32_t max_events);
+
+	/*
+	 * @brief Gets the file the flight recorder is dumped to when the connection fails.
+	 * @return The path of the file, empty if the flight recorder isn't dumped automatically.
+	 */
+	const char *getFlightRecorderFile() const { return m_flightRecorderFile.c_str(); }
+
+	/*
+	 * @brief Writes the flight recorder, the headers of the last RUDP_FLIGHT_RECORDER_SIZE packets sent and received, to a pcap file.
+	 * @param path The path of the file, it is overwritten.
+	 * @return The number of packets written, oldest first.
+	 * @note Can be called at any time, from any thread. Packets recorded while the file is written may be left out.
+	 * @note The link type is RUDP_FLIGHT_RECORDER_LINKTYPE (USER0), src/tools/RUDP_Wireshark.lua lets Wireshark dissect it.
+	 * @throws `std::runtime_error` if the path is null or the file can't be written.
+	 */
+	uint32_t dumpFlightRecorder(const char *path) const;
+
 	/*
 	 * @brief Checks if the socket is in debug mode.
 	 * @return True if the socket is in debug mode, false otherwise.
@@ -396,6 +1913,18 @@ public:
 	*/
 	void setDebugMode(bool debug_mode) { m_debugMode = debug_mode; }
 
+	/*
+	 * @brief Sets the progress callback.
+	 * @param callback The callback, or nullptr to stop reporting progress.
+	 * @param user_data A pointer passed back to the callback as is.
+	 * @note The callback is called from the I/O engine thread every RUDP_PROGRESS_INTERVAL bytes and once a message completes, so it must be quick and must not call back into the socket.
+	*/
+	void setProgressCallback(RUDP_progress_callback callback, void *user_data) {
+		std::lock_guard<std::mutex> lock(m_progressMutex);
+		m_progressCallback = callback;
+		m_progressUserData = user_data;
+	}
+
 	/*
 	 * @brief Sets the MTU (Maximum Transmission Unit) of the network.
 	 * @param MTU The MTU of the network.
@@ -434,14 +1963,192 @@ public:
 		m_protocolMaximumRetries = max_retries;
 	}
 
+	/*
+	 * @brief Sets the window size.
+	 * @param window_size The number of packets that can be in flight (sent but not acknowledged yet).
+	 * @note Messages share the window, so a larger window lets more messages be in flight back-to-back.
+	 * @attention This value can't be changed if the socket is connected, as it is negotiated with the peer (the smaller window is used).
+	 * @throws `std::runtime_error` if the socket is connected, or if the window size is 0.
+	*/
+	void setWindowSize(uint16_t window_size) {
+		if (m_isConnected) throw std::runtime_error("Can't change the window size while connected. Use disconnect() first.");
+		if (window_size < 1) throw std::runtime_error("Window size can't be smaller than 1 packet.");
+		m_windowSize = window_size;
+	}
+
+	/*
+	 * @brief Sets the ACK ratio.
+	 * @param ack_ratio The number of in-order data packets acknowledged by one ACK, default is RUDP_ACK_RATIO_DEFAULT.
+	 * @note Out-of-order and duplicate packets, and the last packet of a message, are always acknowledged right away, so loss recovery and send() don't wait for it.
+	 * @attention This value can't be changed if the socket is connected, as it is negotiated with the peer (the smaller ratio is used).
+	 * @throws `std::runtime_error` if the socket is connected, or if the ratio is 0.
+	*/
+	void setAckRatio(uint16_t ack_ratio) {
+		if (m_isConnected) throw std::runtime_error("Can't change the ACK ratio while connected. Use disconnect() first.");
+		if (ack_ratio < 1) throw std::runtime_error("ACK ratio can't be smaller than 1 packet.");
+		m_ackRatio = ack_ratio;
+	}
+
+	/*
+	 * @brief Sets the ACK delay.
+	 * @param ack_delay How long an ACK may be held back waiting for more data packets, in microseconds, default is RUDP_ACK_DELAY_DEFAULT.
+	 * @note 0 acknowledges every data packet right away, whatever the ACK ratio.
+	 * @attention This value can't be changed if the socket is connected, as it is negotiated with the peer (the shorter delay is used).
+	 * @throws `std::runtime_error` if the socket is connected.
+	*/
+	void setAckDelay(uint16_t ack_delay) {
+		if (m_isConnected) throw std::runtime_error("Can't change the ACK delay while connected. Use disconnect() first.");
+		m_ackDelay = ack_delay;
+	}
+
 	/*
 	 * @brief Forces the socket to use its own MTU, instead of the peer's MTU.
 	 * @attention This is experimental, as it can cause failures in some cases.
 	 * @attention Use this only if you know what you are doing.
+	 * @note The I/O engine moves to the new MTU shortly after, with path MTU discovery on it probes up to it first.
 	 * @throws `std::runtime_error` if the socket isn't connected.
 	*/
 	void forceUseOwnMTU() {
 		if (!m_isConnected) throw std::runtime_error("Can't force the socket to use its own MTU over the peer's MTU if the socket is not connected. Please make a connection with the peer first.");
 		m_peersMTU = m_protocolMTU;
+		m_useOwnMTU = true;
+
+		// Same handshake as flush(), the path MTU and the byte budget belong to the engine.
+		m_sendersInside++;
+		if (m_engineRunning) _engine_wake();
+		m_sendersInside--;
+	}
+
+	/*
+	 * @brief Enables or disables path MTU discovery.
+	 * @param enable True to fall back to smaller packets when the path stops carrying packets of the smaller of the two MTUs, and probe back up to it, false to always use the smaller of the two MTUs.
+	 * @note Enabled by default. When enabled, packets are sent with the don't fragment bit.
+	 * @attention This value can't be changed if the socket is connected.
+	 * @throws `std::runtime_error` if the socket is connected.
+	*/
+	void setPathMTUDiscovery(bool enable) {
+		if (m_isConnected) throw std::runtime_error("Can't change path MTU discovery while connected. Use disconnect() first.");
+		m_pathMTUDiscovery = enable;
+	}
+
+	/*
+	 * @brief Enables or disables send buffering (Nagle's algorithm).
+	 * @param enable True to coalesce small messages into shared packets, false to send every message in its own packets.
+	 * @note While data is unacknowledged, a message that doesn't fill a packet waits for more messages, for an ACK or for the send buffer delay, whichever comes first.
+	 * @note Each message keeps its boundaries, the peer receives them one by one as usual. Disabled by default.
+	 * @note Can be changed at any time, also while connected.
+	*/
+	void setSendBuffering(bool enable) {
+		m_sendBuffering = enable;
+		if (!enable) flush();
+	}
+
+	/*
+	 * @brief Sets the send buffer delay.
+	 * @param delay How long a small message may wait for more messages to share its packet, in milliseconds, default is RUDP_SEND_BUFFER_DELAY_DEFAULT.
+	 * @note 0 means no timer: with send buffering, a message waits until an ACK arrives; with cork(), until uncork() or flush().
+	 * @note Can be changed at any time, also while connected.
+	*/
+	void setSendBufferDelay(uint16_t delay) { m_sendBufferDelay = delay; }
+
+	/*
+	 * @brief Sets the maximum send rate, the sender's packets are then spread out evenly to keep under it.
+	 * @param rate The most bytes per second the sender puts on the wire (RUDP headers included), default is RUDP_MAX_RATE_DEFAULT (0, no limit).
+	 * @note Retransmissions count towards the rate too, but are never held back by it.
+	 * @note Can be changed at any time, also while connected.
+	*/
+	void setMaxRate(uint64_t rate) {
+		m_maxRate = rate;
+
+		// Same handshake as flush(), an engine waiting out a gap of the old rate has to see the new one.
+		m_sendersInside++;
+		if (m_engineRunning) _engine_wake();
+		m_sendersInside--;
+	}
+
+	/*
+	 * @brief Enables or disables kernel pacing: with a maximum rate, each packet carries its departure time (SO_TXTIME) and the kernel sends it on time.
+	 * @param enable True to hand the packet schedule to the kernel, false to pace in the I/O engine.
+	 * @note Disabled by default. Needs Linux and the fq qdisc on the outgoing interface, other qdiscs send the packets right away.
+	 * @note If the socket option is not available, the I/O engine paces the packets itself.
+	 * @attention This value can't be changed if the socket is connected.
+	 * @throws `std::runtime_error` if the socket is connected.
+	*/
+	void setKernelPacing(bool enable) {
+		if (m_isConnected) throw std::runtime_error("Can't change kernel pacing while connected. Use disconnect() first.");
+		m_kernelPacing = enable;
+	}
+
+	/*
+	 * @brief Enables or disables socket buffer auto-tuning.
+	 * @param enable True to grow the kernel socket buffers (SO_RCVBUF / SO_SNDBUF) to hold RUDP_SOCKET_BUFFER_WINDOWS send windows, and the receive buffer further whenever the kernel drops packets, false to keep the system defaults.
+	 * @note Enabled by default. The buffers only grow, up to RUDP_SOCKET_BUFFER_MAX, and past the system limits (net.core.rmem_max / wmem_max) only for privileged processes.
+	 * @attention This value can't be changed if the socket is connected.
+	 * @throws `std::runtime_error` if the socket is connected.
+	*/
+	void setBufferAutoTuning(bool enable) {
+		if (m_isConnected) throw std::runtime_error("Can't change buffer auto-tuning while connected. Use disconnect() first.");
+		m_bufferAutoTuning = enable;
+	}
+
+	/*
+	 * @brief Enables or disables tracing.
+	 * @param enable True to record the packet events of the I/O engine into a trace ring of RUDP_TRACE_RING_SIZE events, read with readTrace(), false to stop and drop the events not read yet.
+	 * @note Disabled by default. A disabled trace costs a single branch per event, an enabled one a timestamp and a copy of a small record.
+	 * @attention This value can't be changed if the socket is connected.
+	 * @throws `std::runtime_error` if the socket is connected.
+	*/
+	void setTracing(bool enable) {
+		if (m_isConnected || m_engineRunning) throw std::runtime_error("Can't change tracing while connected. Use disconnect() first.");
+
+		std::lock_guard<std::mutex> lock(m_traceMutex);
+
+		if (!enable) m_traceRing.reset();
+		else if (m_traceRing == nullptr) m_traceRing.reset(new RUDP_SPSC_Queue<RUDP_trace_event, RUDP_TRACE_RING_SIZE>());
+
+		m_traceLost = 0;
+	}
+
+	/*
+	 * @brief Enables or disables phase timing.
+	 * @param enable True to time the phases of the hot path (see RUDP_PHASE_*) into the phase_ns and phase_count counters of getStats(), false to stop.
+	 * @note Disabled by default. Disabled phase timing costs a single branch per phase, enabled two clock reads. It can also be left out of the library (make PHASE_TIMING=0).
+	 * @attention This value can't be changed if the socket is connected.
+	 * @throws `std::runtime_error` if the socket is connected, or if phase timing isn't built into the library.
+	*/
+	void setPhaseTiming(bool enable) {
+		if (m_isConnected || m_engineRunning) throw std::runtime_error("Can't change phase timing while connected. Use disconnect() first.");
+		if (enable && !RUDP_PHASE_TIMING) throw std::runtime_error("Phase timing isn't built into this library, build it with PHASE_TIMING=1.");
+		m_phaseTiming = enable;
+	}
+
+	/*
+	 * @brief Sets the file the flight recorder is dumped to when the connection fails, for example when a packet reached the maximum number of retries.
+	 * @param path The path of the file, nullptr or empty to not dump the flight recorder automatically.
+	 * @note Not set by default. The packets are recorded anyway, dumpFlightRecorder() writes them at any time.
+	 * @attention This value can't be changed if the socket is connected.
+	 * @throws `std::runtime_error` if the socket is connected.
+	*/
+	void setFlightRecorderFile(const char *path) {
+		if (m_isConnected || m_engineRunning) throw std::runtime_error("Can't change the flight recorder file while connected. Use disconnect() first.");
+		m_flightRecorderFile = (path == nullptr) ? "" : path;
+	}
+
+	/*
+	 * @brief Sets the receive window limit, the peer is asked to slow down to the pace of recv() once this much data waits to be read.
+	 * @param bytes The most bytes of received messages that may wait for the application, default is RUDP_RECV_WINDOW_DEFAULT.
+	 * @note The window advertised in each ACK shrinks as the unread messages (and the message being reassembled) fill up the limit, down to 0.
+	 * @note A message larger than the limit is still received whole, the window closes only while there are unread messages.
+	 * @note Can be changed at any time, also while connected.
+	 * @throws `std::runtime_error` if the limit is 0.
+	*/
+	void setRecvWindow(uint64_t bytes) {
+		if (bytes == 0) throw std::runtime_error("Receive window can't be 0 bytes.");
+		m_recvWindow = bytes;
+
+		// A larger limit may reopen a closed window, which the engine has to announce.
+		m_sendersInside++;
+		if (m_engineRunning) _engine_wake();
+		m_sendersInside--;
 	}
 };
\ No newline at end of file
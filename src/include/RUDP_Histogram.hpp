@@ -0,0 +1,191 @@
+/*
+ *  Reliable UDP implementation
+ *  Copyright (C) 2024  Roy Simanovich
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include "RUDP_Types.h"
+
+/*
+ * @brief Number of bits of the linear sub-buckets of a histogram, each power of two is split into 32 buckets, so a value is known within 1/32 (about 3%).
+ */
+#define RUDP_HISTOGRAM_SUB_BUCKET_BITS 5
+
+/*
+ * @brief Number of linear sub-buckets per power of two of a histogram.
+ */
+#define RUDP_HISTOGRAM_SUB_BUCKETS (1 << RUDP_HISTOGRAM_SUB_BUCKET_BITS)
+
+/*
+ * @brief The highest power of two a histogram tells apart, larger values share the last bucket.
+ */
+#define RUDP_HISTOGRAM_MAX_EXPONENT 31
+
+/*
+ * @brief A log-linear (HDR-style) histogram of durations in microseconds, recorded by one thread and read by any.
+ * @note Recording is a few relaxed loads and stores, no locks and no read-modify-write instructions.
+ * @note A snapshot taken while a value is recorded may miss that value, but it is always a valid histogram.
+ * @attention This is for internal use only, exactly one thread (the I/O engine) may call record() and reset().
+ */
+class RUDP_Histogram
+{
+	static_assert(RUDP_HISTOGRAM_BUCKETS == RUDP_HISTOGRAM_SUB_BUCKETS * (RUDP_HISTOGRAM_MAX_EXPONENT - RUDP_HISTOGRAM_SUB_BUCKET_BITS + 2), "RUDP_HISTOGRAM_BUCKETS doesn't match the bucket layout.");
+
+private:
+	/*
+	 * @brief Number of values in each bucket.
+	 */
+	std::atomic<uint64_t> m_buckets[RUDP_HISTOGRAM_BUCKETS];
+
+	/*
+	 * @brief The smallest and largest recorded values, UINT64_MAX and 0 if nothing was recorded.
+	 */
+	std::atomic<uint64_t> m_min{UINT64_MAX};
+	std::atomic<uint64_t> m_max{0};
+
+	/*
+	 * @brief Finds the bucket of a value.
+	 * @param value The value.
+	 * @return The index of the bucket.
+	 */
+	static uint32_t _bucket_of(uint64_t value) {
+		if (value < RUDP_HISTOGRAM_SUB_BUCKETS) return (uint32_t)value;
+
+		uint32_t exponent = 63 - (uint32_t)__builtin_clzll(value);
+
+		if (exponent > RUDP_HISTOGRAM_MAX_EXPONENT) return RUDP_HISTOGRAM_BUCKETS - 1;
+
+		uint32_t shift = exponent - RUDP_HISTOGRAM_SUB_BUCKET_BITS;
+
+		return (shift + 1) * RUDP_HISTOGRAM_SUB_BUCKETS + (uint32_t)(value >> shift) - RUDP_HISTOGRAM_SUB_BUCKETS;
+	}
+
+	/*
+	 * @brief Gets the highest value that falls into a bucket.
+	 * @param bucket The index of the bucket.
+	 * @return The highest value of the bucket.
+	 */
+	static uint64_t _bucket_highest(uint32_t bucket) {
+		if (bucket < RUDP_HISTOGRAM_SUB_BUCKETS) return bucket;
+
+		uint32_t shift = bucket / RUDP_HISTOGRAM_SUB_BUCKETS - 1;
+		uint64_t lowest = (uint64_t)(bucket % RUDP_HISTOGRAM_SUB_BUCKETS + RUDP_HISTOGRAM_SUB_BUCKETS) << shift;
+
+		return lowest + ((uint64_t)1 << shift) - 1;
+	}
+
+	/*
+	 * @brief Fills the percentiles of a snapshot from its buckets.
+	 * @param histogram The snapshot.
+	 */
+	static void _summarize(RUDP_histogram &histogram) {
+		histogram.p50_us = getPercentile(histogram, 50.0);
+		histogram.p90_us = getPercentile(histogram, 90.0);
+		histogram.p99_us = getPercentile(histogram, 99.0);
+		histogram.p999_us = getPercentile(histogram, 99.9);
+	}
+
+public:
+	RUDP_Histogram() {
+		for (auto &bucket : m_buckets) bucket.store(0, std::memory_order_relaxed);
+	}
+
+	/*
+	 * @brief Records a value.
+	 * @param value The value, in microseconds.
+	 */
+	void record(uint64_t value) {
+		if (value < m_min.load(std::memory_order_relaxed)) m_min.store(value, std::memory_order_relaxed);
+		if (value > m_max.load(std::memory_order_relaxed)) m_max.store(value, std::memory_order_relaxed);
+
+		std::atomic<uint64_t> &bucket = m_buckets[_bucket_of(value)];
+		bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	}
+
+	/*
+	 * @brief Forgets all the recorded values.
+	 */
+	void reset() {
+		for (auto &bucket : m_buckets) bucket.store(0, std::memory_order_relaxed);
+
+		m_min.store(UINT64_MAX, std::memory_order_relaxed);
+		m_max.store(0, std::memory_order_relaxed);
+	}
+
+	/*
+	 * @brief Takes a snapshot of the histogram (any thread).
+	 * @param histogram Filled with the buckets, the count, the extremes and the percentiles.
+	 */
+	void snapshot(RUDP_histogram &histogram) const {
+		histogram.count = 0;
+
+		for (uint32_t i = 0; i < RUDP_HISTOGRAM_BUCKETS; i++)
+		{
+			histogram.buckets[i] = m_buckets[i].load(std::memory_order_relaxed);
+			histogram.count += histogram.buckets[i];
+		}
+
+		histogram.min_us = (histogram.count == 0) ? 0 : m_min.load(std::memory_order_relaxed);
+		histogram.max_us = (histogram.count == 0) ? 0 : m_max.load(std::memory_order_relaxed);
+
+		_summarize(histogram);
+	}
+
+	/*
+	 * @brief Adds the values of one snapshot to another, for example to aggregate many connections.
+	 * @param into The snapshot to add to, its percentiles are updated.
+	 * @param from The snapshot to add.
+	 */
+	static void mergeHistogram(RUDP_histogram &into, const RUDP_histogram &from) {
+		if (from.count == 0) return;
+
+		into.min_us = (into.count == 0) ? from.min_us : std::min(into.min_us, from.min_us);
+		into.max_us = (into.count == 0) ? from.max_us : std::max(into.max_us, from.max_us);
+		into.count += from.count;
+
+		for (uint32_t i = 0; i < RUDP_HISTOGRAM_BUCKETS; i++) into.buckets[i] += from.buckets[i];
+
+		_summarize(into);
+	}
+
+	/*
+	 * @brief Gets a percentile of a snapshot.
+	 * @param histogram The snapshot.
+	 * @param percentile The percentile, between 0 and 100 (99.9 for the 99.9th percentile).
+	 * @return The highest value of the bucket holding the percentile, within the recorded extremes, 0 if the snapshot is empty.
+	 */
+	static uint64_t getPercentile(const RUDP_histogram &histogram, double percentile) {
+		if (histogram.count == 0) return 0;
+
+		uint64_t rank = (uint64_t)std::ceil(std::min(std::max(percentile, 0.0), 100.0) / 100.0 * (double)histogram.count);
+		uint64_t seen = 0;
+
+		if (rank == 0) rank = 1;
+
+		for (uint32_t i = 0; i < RUDP_HISTOGRAM_BUCKETS; i++)
+		{
+			seen += histogram.buckets[i];
+
+			// The last bucket also holds the values beyond the range, only the maximum tells how far they go.
+			if (seen >= rank) return (i == RUDP_HISTOGRAM_BUCKETS - 1) ? histogram.max_us : std::max(histogram.min_us, std::min(_bucket_highest(i), histogram.max_us));
+		}
+
+		return histogram.max_us;
+	}
+};
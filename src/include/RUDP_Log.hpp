@@ -0,0 +1,276 @@
+/*
+ *  Reliable UDP implementation
+ *  Copyright (C) 2024  Roy Simanovich
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include "RUDP_Queue.hpp"
+
+/*
+ * @brief The levels of the log messages of the library.
+ * @note RUDP_LOG_LEVEL_DEBUG messages are shown only if the socket is in debug mode, the others always.
+ */
+#define RUDP_LOG_LEVEL_DEBUG 0
+#define RUDP_LOG_LEVEL_INFO 1
+#define RUDP_LOG_LEVEL_WARNING 2
+#define RUDP_LOG_LEVEL_ERROR 3
+#define RUDP_LOG_LEVEL_NONE 4
+
+/*
+ * @brief The lowest level of the log messages that are compiled in, the ones below it cost nothing at all.
+ * @note Set by the build (make LOG_LEVEL=...), all levels by default.
+ */
+#ifndef RUDP_LOG_LEVEL
+#define RUDP_LOG_LEVEL RUDP_LOG_LEVEL_DEBUG
+#endif
+
+/*
+ * @brief The most arguments a log message may have.
+ */
+#define RUDP_LOG_MAX_ARGS 8
+
+/*
+ * @brief Room for the text arguments (strings) of a log message, longer ones are cut.
+ */
+#define RUDP_LOG_TEXT_SIZE 128
+
+/*
+ * @brief Number of log messages that may wait for the logger thread, must be a power of two.
+ */
+#define RUDP_LOG_QUEUE_SIZE 4096
+
+/*
+ * @brief Logs a message, if its level is compiled in and enabled.
+ * @param level The level of the message, RUDP_LOG_LEVEL_*.
+ * @param enabled Whether the message is enabled at run time, only evaluated if the level is compiled in.
+ * @param format The message, a string literal where each {} (or {:#x}, in hexadecimal) stands for the next argument.
+ * @note The arguments are evaluated only if the message is logged.
+ */
+#define RUDP_LOG(level, enabled, format, ...) \
+	do { if ((level) >= RUDP_LOG_LEVEL && (enabled)) RUDP_Logger::instance().log((level), "" format "", ##__VA_ARGS__); } while (0)
+
+/*
+ * @brief Checks if the debug messages are compiled in and the socket is in debug mode, to skip preparing a debug message.
+ * @note For use in RUDP_Socket_p methods only.
+ */
+#define RUDP_LOG_DEBUG_ENABLED (RUDP_LOG_LEVEL <= RUDP_LOG_LEVEL_DEBUG && m_debugMode)
+
+/*
+ * @brief Logs a message of a level.
+ * @note RUDP_LOG_DEBUG is for use in RUDP_Socket_p methods only, as it checks the debug mode of the socket.
+ */
+#define RUDP_LOG_DEBUG(format, ...) RUDP_LOG(RUDP_LOG_LEVEL_DEBUG, m_debugMode, format, ##__VA_ARGS__)
+#define RUDP_LOG_INFO(format, ...) RUDP_LOG(RUDP_LOG_LEVEL_INFO, true, format, ##__VA_ARGS__)
+#define RUDP_LOG_WARNING(format, ...) RUDP_LOG(RUDP_LOG_LEVEL_WARNING, true, format, ##__VA_ARGS__)
+#define RUDP_LOG_ERROR(format, ...) RUDP_LOG(RUDP_LOG_LEVEL_ERROR, true, format, ##__VA_ARGS__)
+
+/*
+ * @brief A log message that waits for the logger thread: the format and the arguments, not formatted yet.
+ * @param format The format, a string literal.
+ * @param level The level of the message.
+ * @param arg_count Number of arguments.
+ * @param text_used Number of bytes of text used by the text arguments.
+ * @param arg_types The type of each argument, RUDP_Log_Record::ARG_*.
+ * @param args The arguments, text arguments are an offset and a length into text.
+ * @param text The text arguments, copied as the strings they come from may be gone by the time the message is written.
+ * @attention This is for internal use only, manipulating this directly can cause undefined behavior for the library.
+ */
+struct RUDP_Log_Record
+{
+	enum : uint8_t { ARG_SIGNED, ARG_UNSIGNED, ARG_DOUBLE, ARG_POINTER, ARG_TEXT };
+
+	const char *format;
+	uint8_t level;
+	uint8_t arg_count;
+	uint8_t text_used;
+	uint8_t arg_types[RUDP_LOG_MAX_ARGS];
+
+	union
+	{
+		int64_t i;
+		uint64_t u;
+		double d;
+		struct { uint8_t offset; uint8_t length; } text;
+	} args[RUDP_LOG_MAX_ARGS];
+
+	char text[RUDP_LOG_TEXT_SIZE];
+};
+
+/*
+ * @brief An asynchronous logger: the threads that log only copy the arguments into a lock-free queue, one background thread formats and writes them.
+ * @note Info messages go to the standard output, the others to the standard error, in the order they were logged by each thread.
+ * @note If the queue is full the message is dropped, and counted in a warning once there is room again, so logging never blocks the I/O engine.
+ * @note The logger starts with the first message, and writes everything that is still waiting when the process exits.
+ * @attention This is for internal use only, use the RUDP_LOG_* macros.
+ */
+class RUDP_Logger
+{
+private:
+	/*
+	 * @brief The messages that wait for the logger thread.
+	 */
+	RUDP_MPSC_Queue<RUDP_Log_Record, RUDP_LOG_QUEUE_SIZE> m_queue;
+
+	/*
+	 * @brief Number of messages pushed into the queue, written by the logger thread, and dropped as the queue was full.
+	 */
+	std::atomic<uint64_t> m_pushed{0};
+	std::atomic<uint64_t> m_written{0};
+	std::atomic<uint64_t> m_dropped{0};
+
+	/*
+	 * @brief Set while the logger thread waits for messages, so the threads that log only wake it up when it sleeps.
+	 */
+	std::atomic<bool> m_sleeping{false};
+
+	/*
+	 * @brief Used only to put the logger thread and flush() to sleep.
+	 */
+	std::mutex m_mutex;
+	std::condition_variable m_wakeCondition;
+	std::condition_variable m_writtenCondition;
+
+	/*
+	 * @brief The logger thread.
+	 */
+	std::thread m_thread;
+
+	RUDP_Logger();
+
+	/*
+	 * @brief The logger thread: pops, formats and writes the messages.
+	 */
+	void _run();
+
+	/*
+	 * @brief Formats a message.
+	 * @param record The message.
+	 * @param out Where to append the formatted message, with a new line.
+	 */
+	static void _format(const RUDP_Log_Record &record, std::string &out);
+
+	/*
+	 * @brief Copies an argument into a message.
+	 * @note One overload for each kind of argument.
+	 */
+	template <typename T>
+	static typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value>::type _capture(RUDP_Log_Record &record, T value) {
+		record.arg_types[record.arg_count] = RUDP_Log_Record::ARG_SIGNED;
+		record.args[record.arg_count++].i = (int64_t)value;
+	}
+
+	template <typename T>
+	static typename std::enable_if<std::is_integral<T>::value && !std::is_signed<T>::value>::type _capture(RUDP_Log_Record &record, T value) {
+		record.arg_types[record.arg_count] = RUDP_Log_Record::ARG_UNSIGNED;
+		record.args[record.arg_count++].u = (uint64_t)value;
+	}
+
+	template <typename T>
+	static typename std::enable_if<std::is_floating_point<T>::value>::type _capture(RUDP_Log_Record &record, T value) {
+		record.arg_types[record.arg_count] = RUDP_Log_Record::ARG_DOUBLE;
+		record.args[record.arg_count++].d = (double)value;
+	}
+
+	template <typename T>
+	static typename std::enable_if<std::is_enum<T>::value>::type _capture(RUDP_Log_Record &record, T value) {
+		_capture(record, (int64_t)value);
+	}
+
+	template <typename T>
+	static void _capture(RUDP_Log_Record &record, const std::atomic<T> &value) {
+		_capture(record, value.load(std::memory_order_relaxed));
+	}
+
+	static void _capture(RUDP_Log_Record &record, const void *value) {
+		record.arg_types[record.arg_count] = RUDP_Log_Record::ARG_POINTER;
+		record.args[record.arg_count++].u = (uint64_t)(uintptr_t)value;
+	}
+
+	static void _capture(RUDP_Log_Record &record, const char *value) {
+		size_t length = (value == nullptr) ? 0 : std::min(strlen(value), (size_t)(RUDP_LOG_TEXT_SIZE - record.text_used));
+
+		memcpy(record.text + record.text_used, value, length);
+		record.arg_types[record.arg_count] = RUDP_Log_Record::ARG_TEXT;
+		record.args[record.arg_count].text.offset = record.text_used;
+		record.args[record.arg_count++].text.length = (uint8_t)length;
+		record.text_used += (uint8_t)length;
+	}
+
+	static void _capture(RUDP_Log_Record &record, char *value) { _capture(record, (const char *)value); }
+	static void _capture(RUDP_Log_Record &record, const std::string &value) { _capture(record, value.c_str()); }
+
+public:
+	RUDP_Logger(const RUDP_Logger &) = delete;
+	RUDP_Logger &operator=(const RUDP_Logger &) = delete;
+
+	/*
+	 * @brief Gets the logger of the process, and starts it with the first call.
+	 * @return The logger.
+	 */
+	static RUDP_Logger &instance();
+
+	/*
+	 * @brief Logs a message, without formatting it.
+	 * @param level The level of the message.
+	 * @param format The format, a string literal where each {} (or {:#x}) stands for the next argument.
+	 * @param args The arguments: numbers, pointers and strings (copied, up to RUDP_LOG_TEXT_SIZE bytes for all of them).
+	 * @note Costs a copy of the arguments into the queue, and a wake up of the logger thread if it sleeps.
+	 */
+	template <typename... Args>
+	void log(uint8_t level, const char *format, const Args &... args) {
+		static_assert(sizeof...(Args) <= RUDP_LOG_MAX_ARGS, "Too many arguments for a log message.");
+
+		RUDP_Log_Record record;
+
+		record.format = format;
+		record.level = level;
+		record.arg_count = 0;
+		record.text_used = 0;
+
+		int expand[] = { 0, (_capture(record, args), 0)... };
+		(void)expand;
+
+		if (!m_queue.push(record))
+		{
+			m_dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+
+		m_pushed.fetch_add(1, std::memory_order_release);
+
+		// Pairs with the fence of the logger thread before it checks the queue one last time and sleeps.
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		if (m_sleeping.load(std::memory_order_relaxed) && m_sleeping.exchange(false))
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_wakeCondition.notify_one();
+		}
+	}
+
+	/*
+	 * @brief Waits until the messages logged so far are written, or for a second at most.
+	 */
+	void flush();
+};
@@ -0,0 +1,189 @@
+/*
+ *  Reliable UDP implementation
+ *  Copyright (C) 2024  Roy Simanovich
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/*
+ * @brief The size of a cache line, used to keep the producer and consumer indexes apart.
+ */
+#define RUDP_CACHE_LINE_SIZE 64
+
+/*
+ * @brief A bounded lock-free single-producer / single-consumer queue.
+ * @tparam T The type of the elements, must be trivially copyable (usually a pointer).
+ * @tparam Capacity The number of slots in the queue, must be a power of two.
+ * @note Exactly one thread may call push() and exactly one (other) thread may call pop().
+ * @attention This is for internal use only, it is used to pass work between the application threads and the I/O engine.
+ */
+template <typename T, size_t Capacity>
+class RUDP_SPSC_Queue
+{
+	static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "RUDP_SPSC_Queue capacity must be a power of two.");
+
+private:
+	/*
+	 * @brief Index of the next slot to read, owned by the consumer.
+	 */
+	alignas(RUDP_CACHE_LINE_SIZE) std::atomic<size_t> m_head{0};
+
+	/*
+	 * @brief Index of the next slot to write, owned by the producer.
+	 */
+	alignas(RUDP_CACHE_LINE_SIZE) std::atomic<size_t> m_tail{0};
+
+	/*
+	 * @brief The slots themselves.
+	 */
+	alignas(RUDP_CACHE_LINE_SIZE) T m_slots[Capacity];
+
+public:
+	/*
+	 * @brief Pushes an element to the queue (producer side).
+	 * @param item The element to push.
+	 * @return True if the element was pushed, false if the queue is full.
+	 */
+	bool push(const T &item) {
+		size_t tail = m_tail.load(std::memory_order_relaxed);
+
+		if (tail - m_head.load(std::memory_order_acquire) == Capacity) return false;
+
+		m_slots[tail & (Capacity - 1)] = item;
+		m_tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	/*
+	 * @brief Pops an element from the queue (consumer side).
+	 * @param item Where to store the popped element.
+	 * @return True if an element was popped, false if the queue is empty.
+	 */
+	bool pop(T &item) {
+		size_t head = m_head.load(std::memory_order_relaxed);
+
+		if (head == m_tail.load(std::memory_order_acquire)) return false;
+
+		item = m_slots[head & (Capacity - 1)];
+		m_head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	/*
+	 * @brief Checks if the queue is empty.
+	 * @return True if the queue is empty, false otherwise.
+	 * @note The result is only a snapshot, it may change right after the call when used from the producer side.
+	 */
+	bool empty() const { return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire); }
+};
+
+/*
+ * @brief A bounded lock-free multi-producer / single-consumer queue.
+ * @tparam T The type of the elements, must be trivially copyable (usually a pointer).
+ * @tparam Capacity The number of slots in the queue, must be a power of two.
+ * @note Any number of threads may call push(), exactly one thread may call pop().
+ * @note Each slot carries a sequence number that tells whether it is free, being filled or ready, so producers only contend on a single compare-and-swap of the tail index.
+ * @note Elements pushed by the same thread are popped in the order they were pushed.
+ * @attention This is for internal use only, it is used to pass send requests from the application threads to the I/O engine.
+ */
+template <typename T, size_t Capacity>
+class RUDP_MPSC_Queue
+{
+	static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "RUDP_MPSC_Queue capacity must be a power of two.");
+
+private:
+	/*
+	 * @brief A slot of the queue.
+	 * @note The sequence is equal to the slot's position when the slot is free, and to the position plus one when it holds an element.
+	 */
+	struct Slot
+	{
+		std::atomic<size_t> sequence;
+		T item;
+	};
+
+	/*
+	 * @brief Index of the next slot to claim, shared by the producers.
+	 */
+	alignas(RUDP_CACHE_LINE_SIZE) std::atomic<size_t> m_tail{0};
+
+	/*
+	 * @brief Index of the next slot to read, owned by the consumer.
+	 */
+	alignas(RUDP_CACHE_LINE_SIZE) size_t m_head = 0;
+
+	/*
+	 * @brief The slots themselves.
+	 */
+	alignas(RUDP_CACHE_LINE_SIZE) Slot m_slots[Capacity];
+
+public:
+	RUDP_MPSC_Queue() {
+		for (size_t i = 0; i < Capacity; i++) m_slots[i].sequence.store(i, std::memory_order_relaxed);
+	}
+
+	/*
+	 * @brief Pushes an element to the queue (producer side, any thread).
+	 * @param item The element to push.
+	 * @return True if the element was pushed, false if the queue is full.
+	 */
+	bool push(const T &item) {
+		size_t tail = m_tail.load(std::memory_order_relaxed);
+
+		while (true)
+		{
+			Slot &slot = m_slots[tail & (Capacity - 1)];
+			intptr_t diff = (intptr_t)slot.sequence.load(std::memory_order_acquire) - (intptr_t)tail;
+
+			if (diff == 0)
+			{
+				if (m_tail.compare_exchange_weak(tail, tail + 1, std::memory_order_relaxed))
+				{
+					slot.item = item;
+					slot.sequence.store(tail + 1, std::memory_order_release);
+					return true;
+				}
+			}
+
+			else if (diff < 0) return false;
+			else tail = m_tail.load(std::memory_order_relaxed);
+		}
+	}
+
+	/*
+	 * @brief Pops an element from the queue (consumer side).
+	 * @param item Where to store the popped element.
+	 * @return True if an element was popped, false if the queue is empty (or the next element is still being written).
+	 */
+	bool pop(T &item) {
+		Slot &slot = m_slots[m_head & (Capacity - 1)];
+
+		if (slot.sequence.load(std::memory_order_acquire) != m_head + 1) return false;
+
+		item = slot.item;
+		slot.sequence.store(m_head + Capacity, std::memory_order_release);
+		m_head++;
+		return true;
+	}
+
+	/*
+	 * @brief Checks if the queue is empty (consumer side).
+	 * @return True if there is nothing to pop, false otherwise.
+	 */
+	bool empty() const { return m_slots[m_head & (Capacity - 1)].sequence.load(std::memory_order_acquire) != m_head + 1; }
+};
@@ -0,0 +1,184 @@
+/*
+ *  Reliable UDP implementation
+ *  Copyright (C) 2024  Roy Simanovich
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _RUDP_TYPES_H
+#define _RUDP_TYPES_H
+
+#include <stdint.h>
+
+/*
+ * @brief The phases of the hot path that phase timing measures, the indexes of RUDP_stats::phase_ns and phase_count.
+ * @note RUDP_PHASE_PACKETIZE - building a data packet: copying the payload and filling the header.
+ * @note RUDP_PHASE_CHECKSUM - computing the checksum of a data packet sent, or checking the checksum of a packet received.
+ * @note RUDP_PHASE_SEND - the system call that sends a data packet for the first time.
+ * @note RUDP_PHASE_RETRANSMIT - the system call that sends a data packet again.
+ * @note RUDP_PHASE_ACK_WAIT - from the first send of the last packet of a message to the ACK that completes it.
+ * @note RUDP_PHASE_RECEIVE - the system call that receives a packet.
+ * @note RUDP_PHASE_REASSEMBLY - copying received data into its message, and handing complete messages to recv().
+ */
+#define RUDP_PHASE_PACKETIZE 0
+#define RUDP_PHASE_CHECKSUM 1
+#define RUDP_PHASE_SEND 2
+#define RUDP_PHASE_RETRANSMIT 3
+#define RUDP_PHASE_ACK_WAIT 4
+#define RUDP_PHASE_RECEIVE 5
+#define RUDP_PHASE_REASSEMBLY 6
+#define RUDP_PHASE_COUNT 7
+
+/*
+ * @brief Statistics of a connection, counted from the start of the current (or last) connection.
+ * @param bytes_sent Bytes of data packets sent, headers and retransmissions included.
+ * @param packets_sent Number of data packets sent, retransmissions included.
+ * @param bytes_received Bytes of data packets received, headers and duplicates included.
+ * @param packets_received Number of data packets received, duplicates included.
+ * @param messages_sent Number of messages acknowledged by the peer.
+ * @param messages_received Number of complete messages received.
+ * @param retransmits Number of data packets sent again, after a timeout, duplicate ACKs, a SACK hint or a NAK.
+ * @param timeouts Number of retransmissions caused by the retransmission timeout.
+ * @param duplicates Number of data packets received more than once.
+ * @param checksum_failures Number of packets dropped as damaged (wrong checksum or length).
+ * @param kernel_drops Number of packets the kernel dropped for lack of room in the socket receive buffer (Linux only).
+ * @param srtt_us The smoothed round trip time in microseconds, 0 before the first sample.
+ * @param rttvar_us The round trip time variation in microseconds.
+ * @param rto_us The retransmission timeout in microseconds.
+ * @param duration_us How long the connection is (or was) up, in microseconds.
+ * @param goodput Bytes of messages acknowledged by the peer per second, over the whole connection.
+ * @param phase_ns Nanoseconds spent in each phase of the hot path, see RUDP_PHASE_*. All 0 unless phase timing is enabled.
+ * @param phase_count Number of times each phase was timed, to get the average time of one.
+ */
+typedef struct _RUDP_stats
+{
+	uint64_t bytes_sent;
+	uint64_t packets_sent;
+	uint64_t bytes_received;
+	uint64_t packets_received;
+	uint64_t messages_sent;
+	uint64_t messages_received;
+	uint64_t retransmits;
+	uint64_t timeouts;
+	uint64_t duplicates;
+	uint64_t checksum_failures;
+	uint64_t kernel_drops;
+	uint64_t srtt_us;
+	uint64_t rttvar_us;
+	uint64_t rto_us;
+	uint64_t duration_us;
+	uint64_t goodput;
+	uint64_t phase_ns[RUDP_PHASE_COUNT];
+	uint64_t phase_count[RUDP_PHASE_COUNT];
+} RUDP_stats;
+
+/*
+ * @brief Number of buckets of a histogram, covering 0 to 2^32 microseconds (about 71 minutes).
+ */
+#define RUDP_HISTOGRAM_BUCKETS 896
+
+/*
+ * @brief A snapshot of a latency histogram, in microseconds.
+ * @param count Number of recorded values.
+ * @param min_us The smallest recorded value, 0 if the histogram is empty.
+ * @param max_us The largest recorded value, 0 if the histogram is empty.
+ * @param p50_us The median, as the highest value of its bucket.
+ * @param p90_us The 90th percentile.
+ * @param p99_us The 99th percentile.
+ * @param p999_us The 99.9th percentile.
+ * @param buckets Number of values in each bucket: exact up to 63 microseconds, then 32 buckets per power of two.
+ */
+typedef struct _RUDP_histogram
+{
+	uint64_t count;
+	uint64_t min_us;
+	uint64_t max_us;
+	uint64_t p50_us;
+	uint64_t p90_us;
+	uint64_t p99_us;
+	uint64_t p999_us;
+	uint64_t buckets[RUDP_HISTOGRAM_BUCKETS];
+} RUDP_histogram;
+
+/*
+ * @brief Types of trace events, see RUDP_trace_event.
+ * @note RUDP_TRACE_CONNECTED - the connection started, size is the path MTU and value the window size in packets.
+ * @note RUDP_TRACE_CLOSED - the connection ended, the reason is RUDP_TRACE_REASON_ERROR if it failed.
+ * @note RUDP_TRACE_PACKET_SENT - a new data packet was sent, value is the number of bytes in flight.
+ * @note RUDP_TRACE_PACKET_RETRANSMITTED - a data packet was sent again, value is the number of times it was sent before.
+ * @note RUDP_TRACE_PACKET_RECEIVED - a data packet arrived, the reason tells if it was out of order, a duplicate or beyond the window.
+ * @note RUDP_TRACE_PACKET_DROPPED - a damaged packet was dropped, size is its length.
+ * @note RUDP_TRACE_PACKET_ACKED - an ACK acknowledged the packets up to seq_num, size is the number of packets it acknowledged and value the bytes still in flight.
+ * @note RUDP_TRACE_PACKET_LOST - a data packet was taken as lost, the reason tells how.
+ * @note RUDP_TRACE_ACK_SENT - an ACK packet was sent for the packets up to seq_num, value is the advertised window in packets.
+ * @note RUDP_TRACE_NAK_SENT - a NAK packet asked for the packets from seq_num to value.
+ * @note RUDP_TRACE_TIMER_FIRED - the retransmission timer (RUDP_TRACE_REASON_TIMEOUT) or the persist timer (RUDP_TRACE_REASON_PERSIST) ran out.
+ * @note RUDP_TRACE_WINDOW_UPDATED - the peer's receive window changed, value is the window in bytes.
+ * @note RUDP_TRACE_PATH_MTU_UPDATED - the path MTU changed, value is the new path MTU.
+ * @note RUDP_TRACE_EVENTS_LOST - the trace ring was full, value is the number of events that were lost.
+ */
+typedef enum _RUDP_trace_type
+{
+	RUDP_TRACE_CONNECTED = 1,
+	RUDP_TRACE_CLOSED,
+	RUDP_TRACE_PACKET_SENT,
+	RUDP_TRACE_PACKET_RETRANSMITTED,
+	RUDP_TRACE_PACKET_RECEIVED,
+	RUDP_TRACE_PACKET_DROPPED,
+	RUDP_TRACE_PACKET_ACKED,
+	RUDP_TRACE_PACKET_LOST,
+	RUDP_TRACE_ACK_SENT,
+	RUDP_TRACE_NAK_SENT,
+	RUDP_TRACE_TIMER_FIRED,
+	RUDP_TRACE_WINDOW_UPDATED,
+	RUDP_TRACE_PATH_MTU_UPDATED,
+	RUDP_TRACE_EVENTS_LOST
+} RUDP_trace_type;
+
+/*
+ * @brief Reasons of trace events, see RUDP_trace_type.
+ */
+typedef enum _RUDP_trace_reason
+{
+	RUDP_TRACE_REASON_NONE = 0,
+	RUDP_TRACE_REASON_TIMEOUT,
+	RUDP_TRACE_REASON_DUP_ACKS,
+	RUDP_TRACE_REASON_NAK,
+	RUDP_TRACE_REASON_PERSIST,
+	RUDP_TRACE_REASON_OUT_OF_ORDER,
+	RUDP_TRACE_REASON_DUPLICATE,
+	RUDP_TRACE_REASON_BEYOND_WINDOW,
+	RUDP_TRACE_REASON_CORRUPTED,
+	RUDP_TRACE_REASON_ERROR
+} RUDP_trace_reason;
+
+/*
+ * @brief A trace event, a fixed size binary record.
+ * @param time_us When the event happened, in microseconds of the monotonic clock.
+ * @param value A value that depends on the type of the event, see RUDP_trace_type.
+ * @param seq_num The sequence number of the packet, if any.
+ * @param size The size of the packet, if any.
+ * @param type The type of the event, see RUDP_trace_type.
+ * @param reason The reason of the event, see RUDP_trace_reason.
+ */
+typedef struct _RUDP_trace_event
+{
+	uint64_t time_us;
+	uint64_t value;
+	uint32_t seq_num;
+	uint16_t size;
+	uint8_t type;
+	uint8_t reason;
+} RUDP_trace_event;
+
+#endif // _RUDP_TYPES_H
@@ -15,12 +15,27 @@
  *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
  */
 
-#include <iostream>
-#include <iomanip>
+#include <fstream>
 #include <cstdlib>
 #include <errno.h>
 #include "include/RUDP_API_wrap.hpp"
 
+#if defined(__linux__)
+#include <linux/net_tstamp.h>
+#endif
+
+/*
+ * @brief Checks if the last socket error is an ICMP port unreachable reported on a connected socket.
+ * @return True if nothing listens on the peer's port, false otherwise.
+ */
+static bool rudp_is_connection_refused() {
+#if defined(_OPSYS_WINDOWS)
+	return (WSAGetLastError() == WSAECONNRESET);
+#elif defined(_OPSYS_UNIX)
+	return (errno == ECONNREFUSED);
+#endif
+}
+
 uint16_t RUDP_Socket_p::_calculate_checksum(void *data, uint32_t data_size) {
 	uint16_t *data_ptr = (uint16_t *)data;
 	uint32_t checksum = 0;
@@ -32,16 +47,6 @@ uint16_t RUDP_Socket_p::_calculate_checksum(void *data, uint32_t data_size) {
 	return ~checksum;
 }
 
-bool RUDP_Socket_p::_check_packet_source(struct sockaddr *source, uint32_t source_size) {
-	int result = memcmp(source, (struct sockaddr *)&m_destinationAddress4, source_size);
-	if (result != 0)
-	{
-		if (m_debugMode) std::cerr << "Warning: Received a packet from an unknown source address (" << inet_ntoa(((struct sockaddr_in *)source)->sin_addr) << ":" << ntohs(((struct sockaddr_in *)source)->sin_port) << "), sending a rejection packet (FIN)." << std::endl;
-		_send_control_packet(RUDP_FLAG_FIN, 0, source, source_size); // maybe I should add an option to just ignore the packet and do nothing?
-	}
-	return result;
-}
-
 void RUDP_Socket_p::_send_control_packet(uint8_t flags, uint32_t seq_num, struct sockaddr *destination, uint32_t destination_size) {
 	if (destination == nullptr)
 	{
@@ -49,7 +54,8 @@ void RUDP_Socket_p::_send_control_packet(uint8_t flags, uint32_t seq_num, struct
 		destination_size = sizeof(m_destinationAddress4);
 	}
 	
-	uint8_t packet[m_protocolMTU] = {0};
+	// Only the SYN carries a payload, every other control packet (most of them ACKs) is the bare header.
+	uint8_t packet[sizeof(RUDP_header) + sizeof(RUDP_SYN_packet)] = {0};
 	RUDP_header header = {
 		.seq_num = htonl(seq_num),
 		.flags = flags
@@ -62,7 +68,11 @@ void RUDP_Socket_p::_send_control_packet(uint8_t flags, uint32_t seq_num, struct
 			.MTU = htons(m_protocolMTU),
 			.timeout = htons(m_protocolTimeout),
 			.max_retries = htons(m_protocolMaximumRetries),
-			.debug_mode = htons(m_debugMode)
+			.debug_mode = htons(m_debugMode),
+			.window_size = htons(m_windowSize),
+			.ack_ratio = htons(m_ackRatio),
+			// A delayed ACK must come well before the peer retransmits.
+			.ack_delay = htons((uint16_t)std::min<uint32_t>(m_ackDelay, m_protocolTimeout * 500U))
 		};
 		memcpy(packet + sizeof(header), &syn_packet, sizeof(RUDP_SYN_packet));
 		memcpy(packet, &header, sizeof(header));
@@ -70,22 +80,24 @@ void RUDP_Socket_p::_send_control_packet(uint8_t flags, uint32_t seq_num, struct
 	}
 
 	memcpy(packet, &header, sizeof(header));
-	if (sendto(m_socketHandle, (char *)(&packet), (sizeof(header) + ntohs(header.length)), 0, destination, destination_size) == SOCKET_ERROR) _print_socket_error("Failed to send a control packet", false);
+
+	// A connected socket refuses an explicit address on some platforms, and it knows where to send anyway.
+	int bytes_sent = (m_socketConnected && destination == (struct sockaddr *)&m_destinationAddress4) ?
+		::send(m_socketHandle, (char *)(&packet), (sizeof(header) + ntohs(header.length)), 0) :
+		sendto(m_socketHandle, (char *)(&packet), (sizeof(header) + ntohs(header.length)), 0, destination, destination_size);
+
+	if (bytes_sent == SOCKET_ERROR) _print_socket_error("Failed to send a control packet", false);
+	else _flight_record(RUDP_FLIGHT_RECORDER_SENT, packet, bytes_sent);
 }
 
 int RUDP_Socket_p::_check_packet_validity(void *packet, uint32_t packet_size, uint8_t expected_flags) {
 	static const std::string flag_names[] = {
-		"Syncronization (SYN)", "Acknowledgement (ACK)", "Push (PSH)", "Last (LAST)", "Closure (FIN)"
+		"Syncronization (SYN)", "Acknowledgement (ACK)", "Push (PSH)", "Last (LAST)", "Closure (FIN)", "Probe (PROBE)", "Batch (BATCH)", "Negative acknowledgement (NAK)"
 	};
 
 	if (packet_size < sizeof(RUDP_header))
 	{
-		if (m_debugMode)
-		{
-			std::cerr << "Packet validity error:" << std::endl;
-			std::cerr << "\tPacket size: " << packet_size << " bytes" << std::endl;
-			std::cerr << "\tMinimum packet size: " << sizeof(RUDP_header) << " bytes" << std::endl;
-		}
+		RUDP_LOG_DEBUG("Packet validity error:\n\tPacket size: {} bytes\n\tMinimum packet size: {} bytes", packet_size, sizeof(RUDP_header));
 
 		return 0;
 	}
@@ -97,24 +109,14 @@ int RUDP_Socket_p::_check_packet_validity(void *packet, uint32_t packet_size, ui
 
 	if (length != (packet_size - sizeof(RUDP_header)))
 	{
-		if (m_debugMode)
-		{
-			std::cerr << "Packet validity error:" << std::endl;
-			std::cerr << "\tPacket length: " << length << " bytes" << std::endl;
-			std::cerr << "\tActual packet length: " << (packet_size - sizeof(RUDP_header)) << " bytes" << std::endl;
-		}
+		RUDP_LOG_DEBUG("Packet validity error:\n\tPacket length: {} bytes\n\tActual packet length: {} bytes", length, (packet_size - sizeof(RUDP_header)));
 		
 		return 0;
 	}
 
 	if (checksum != header->checksum)
 	{
-		if (m_debugMode)
-		{
-			std::cerr << "Packet validity error:" << std::endl;
-			std::cerr << std::setw(2) << std::setfill('0') << std::hex << std::showbase << "\tExpected checksum: " << checksum << std::noshowbase << std::dec << std::endl;
-			std::cerr << std::setw(2) << std::setfill('0') << std::hex << std::showbase << "\tReceived checksum: " << header->checksum << std::noshowbase << std::dec << std::endl;
-		}
+		RUDP_LOG_DEBUG("Packet validity error:\n\tExpected checksum: {:#x}\n\tReceived checksum: {:#x}", checksum, header->checksum);
 		
 		return 0;
 	}
@@ -123,55 +125,47 @@ int RUDP_Socket_p::_check_packet_validity(void *packet, uint32_t packet_size, ui
 	{
 		if (length != sizeof(RUDP_SYN_packet))
 		{
-			if (m_debugMode)
-			{
-				std::cerr << "Packet validity error:" << std::endl;
-				std::cerr << "\tReceived SYN packet with invalid length: " << length << " bytes; can't parse the data." << std::endl;
-			}
+			RUDP_LOG_DEBUG("Packet validity error:\n\tReceived SYN packet with invalid length: {} bytes; can't parse the data.", length);
 
 			return 0;
 		}
 
 		RUDP_SYN_packet *syn_packet = (RUDP_SYN_packet *)((uint8_t*)packet + sizeof(RUDP_header));
-		uint16_t MTU = ntohs(syn_packet->MTU), timeout = ntohs(syn_packet->timeout), max_retries = ntohs(syn_packet->max_retries), debug_mode = ntohs(syn_packet->debug_mode);
+		uint16_t MTU = ntohs(syn_packet->MTU), timeout = ntohs(syn_packet->timeout), max_retries = ntohs(syn_packet->max_retries), debug_mode = ntohs(syn_packet->debug_mode), window_size = ntohs(syn_packet->window_size), ack_ratio = ntohs(syn_packet->ack_ratio);
 
 		if (MTU < RUDP_MINIMAL_MTU)
 		{
-			if (m_debugMode)
-			{
-				std::cerr << "Packet validity error:" << std::endl;
-				std::cerr << "\tReceived SYN packet with invalid MTU: " << MTU << " bytes; the minimum MTU is " << RUDP_MINIMAL_MTU << " bytes." << std::endl;
-			}
+			RUDP_LOG_DEBUG("Packet validity error:\n\tReceived SYN packet with invalid MTU: {} bytes; the minimum MTU is {} bytes.", MTU, RUDP_MINIMAL_MTU);
 			return 0;
 		}
 
 		if (timeout < RUDP_MINIMAL_TIMEOUT)
 		{
-			if (m_debugMode)
-			{
-				std::cerr << "Packet validity error:" << std::endl;
-				std::cerr << "\tReceived SYN packet with invalid timeout: " << timeout << " milliseconds; the minimum timeout is " << RUDP_MINIMAL_TIMEOUT << " milliseconds." << std::endl;
-			}
+			RUDP_LOG_DEBUG("Packet validity error:\n\tReceived SYN packet with invalid timeout: {} milliseconds; the minimum timeout is {} milliseconds.", timeout, RUDP_MINIMAL_TIMEOUT);
 			return 0;
 		}
 
 		if (max_retries == 0)
 		{
-			if (m_debugMode)
-			{
-				std::cerr << "Packet validity error:" << std::endl;
-				std::cerr << "\tReceived SYN packet with invalid maximum number of retries: " << max_retries << "; the minimum number of retries is 1." << std::endl;
-			}
+			RUDP_LOG_DEBUG("Packet validity error:\n\tReceived SYN packet with invalid maximum number of retries: {}; the minimum number of retries is 1.", max_retries);
 			return 0;
 		}
 
 		if (debug_mode > 1)
 		{
-			if (m_debugMode)
-			{
-				std::cerr << "Packet validity error:" << std::endl;
-				std::cerr << "\tReceived SYN packet with invalid debug mode: " << debug_mode << "; debug mode flag can be either 0 or 1 (true or false)." << std::endl;
-			}
+			RUDP_LOG_DEBUG("Packet validity error:\n\tReceived SYN packet with invalid debug mode: {}; debug mode flag can be either 0 or 1 (true or false).", debug_mode);
+			return 0;
+		}
+
+		if (window_size == 0)
+		{
+			RUDP_LOG_DEBUG("Packet validity error:\n\tReceived SYN packet with invalid window size: {}; the minimum window size is 1 packet.", window_size);
+			return 0;
+		}
+
+		if (ack_ratio == 0)
+		{
+			RUDP_LOG_DEBUG("Packet validity error:\n\tReceived SYN packet with invalid ACK ratio: {}; the minimum ACK ratio is 1 packet.", ack_ratio);
 			return 0;
 		}
 	}
@@ -182,22 +176,18 @@ int RUDP_Socket_p::_check_packet_validity(void *packet, uint32_t packet_size, ui
 		{
 			if (expected_flags & RUDP_FLAG_SYN)
 			{
-				if (m_debugMode && (expected_flags == RUDP_FLAG_SYN)) std::cerr << "Warning: Received a disconnection request, but there is no active connection." << std::endl;
+				if (expected_flags == RUDP_FLAG_SYN) RUDP_LOG_DEBUG("Warning: Received a disconnection request, but there is no active connection.");
 				return -1;
 			}
 
-			if (m_debugMode)
-			{
-				std::cerr << "Packet validity error:" << std::endl;
-				std::cerr << "\tReceived a disconnection request, but there is no active connection." << std::endl;
-			}
+			RUDP_LOG_DEBUG("Packet validity error:\n\tReceived a disconnection request, but there is no active connection.");
 
 			return 0;
 		}
 
 		if ((expected_flags == RUDP_FLAG_FIN) || expected_flags == (RUDP_FLAG_FIN | RUDP_FLAG_ACK)) return 1;
 
-		if (m_debugMode) std::cout << "Received a disconnection request, closing the connection with " << inet_ntoa(m_destinationAddress4.sin_addr) << ":" << ntohs(m_destinationAddress4.sin_port) << "." << std::endl;
+		RUDP_LOG_DEBUG("Received a disconnection request, closing the connection with {}:{}.", inet_ntoa(m_destinationAddress4.sin_addr), ntohs(m_destinationAddress4.sin_port));
 		_send_control_packet(RUDP_FLAG_FIN | RUDP_FLAG_ACK, 0, nullptr, 0);
 		m_isConnected = false;
 		return -1;
@@ -205,7 +195,7 @@ int RUDP_Socket_p::_check_packet_validity(void *packet, uint32_t packet_size, ui
 
 	if ((header->flags & RUDP_FLAG_FIN) && (expected_flags == RUDP_FLAG_FIN || expected_flags == (RUDP_FLAG_FIN | RUDP_FLAG_ACK)))
 	{
-		if (m_debugMode) std::cout << "Peer has acknowledged the disconnection request, closing the connection." << std::endl;
+		RUDP_LOG_DEBUG("Peer has acknowledged the disconnection request, closing the connection.");
 		m_isConnected = false;
 		return -1;
 	}
@@ -213,11 +203,11 @@ int RUDP_Socket_p::_check_packet_validity(void *packet, uint32_t packet_size, ui
 	if (expected_flags && (header->flags != expected_flags))
 	{
 		if (expected_flags & RUDP_FLAG_PSH && (header->flags & RUDP_FLAG_PSH)) return 1;
-		if (m_debugMode)
+		if (RUDP_LOG_DEBUG_ENABLED)
 		{
 			std::string expected_flags_str, received_flags_str;
 
-			for (size_t i = 0; i < 5; i++)
+			for (size_t i = 0; i < 8; i++)
 			{
 				if (expected_flags & (1 << i)) expected_flags_str += flag_names[i] + ", ";
 				if (header->flags & (1 << i)) received_flags_str += flag_names[i] + ", ";
@@ -228,9 +218,7 @@ int RUDP_Socket_p::_check_packet_validity(void *packet, uint32_t packet_size, ui
 			received_flags_str.pop_back();
 			received_flags_str.pop_back();
 
-			std::cerr << "Packet validity error:" << std::endl;
-			std::cerr << "\tExpected flags: " << expected_flags_str << std::endl;
-			std::cerr << "\tReceived flags: " << received_flags_str << std::endl;
+			RUDP_LOG_DEBUG("Packet validity error:\n\tExpected flags: {}\n\tReceived flags: {}", expected_flags_str, received_flags_str);
 		}
 		
 		return 0;
@@ -251,7 +239,102 @@ void RUDP_Socket_p::_print_socket_error(std::string message, bool throw_exceptio
 	strerror_r(last_error, err_buf, sizeof(err_buf));
 
 	if (throw_exception) throw std::runtime_error(message + ": " + err_buf);
-	else std::cerr << message << ": " << err_buf << std::endl;
+	else RUDP_LOG_ERROR("{}: {}", message, err_buf);
+}
+
+void RUDP_Socket_p::_set_non_blocking(SOCKET socket, bool non_blocking) {
+#if defined(_OPSYS_WINDOWS)
+	u_long mode = non_blocking ? 1 : 0;
+	if (ioctlsocket(socket, FIONBIO, &mode) == SOCKET_ERROR) _print_socket_error("Failed to change the socket blocking mode", true);
+#elif defined(_OPSYS_UNIX)
+	int flags = fcntl(socket, F_GETFL, 0);
+	if (flags == -1 || fcntl(socket, F_SETFL, non_blocking ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK)) == -1) _print_socket_error("Failed to change the socket blocking mode", true);
+#endif
+}
+
+bool RUDP_Socket_p::_set_dont_fragment(SOCKET socket, bool dont_fragment) {
+#if defined(_OPSYS_WINDOWS)
+	DWORD value = dont_fragment ? 1 : 0;
+	return (setsockopt(socket, IPPROTO_IP, IP_DONTFRAGMENT, (const char *)&value, sizeof(value)) != SOCKET_ERROR);
+#elif defined(IP_MTU_DISCOVER)
+	int value = dont_fragment ? IP_PMTUDISC_DO : IP_PMTUDISC_DONT;
+	return (setsockopt(socket, IPPROTO_IP, IP_MTU_DISCOVER, &value, sizeof(value)) != SOCKET_ERROR);
+#elif defined(IP_DONTFRAG)
+	int value = dont_fragment ? 1 : 0;
+	return (setsockopt(socket, IPPROTO_IP, IP_DONTFRAG, &value, sizeof(value)) != SOCKET_ERROR);
+#else
+	(void)socket;
+	(void)dont_fragment;
+	return false;
+#endif
+}
+
+bool RUDP_Socket_p::_set_txtime(SOCKET socket) {
+#if defined(SO_TXTIME) && defined(__linux__)
+	// std::chrono::steady_clock is the monotonic clock, so the departure times come straight from it.
+	struct sock_txtime txtime = {
+		.clockid = CLOCK_MONOTONIC,
+		.flags = 0
+	};
+	return (setsockopt(socket, SOL_SOCKET, SO_TXTIME, &txtime, sizeof(txtime)) != SOCKET_ERROR);
+#else
+	(void)socket;
+	return false;
+#endif
+}
+
+uint32_t RUDP_Socket_p::_grow_socket_buffer(SOCKET socket, bool receive, uint32_t bytes) {
+	int option = receive ? SO_RCVBUF : SO_SNDBUF, size = 0;
+	socklen_t size_len = sizeof(size);
+
+	if (getsockopt(socket, SOL_SOCKET, option, (char *)&size, &size_len) == SOCKET_ERROR) return 0;
+	if (size >= (int)bytes) return (uint32_t)size;
+
+	int value = (int)bytes;
+
+#if defined(__linux__)
+	// Linux doubles the size it is given to cover its overhead, and reports the doubled size.
+	value /= 2;
+#endif
+
+#if defined(SO_RCVBUFFORCE) && defined(SO_SNDBUFFORCE)
+	// Only a privileged process may go past net.core.rmem_max / wmem_max, everyone else gets clamped to them below.
+	if (setsockopt(socket, SOL_SOCKET, receive ? SO_RCVBUFFORCE : SO_SNDBUFFORCE, &value, sizeof(value)) == SOCKET_ERROR)
+#endif
+	setsockopt(socket, SOL_SOCKET, option, (const char *)&value, sizeof(value));
+
+	size_len = sizeof(size);
+	if (getsockopt(socket, SOL_SOCKET, option, (char *)&size, &size_len) == SOCKET_ERROR) return 0;
+	return (uint32_t)size;
+}
+
+bool RUDP_Socket_p::_set_drop_counting(SOCKET socket) {
+#if defined(SO_RXQ_OVFL) && defined(__linux__)
+	int enable = 1;
+	return (setsockopt(socket, SOL_SOCKET, SO_RXQ_OVFL, &enable, sizeof(enable)) != SOCKET_ERROR);
+#else
+	(void)socket;
+	return false;
+#endif
+}
+
+bool RUDP_Socket_p::_connect_socket(bool connect) {
+	if (connect)
+	{
+		m_socketConnected = (::connect(m_socketHandle, (struct sockaddr *)&m_destinationAddress4, sizeof(m_destinationAddress4)) != SOCKET_ERROR);
+		return m_socketConnected;
+	}
+
+	if (!m_socketConnected) return true;
+
+	// An unspecified (all zero) address dissolves the association, some platforms report an error even though it worked.
+	struct sockaddr_in any_addr;
+	memset(&any_addr, 0, sizeof(any_addr));
+	any_addr.sin_family = AF_UNSPEC;
+
+	::connect(m_socketHandle, (struct sockaddr *)&any_addr, sizeof(any_addr));
+	m_socketConnected = false;
+	return true;
 }
 
 RUDP_Socket_p::RUDP_Socket_p(bool isServer, uint16_t listen_port, uint16_t MTU, uint16_t timeout, uint16_t max_retries, bool debug_mode): m_isServer(isServer), m_debugMode(debug_mode), m_protocolMTU(MTU), m_protocolTimeout(timeout), m_protocolMaximumRetries(max_retries) {
@@ -290,8 +373,15 @@ RUDP_Socket_p::~RUDP_Socket_p() {
 	}
 	catch (const std::exception &e)
 	{
-		std::cerr << static_cast<void *>(this) << "->disconnect(): " << e.what() << std::endl;
+		RUDP_LOG_ERROR("{}->disconnect(): {}", static_cast<void *>(this), e.what());
 	}
+
+	_engine_stop(false);
+
+	std::vector<uint8_t> *message = nullptr;
+	while (m_recvQueue.pop(message)) delete message;
+	for (auto stale : m_rxBacklog) delete stale;
+	delete m_rxMessage;
 	
 	if (m_socketHandle != INVALID_SOCKET)
 	{
@@ -306,17 +396,18 @@ bool RUDP_Socket_p::connect(const char *dest_ip, uint16_t dest_port) {
 	if (m_isServer) throw std::runtime_error("Server sockets cannot connect to other servers. Use accept() instead.");
 	if (m_isConnected) throw std::runtime_error("There is already an active connection. Use disconnect() to close it.");
 
+	// Reap the I/O engine of a connection that was closed by the peer.
+	_engine_stop(false);
+
 	memset(&m_destinationAddress4, 0, sizeof(m_destinationAddress4));
 	m_destinationAddress4.sin_family = AF_INET;
 	m_destinationAddress4.sin_port = htons(dest_port);
 
 	if (inet_pton(AF_INET, dest_ip, &m_destinationAddress4.sin_addr) <= 0) _print_socket_error("Failed to convert the IP address", true);
+	if (!_connect_socket(true)) _print_socket_error("Failed to connect the socket to " + std::string(dest_ip) + ":" + std::to_string(dest_port), true);
 
 	uint8_t buffer[m_protocolMTU] = {0};
 
-	struct sockaddr_in server_addr;
-	size_t server_addr_len = sizeof(server_addr);
-
 	for (size_t num_of_tries = 0; num_of_tries < m_protocolMaximumRetries; num_of_tries++)
 	{
 		memset(buffer, 0, sizeof(buffer));
@@ -332,25 +423,30 @@ bool RUDP_Socket_p::connect(const char *dest_ip, uint16_t dest_port) {
 
 		else if (ret == 0)
 		{
-			if (m_debugMode) std::cerr << "Warning: Timeout occurred while waiting for a response packet. Retrying connection (" << num_of_tries + 1 << "/" << m_protocolMaximumRetries << ")" << std::endl;
+			RUDP_LOG_DEBUG("Warning: Timeout occurred while waiting for a response packet. Retrying connection ({}/{})", num_of_tries + 1, m_protocolMaximumRetries);
 			continue;
 		}
 
-		int bytes_recv = recvfrom(m_socketHandle, (char *)buffer, sizeof(buffer), 0, (struct sockaddr *)&server_addr, (socklen_t *)&server_addr_len);
+		int bytes_recv = ::recv(m_socketHandle, (char *)buffer, sizeof(buffer), 0);
 
-		if (bytes_recv == SOCKET_ERROR) _print_socket_error("Failed to receive a response packet", true);
-		else if (_check_packet_source((struct sockaddr *)&server_addr, server_addr_len))
+		if (bytes_recv == SOCKET_ERROR)
 		{
-			num_of_tries--;
+			if (!rudp_is_connection_refused()) _print_socket_error("Failed to receive a response packet", true);
+
+			// The server may be between two connections, so give it the same time as a lost response.
+			RUDP_LOG_DEBUG("Warning: Nothing is listening on the destination port. Retrying connection ({}/{})", num_of_tries + 1, m_protocolMaximumRetries);
+			std::this_thread::sleep_for(std::chrono::milliseconds(m_protocolTimeout));
 			continue;
 		}
 
+		_flight_record(RUDP_FLIGHT_RECORDER_RECEIVED, buffer, bytes_recv);
+
 		int packet_validity = _check_packet_validity(buffer, bytes_recv, RUDP_FLAG_SYN | RUDP_FLAG_ACK);
 
 		switch (packet_validity)
 		{
 			case 0:
-				if (m_debugMode) std::cerr << "Warning: Malformed response packet received, retrying connection (" << num_of_tries + 1 << "/" << m_protocolMaximumRetries << ")." << std::endl;
+				RUDP_LOG_DEBUG("Warning: Malformed response packet received, retrying connection ({}/{}).", num_of_tries + 1, m_protocolMaximumRetries);
 				break;
 
 			case -1:
@@ -359,32 +455,27 @@ bool RUDP_Socket_p::connect(const char *dest_ip, uint16_t dest_port) {
 
 			default:
 				m_isConnected = true;
-				std::cout << "Connection established with " << dest_ip << ":" << dest_port << std::endl;
+				RUDP_LOG_INFO("Connection established with {}:{}", dest_ip, dest_port);
 
 				RUDP_SYN_packet *syn_packet = (RUDP_SYN_packet *)(buffer + sizeof(RUDP_header));
 				m_peersMTU = ntohs(syn_packet->MTU);
+				m_peersWindowSize = ntohs(syn_packet->window_size);
+				m_peersAckRatio = ntohs(syn_packet->ack_ratio);
+				m_peersAckDelay = ntohs(syn_packet->ack_delay);
 
-				if (m_debugMode)
-				{
-					std::cout << "Peer connection information:" << std::endl;
-					std::cout << "\tMTU: " << m_peersMTU << " bytes" << std::endl;
-					std::cout << "\tTimeout: " << ntohs(syn_packet->timeout) << " milliseconds" << std::endl;
-					std::cout << "\tMaximum number of retries: " << ntohs(syn_packet->max_retries) << std::endl;
-					std::cout << "\tDebug mode: " << ntohs(syn_packet->debug_mode) << std::endl;
-
-					if (m_peersMTU < m_protocolMTU)
-					{
-						std::cerr << "Warning: MTU mismatch: configured " << m_protocolMTU << " bytes, peer's MTU is " << m_peersMTU << " bytes; Automatic readjustment of the MTU value for this connection." << std::endl;
-						std::cerr << "You can use forceUseOwnMTU() to force the use of the configured MTU value instead, but this may cause issues with the connection." << std::endl;
-					}
-				}
+				RUDP_LOG_DEBUG("Peer connection information:\n\tMTU: {} bytes\n\tTimeout: {} milliseconds\n\tMaximum number of retries: {}\n\tDebug mode: {}\n\tWindow size: {} packets\n\tACK ratio: {} packets, ACK delay: {} microseconds",
+					m_peersMTU, ntohs(syn_packet->timeout), ntohs(syn_packet->max_retries), ntohs(syn_packet->debug_mode), m_peersWindowSize, m_peersAckRatio, m_peersAckDelay);
 
+				if (m_peersMTU < m_protocolMTU) RUDP_LOG_DEBUG("Warning: MTU mismatch: configured {} bytes, peer's MTU is {} bytes; Automatic readjustment of the MTU value for this connection.\nYou can use forceUseOwnMTU() to force the use of the configured MTU value instead, but this may cause issues with the connection.", m_protocolMTU, m_peersMTU);
+
+				_engine_start();
 				return true;
 		}
 	}
 
-	std::cerr << "Failed to connect to " << dest_ip << ":" << dest_port << std::endl;
-	std::cerr << "Please check the server's IP address and port number." << std::endl;
+	RUDP_LOG_ERROR("Failed to connect to {}:{}\nPlease check the server's IP address and port number.", dest_ip, dest_port);
+
+	_flight_recorder_dump_on_failure();
 
 	return false;
 }
@@ -394,6 +485,10 @@ bool RUDP_Socket_p::accept()
 	if (!m_isServer) throw std::runtime_error("Client sockets cannot accept connections. Use connect() instead.");
 	if (m_isConnected) throw std::runtime_error("There is already an active connection. Use disconnect() to close it.");
 
+	// Reap the I/O engine of a connection that was closed by the peer, and listen to everyone again.
+	_engine_stop(false);
+	_connect_socket(false);
+
 	uint8_t buffer[m_protocolMTU] = {0};
 
 	struct sockaddr_in client_addr;
@@ -406,11 +501,13 @@ bool RUDP_Socket_p::accept()
 
 		if (bytes_recv == SOCKET_ERROR) _print_socket_error("Failed to receive a connection request packet", true);
 
+		_flight_record(RUDP_FLIGHT_RECORDER_RECEIVED, buffer, bytes_recv);
+
 		int packet_validity = _check_packet_validity(buffer, bytes_recv, RUDP_FLAG_SYN);
 
 		if (packet_validity != 1)
 		{
-			if (m_debugMode) std::cerr << "Warning: Received an invalid connection request packet from " << inet_ntoa(client_addr.sin_addr) << ":" << ntohs(client_addr.sin_port) << ", ignoring the packet." << std::endl;
+			RUDP_LOG_DEBUG("Warning: Received an invalid connection request packet from {}:{}, ignoring the packet.", inet_ntoa(client_addr.sin_addr), ntohs(client_addr.sin_port));
 			if (packet_validity == -1) _send_control_packet(RUDP_FLAG_FIN | RUDP_FLAG_ACK, 0, (struct sockaddr *)&client_addr, client_addr_len);
 			continue;
 		}
@@ -419,299 +516,178 @@ bool RUDP_Socket_p::accept()
 
 		RUDP_SYN_packet *syn_packet = (RUDP_SYN_packet *)(buffer + sizeof(RUDP_header));
 		m_peersMTU = ntohs(syn_packet->MTU);
+		m_peersWindowSize = ntohs(syn_packet->window_size);
+		m_peersAckRatio = ntohs(syn_packet->ack_ratio);
+		m_peersAckDelay = ntohs(syn_packet->ack_delay);
 
-		if (m_debugMode)
-		{
-			std::cout << "Peer connection information:" << std::endl;
-			std::cout << "\tMTU: " << m_peersMTU << " bytes" << std::endl;
-			std::cout << "\tTimeout: " << ntohs(syn_packet->timeout) << " milliseconds" << std::endl;
-			std::cout << "\tMaximum number of retries: " << ntohs(syn_packet->max_retries) << std::endl;
-			std::cout << "\tDebug mode: " << ntohs(syn_packet->debug_mode) << std::endl;
+		RUDP_LOG_DEBUG("Peer connection information:\n\tMTU: {} bytes\n\tTimeout: {} milliseconds\n\tMaximum number of retries: {}\n\tDebug mode: {}\n\tWindow size: {} packets\n\tACK ratio: {} packets, ACK delay: {} microseconds",
+			m_peersMTU, ntohs(syn_packet->timeout), ntohs(syn_packet->max_retries), ntohs(syn_packet->debug_mode), m_peersWindowSize, m_peersAckRatio, m_peersAckDelay);
 
-			if (m_peersMTU < m_protocolMTU)
-			{
-				std::cerr << "Warning: MTU mismatch: configured " << m_protocolMTU << " bytes, peer's MTU is " << m_peersMTU << " bytes; Automatic readjustment of the MTU value for this connection." << std::endl;
-				std::cerr << "You can use forceUseOwnMTU() to force the use of the configured MTU value instead, but this may cause issues with the connection." << std::endl;
-			}
-		}
+		if (m_peersMTU < m_protocolMTU) RUDP_LOG_DEBUG("Warning: MTU mismatch: configured {} bytes, peer's MTU is {} bytes; Automatic readjustment of the MTU value for this connection.\nYou can use forceUseOwnMTU() to force the use of the configured MTU value instead, but this may cause issues with the connection.", m_protocolMTU, m_peersMTU);
 		
 		memcpy(&m_destinationAddress4, &client_addr, client_addr_len);
+
+		if (!_connect_socket(true))
+		{
+			m_isConnected = false;
+			_print_socket_error("Failed to connect the socket to the peer", true);
+		}
+
 		_send_control_packet(RUDP_FLAG_SYN | RUDP_FLAG_ACK, 0, nullptr, 0);
 		break;
 	}
 
-	std::cout << "Connection established with " << inet_ntoa(m_destinationAddress4.sin_addr) << ":" << ntohs(m_destinationAddress4.sin_port) << std::endl;
-	
+	RUDP_LOG_INFO("Connection established with {}:{}", inet_ntoa(m_destinationAddress4.sin_addr), ntohs(m_destinationAddress4.sin_port));
+
+	_engine_start();
 	return true;
 }
 
-int RUDP_Socket_p::recv(void *buffer, uint32_t buffer_size)
+int64_t RUDP_Socket_p::recv(void *buffer, uint64_t buffer_size)
 {
-	if (!m_isConnected)
-		throw std::runtime_error("There is no active connection to receive data from.");
-
 	if (buffer == nullptr)
 		throw std::runtime_error("Buffer is null.");
 
-	uint8_t packet[m_protocolMTU] = {0}, *buffer_ptr = (uint8_t *)buffer;
-	uint32_t total_packets = 0, total_actual_packets = 0, prev_seq_num = UINT32_MAX;
-	int total_bytes = 0, total_actual_bytes = 0, dup_packets = 0, bytes_recv = 0;
-	int packet_validity = 0;
+	// A connection closed by the peer still has its engine around, so the receiver gets 0 (end of stream) instead of an error.
+	// Messages are never empty, send() and sendAsync() refuse them, so 0 means only that.
+	if (!m_isConnected && m_recvQueue.empty() && !m_engineThread.joinable())
+		throw std::runtime_error("There is no active connection to receive data from.");
 
-	struct sockaddr_in source_addr;
-	socklen_t source_addr_len = sizeof(source_addr);
+	std::vector<uint8_t> *message = nullptr;
 
-	for (size_t num_of_tries = 0; num_of_tries <= m_protocolMaximumRetries; num_of_tries++)
 	{
-		if (num_of_tries == m_protocolMaximumRetries) throw std::runtime_error("Failed to receive the first packet: maximum number of retries reached (" + std::to_string(m_protocolMaximumRetries) + ")");
-
-		bytes_recv = recvfrom(m_socketHandle, (char *)packet, sizeof(packet), 0, (struct sockaddr *)&source_addr, &source_addr_len);
-
-		if (bytes_recv == SOCKET_ERROR) _print_socket_error("Failed to receive the first packet", true);
-		else if (_check_packet_source((struct sockaddr *)&source_addr, source_addr_len))
-		{
-			num_of_tries--;
-			continue;
-		}
-
-		packet_validity = _check_packet_validity(packet, bytes_recv, RUDP_FLAG_PSH);
+		std::unique_lock<std::mutex> lock(m_waitMutex);
+		m_recvCondition.wait(lock, [this] { return !m_recvQueue.empty() || !m_engineRunning; });
 
-		if (packet_validity == 0)
+		if (!m_recvQueue.pop(message))
 		{
-			if (m_debugMode) std::cerr << "Retrying to receive the first packet (" << num_of_tries + 1 << "/" << m_protocolMaximumRetries << ")" << std::endl;
-			continue;
+			if (!m_engineError.empty()) throw std::runtime_error(m_engineError);
+			return 0;
 		}
-
-		else if (packet_validity == -1) return 0;
-		break;
 	}
 
-	total_bytes += (bytes_recv - sizeof(RUDP_header));
-
-	memcpy(buffer_ptr, packet + sizeof(RUDP_header), ((total_bytes > (int)buffer_size) ? buffer_size : total_bytes));
-	total_packets++;
-	total_actual_bytes += bytes_recv;
-	total_actual_packets++;
-	prev_seq_num = ntohl(((RUDP_header *)packet)->seq_num);
+	m_rxBufferedBytes.fetch_sub(message->size(), std::memory_order_acq_rel);
 
-	_send_control_packet(RUDP_FLAG_ACK, prev_seq_num, nullptr, 0);
-
-	if (total_bytes > (int)buffer_size)
+	// A batch may bring more messages than the queue holds, and the rest only move on when the engine runs again.
+	// Reading also makes room in a small receive window, which the engine announces to the peer.
+	if (m_rxBacklogged.load(std::memory_order_acquire) || m_rxWindowLow.load(std::memory_order_acquire))
 	{
-		if (m_debugMode) 
-		{
-			std::cerr << "Warning: Buffer overflow detected, stopping the reception." << std::endl;
-			std::cerr << "Received " << total_bytes << " bytes over " << total_packets << " packets, but could only store " << buffer_size << " bytes." << std::endl;
-		}
-		return total_bytes;
+		m_sendersInside++;
+		if (m_engineRunning) _engine_wake();
+		m_sendersInside--;
 	}
 
-	if (((RUDP_header *)packet)->flags & RUDP_FLAG_LAST)
-	{
-		if (m_debugMode) std::cout << "Received " << total_bytes << " bytes over " << total_packets << " packets." << std::endl;
-		return total_bytes;
-	}
+	uint64_t total_bytes = message->size();
 
-	while (true)
+	if (total_bytes > buffer_size)
 	{
-		for (size_t num_of_tries = 0; num_of_tries <= m_protocolMaximumRetries; num_of_tries++)
-		{
-			if (num_of_tries == m_protocolMaximumRetries) throw std::runtime_error("Failed to receive the packet: maximum number of retries reached (" + std::to_string(m_protocolMaximumRetries) + ")");
-
-			memset(packet, 0, sizeof(packet));
-
-			pollfd poll_fd[1] = {
-				{.fd = m_socketHandle, .events = POLLIN, .revents = 0 }
-			};
-			int ret = poll(poll_fd, 1, m_protocolTimeout);
-			if (ret == SOCKET_ERROR) _print_socket_error("Failed to poll the socket", true);
-			else if (ret == 0)
-			{
-				if (m_debugMode) std::cerr << "Warning: Timeout occurred while waiting for a data packet with sequence number " << prev_seq_num + 1 << ". Retrying (" << num_of_tries + 1 << "/" << m_protocolMaximumRetries << ")" << std::endl;
-				continue;
-			}
-
-			bytes_recv = recvfrom(m_socketHandle, (char *)packet, sizeof(packet), 0, (struct sockaddr *)&source_addr, &source_addr_len);
-
-			if (bytes_recv == SOCKET_ERROR) _print_socket_error("Failed to receive a packet", true);
-			else if (_check_packet_source((struct sockaddr *)&source_addr, source_addr_len))
-			{
-				num_of_tries--;
-				continue;
-			}
-
-			packet_validity = _check_packet_validity(packet, bytes_recv, RUDP_FLAG_PSH);
-
-			total_actual_bytes += bytes_recv;
-			total_actual_packets++;
+		RUDP_LOG_DEBUG("Warning: Buffer overflow detected, truncating the message.\nReceived {} bytes, but could only store {} bytes.", total_bytes, buffer_size);
 
-			if (packet_validity == 0)
-			{
-				if (m_debugMode) std::cerr << "Retrying to receive the packet with sequence number " << prev_seq_num + 1 << " (" << num_of_tries + 1 << "/" << m_protocolMaximumRetries << ")" << std::endl;
-				continue;
-			}
-			else if (packet_validity == -1) return 0;
+		total_bytes = buffer_size;
+	}
 
-			break;
-		}
+	memcpy(buffer, message->data(), total_bytes);
+	delete message;
 
-		RUDP_header *header = (RUDP_header *)packet;
-		uint32_t packet_seq_num = ntohl(header->seq_num);
-		uint16_t packet_size = ntohs(header->length);
-		uint32_t offset = ntohl(header->seq_num) * (std::min(m_protocolMTU, m_peersMTU) - sizeof(RUDP_header));
+	return (int64_t)total_bytes;
+}
 
-		if (packet_seq_num == prev_seq_num)
-		{
-			if (m_debugMode) std::cerr << "Warning: Received a duplicate packet with sequence number " << packet_seq_num << ", send duplicate ACK packet." << std::endl;
-			dup_packets++;
-			_send_control_packet(RUDP_FLAG_ACK, prev_seq_num, nullptr, 0);
-			continue;
-		}
+int64_t RUDP_Socket_p::send(void *buffer, uint64_t buffer_size)
+{
+	if (!m_isConnected) throw std::runtime_error("There is no active connection to send data to.");
+	if (buffer == nullptr) throw std::runtime_error("Buffer is null.");
 
-		if (packet_seq_num != (prev_seq_num + 1))
-		{
-			if (m_debugMode) std::cerr << "Warning: Received an out-of-order packet with sequence number " << packet_seq_num << ", expected " << (prev_seq_num + 1) << ", retrying to receive the packet." << std::endl;
-			_send_control_packet(RUDP_FLAG_ACK, prev_seq_num, nullptr, 0);
-			continue;
-		}
+	// recv() returns 0 for the end of the stream, an empty message would look just like it.
+	if (buffer_size == 0) throw std::runtime_error("Can't send an empty message.");
+	if (buffer_size > RUDP_MAX_MESSAGE_SIZE) throw std::runtime_error("Message too large: " + std::to_string(buffer_size) + " bytes, the maximum message size is " + std::to_string(RUDP_MAX_MESSAGE_SIZE) + " bytes.");
 
-		total_bytes += packet_size;
-		total_packets++;
-		prev_seq_num = packet_seq_num;
+	RUDP_send_request request;
+	request.data = (const uint8_t *)buffer;
+	request.size = buffer_size;
+	request.submitted_at = std::chrono::steady_clock::now();
 
-		if ((offset + packet_size) > buffer_size) packet_size = buffer_size - offset;
-		memcpy((buffer_ptr + offset), (packet + sizeof(RUDP_header)), packet_size);
-		_send_control_packet(RUDP_FLAG_ACK, packet_seq_num, nullptr, 0);
+	_engine_submit(&request, true);
 
-		if ((header->flags & RUDP_FLAG_LAST) != 0)
-		{
-			if (m_debugMode) std::cout << "Received the last packet, stopping the reception." << std::endl;
-			break;
-		}
-		
-		if (total_bytes > ((int32_t)buffer_size))
-		{
-			if (m_debugMode) std::cout << "Warning: Buffer overflow detected, stopping the reception." << std::endl;
-			break;
-		}
+	{
+		std::unique_lock<std::mutex> lock(m_waitMutex);
+		m_sendCondition.wait(lock, [&request] { return request.state.load(std::memory_order_acquire) != RUDP_REQUEST_PENDING; });
 	}
 
-	if (m_debugMode)
+	switch (request.state.load(std::memory_order_acquire))
 	{
-		std::cout << "Received " << total_bytes << " bytes over " << total_packets << " packets." << std::endl;
-		std::cout << "Actual overhead: " << total_actual_bytes << " bytes over " << total_actual_packets << " packets, of which " << dup_packets << " are duplicate packets." << std::endl;
-	}
+		case RUDP_REQUEST_DONE:
+			return request.result;
+
+		case RUDP_REQUEST_FAILED:
+			throw std::runtime_error(request.error);
 
-	return total_bytes;
+		default:
+			return 0;
+	}
 }
 
-int RUDP_Socket_p::send(void *buffer, uint32_t buffer_size)
+int64_t RUDP_Socket_p::sendAsync(const void *buffer, uint64_t buffer_size)
 {
 	if (!m_isConnected) throw std::runtime_error("There is no active connection to send data to.");
 	if (buffer == nullptr) throw std::runtime_error("Buffer is null.");
-	
-	uint8_t packet[m_protocolMTU] = {0}, *buffer_ptr = (uint8_t *)buffer;
-	uint32_t total_packets = 0, total_actual_packets = 0, expected_packets = ((buffer_size / (std::min(m_protocolMTU, m_peersMTU) - sizeof(RUDP_header))) + 1), prev_seq_num = UINT32_MAX;
-	int total_bytes = 0, total_actual_bytes = 0, retry_packets = 0;
-
-	struct sockaddr_in source_addr;
-	socklen_t source_addr_len = sizeof(source_addr);
+	if (buffer_size == 0) throw std::runtime_error("Can't send an empty message.");
+	if (buffer_size > RUDP_MAX_MESSAGE_SIZE) throw std::runtime_error("Message too large: " + std::to_string(buffer_size) + " bytes, the maximum message size is " + std::to_string(RUDP_MAX_MESSAGE_SIZE) + " bytes.");
 
-	if (m_debugMode) std::cout << "Sending " << buffer_size << " bytes over " << expected_packets << " packets." << std::endl;
+	RUDP_send_request *request = new RUDP_send_request;
+	request->storage.assign((const uint8_t *)buffer, (const uint8_t *)buffer + buffer_size);
+	request->data = request->storage.data();
+	request->size = buffer_size;
+	request->detached = true;
+	request->submitted_at = std::chrono::steady_clock::now();
 
-	for (uint32_t i = 0; i < expected_packets; i++)
+	try
 	{
-		uint32_t packet_size = std::min(buffer_size - (uint32_t)total_bytes, (uint32_t)(std::min(m_protocolMTU, m_peersMTU) - sizeof(RUDP_header)));
-		memset(packet, 0, sizeof(packet));
-		memcpy(packet + sizeof(RUDP_header), buffer_ptr + (uint32_t)total_bytes, packet_size);
-
-		RUDP_header *header = (RUDP_header *)packet;
-		header->flags = (i == expected_packets - 1) ? (RUDP_FLAG_PSH | RUDP_FLAG_LAST) : RUDP_FLAG_PSH;
-		header->length = htons(packet_size);
-		header->seq_num = htonl(total_packets);
-		header->checksum = htons(RUDP_Socket_p::_calculate_checksum(packet, sizeof(RUDP_header) + packet_size));
-
-		for (size_t num_of_tries = 0; num_of_tries <= m_protocolMaximumRetries; num_of_tries++)
-		{
-			if (num_of_tries == m_protocolMaximumRetries) throw std::runtime_error("Failed to send the packet: maximum number of retries reached (" + std::to_string(m_protocolMaximumRetries) + ").");
-			else if (num_of_tries > 0) retry_packets++;
-
-			int bytes_sent = sendto(m_socketHandle, (char*)packet, sizeof(RUDP_header) + packet_size, 0, (struct sockaddr *)&m_destinationAddress4, sizeof(m_destinationAddress4));
-
-			if (bytes_sent == SOCKET_ERROR) _print_socket_error("Failed to send a packet", true);
-
-			total_actual_bytes += bytes_sent;
-			total_actual_packets++;
-
-			uint8_t ack_buffer[m_protocolMTU] = {0};
-
-			pollfd poll_fd[1] = {
-				{.fd = m_socketHandle, .events = POLLIN, .revents = 0 }
-			};
-			int ret = poll(poll_fd, 1, m_protocolTimeout);
-			if (ret == SOCKET_ERROR) _print_socket_error("Failed to poll the socket", true);
-			else if (ret == 0)
-			{
-				if (m_debugMode) std::cerr << "Warning: Timeout occurred while waiting for a response packet with sequence number " << total_packets << ", retrying to send the packet (" << num_of_tries + 1 << "/" << m_protocolMaximumRetries << ")" << std::endl;
-				continue;
-			}
-
-			int bytes_recv = recvfrom(m_socketHandle, (char*)ack_buffer, sizeof(ack_buffer), 0, (struct sockaddr *)&source_addr, &source_addr_len);
-			if (bytes_recv == SOCKET_ERROR) _print_socket_error("Failed to receive an ACK packet", true);
-			else if (_check_packet_source((struct sockaddr *)&source_addr, source_addr_len))
-			{
-				num_of_tries--;
-				continue;
-			}
-
-			int packet_validity = _check_packet_validity(ack_buffer, bytes_recv, RUDP_FLAG_ACK);
-			if (packet_validity == 0)
-			{
-				if (m_debugMode) std::cerr << "Retrying to send packet " << total_packets << " (" << num_of_tries + 1 << "/" << m_protocolMaximumRetries << ")" << std::endl;
-				continue;
-			}
-			else if (packet_validity == -1) return 0;
-
-			RUDP_header *ack_packet = (RUDP_header *)ack_buffer;
-			uint32_t ack_seq_num = ntohl(ack_packet->seq_num);
+		if (_engine_submit(request, false)) return (int64_t)buffer_size;
+	}
 
-			if (ack_seq_num == prev_seq_num && (i != (expected_packets - 1)))
-			{
-				if (m_debugMode) std::cout << "Warning: Received a duplicate ACK packet with sequence number " << ack_seq_num << ", continuing to the next packet." << std::endl;
-				break;
-			}
+	catch (const std::exception &)
+	{
+		delete request;
+		throw;
+	}
 
-			//if (ack_seq_num < total_packets)
-			//{
-				//if (m_debugMode) std::cerr << "Warning: Received an out-of-order ACK packet with sequence number " << ack_seq_num << " while expecting " << total_packets << ", continuing to the next packet." << std::endl;
-				//break;
-			//}
+	delete request;
+	return 0;
+}
 
-			prev_seq_num = ack_seq_num;
+void RUDP_Socket_p::cork() { m_sendCorked = true; }
 
-			total_bytes += packet_size;
-			total_packets++;
+void RUDP_Socket_p::uncork()
+{
+	m_sendCorked = false;
+	flush();
+}
 
-			break;
-		}
-	}
+void RUDP_Socket_p::flush()
+{
+	m_sendFlush = true;
 
-	if (m_debugMode)
-	{
-		std::cout << "Sent " << total_bytes << " bytes over " << total_packets << " packets." << std::endl;
-		std::cout << "Actual overhead: " << total_actual_bytes << " bytes over " << total_actual_packets << " packets, of which " << retry_packets << " are retransmissions." << std::endl;
-	}
-	
-	return total_bytes;
+	// Same handshake as _engine_submit(), so the wake up socket can't close under us.
+	m_sendersInside++;
+	if (m_engineRunning) _engine_wake();
+	m_sendersInside--;
 }
 
 bool RUDP_Socket_p::disconnect()
 {
 	if (!m_isConnected) throw std::runtime_error("There is no active connection to close.");
 
+	// The FIN goes out only once the peer has everything queued so far, so nothing sendAsync() took is lost silently.
+	_engine_stop(true);
+
+	bool delivered = (m_engineDiscarded == 0);
+
+	if (!delivered) RUDP_LOG_ERROR("Closing the connection with {} messages the peer didn't acknowledge, they are lost.", m_engineDiscarded);
+
+	// The peer may have closed the connection while the engine was stopping.
+	if (!m_isConnected) return delivered;
+
 	uint8_t buffer[m_protocolMTU] = {0};
-	struct sockaddr_in source_addr;
-	socklen_t source_addr_len = sizeof(source_addr);
 
 	for (size_t num_of_tries = 0; num_of_tries < m_protocolMaximumRetries; num_of_tries++)
 	{
@@ -728,38 +704,185 @@ bool RUDP_Socket_p::disconnect()
 
 		else if (ret == 0)
 		{
-			if (m_debugMode) std::cerr << "Warning: Timeout occurred while waiting for a response packet. Retrying disconnection (" << num_of_tries + 1 << "/" << m_protocolMaximumRetries << ")" << std::endl;
+			RUDP_LOG_DEBUG("Warning: Timeout occurred while waiting for a response packet. Retrying disconnection ({}/{})", num_of_tries + 1, m_protocolMaximumRetries);
 			continue;
 		}
 
-		int bytes_recv = recvfrom(m_socketHandle, (char *)buffer, sizeof(buffer), 0, (struct sockaddr *)&source_addr, &source_addr_len);
+		int bytes_recv = ::recv(m_socketHandle, (char *)buffer, sizeof(buffer), 0);
 
-		if (bytes_recv == SOCKET_ERROR) _print_socket_error("Failed to receive a response packet", true);
-		else if (_check_packet_source((struct sockaddr *)&source_addr, source_addr_len))
-		{
-			num_of_tries--;
-			continue;
-		}
+		if (bytes_recv == SOCKET_ERROR && !rudp_is_connection_refused()) _print_socket_error("Failed to receive a response packet", true);
+
+		_flight_record(RUDP_FLIGHT_RECORDER_RECEIVED, buffer, bytes_recv);
 
-		int packet_validity = _check_packet_validity(buffer, bytes_recv, RUDP_FLAG_FIN | RUDP_FLAG_ACK);
+		// The peer's socket is already gone, there is nobody left to acknowledge the disconnection.
+		int packet_validity = (bytes_recv == SOCKET_ERROR) ? -1 : _check_packet_validity(buffer, bytes_recv, RUDP_FLAG_FIN | RUDP_FLAG_ACK);
 
 		if (packet_validity == 0)
 		{
-			if (m_debugMode) std::cerr << "Warning: Received an invalid response packet, ignoring it. Retrying disconnection (" << num_of_tries + 1 << "/" << m_protocolMaximumRetries << ")" << std::endl;
+			RUDP_LOG_DEBUG("Warning: Received an invalid response packet, ignoring it. Retrying disconnection ({}/{})", num_of_tries + 1, m_protocolMaximumRetries);
 			continue;
 		}
 
 		m_isConnected = false;
-		std::cout << "Connection closed with " << inet_ntoa(m_destinationAddress4.sin_addr) << ":" << ntohs(m_destinationAddress4.sin_port) << std::endl;
+		RUDP_LOG_INFO("Connection closed with {}:{}", inet_ntoa(m_destinationAddress4.sin_addr), ntohs(m_destinationAddress4.sin_port));
 		memset(&m_destinationAddress4, 0, sizeof(m_destinationAddress4));
-		return true;
+		return delivered;
 	}
 
-	std::cerr << "Failed to disconnect from " << inet_ntoa(m_destinationAddress4.sin_addr) << ":" << ntohs(m_destinationAddress4.sin_port) << std::endl;
-	std::cerr << "Assuming that the connection is closed." << std::endl;
+	RUDP_LOG_ERROR("Failed to disconnect from {}:{}\nAssuming that the connection is closed.", inet_ntoa(m_destinationAddress4.sin_addr), ntohs(m_destinationAddress4.sin_port));
 
 	m_isConnected = false;
 	memset(&m_destinationAddress4, 0, sizeof(m_destinationAddress4));
 
-	return true;
-}
\ No newline at end of file
+	return delivered;
+}
+RUDP_stats RUDP_Socket_p::getStats() const
+{
+	RUDP_stats stats;
+
+	stats.bytes_sent = m_txActualBytes.load(std::memory_order_relaxed);
+	stats.packets_sent = m_txActualPackets.load(std::memory_order_relaxed);
+	stats.bytes_received = m_rxActualBytes.load(std::memory_order_relaxed);
+	stats.packets_received = m_rxActualPackets.load(std::memory_order_relaxed);
+	stats.messages_sent = m_txMessages.load(std::memory_order_relaxed);
+	stats.messages_received = m_rxMessages.load(std::memory_order_relaxed);
+	stats.retransmits = m_txRetryPackets.load(std::memory_order_relaxed);
+	stats.timeouts = m_txTimeouts.load(std::memory_order_relaxed);
+	stats.duplicates = m_rxDupPackets.load(std::memory_order_relaxed);
+	stats.checksum_failures = m_rxChecksumFailures.load(std::memory_order_relaxed);
+	stats.kernel_drops = m_rxKernelDrops.load(std::memory_order_relaxed);
+	stats.srtt_us = m_txSrtt.load(std::memory_order_relaxed);
+	stats.rttvar_us = m_txRttVar.load(std::memory_order_relaxed);
+
+	// The retransmission timeout is the negotiated timeout, it doesn't follow the round trip time.
+	stats.rto_us = (uint64_t)m_protocolTimeout * 1000;
+
+	// The engine sets its start and stop times before it announces the change, so whichever it shows is ready.
+	auto ended_at = m_engineRunning ? std::chrono::steady_clock::now() : m_engineStoppedAt;
+
+	stats.duration_us = (m_engineStartedAt == std::chrono::steady_clock::time_point() || ended_at < m_engineStartedAt) ? 0 : (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(ended_at - m_engineStartedAt).count();
+	stats.goodput = (stats.duration_us == 0) ? 0 : (uint64_t)((double)m_txMessageBytes.load(std::memory_order_relaxed) * 1000000.0 / stats.duration_us);
+
+	for (int phase = 0; phase < RUDP_PHASE_COUNT; phase++)
+	{
+		stats.phase_ns[phase] = m_phaseNs[phase].load(std::memory_order_relaxed);
+		stats.phase_count[phase] = m_phaseCount[phase].load(std::memory_order_relaxed);
+	}
+
+	return stats;
+}
+
+uint32_t RUDP_Socket_p::readTrace(RUDP_trace_event *events, uint32_t max_events)
+{
+	if (events == nullptr) throw std::runtime_error("Events buffer is null.");
+
+	std::lock_guard<std::mutex> lock(m_traceMutex);
+
+	if (m_traceRing == nullptr) return 0;
+
+	uint32_t count = 0;
+
+	while (count < max_events && m_traceRing->pop(events[count])) count++;
+
+	return count;
+}
+
+uint32_t RUDP_Socket_p::dumpFlightRecorder(const char *path) const
+{
+	if (path == nullptr) throw std::runtime_error("Flight recorder file path is null.");
+
+	// Copy the ring first, the I/O engine may keep recording while the file is written.
+	uint64_t end = m_flightRecorderNext.load(std::memory_order_acquire);
+	uint64_t begin = (end > RUDP_FLIGHT_RECORDER_SIZE) ? end - RUDP_FLIGHT_RECORDER_SIZE : 0;
+	std::vector<RUDP_flight_record> records;
+
+	records.reserve(end - begin);
+
+	for (uint64_t i = begin; i < end; i++)
+	{
+		const RUDP_flight_recorder_slot &slot = m_flightRecorder[i % RUDP_FLIGHT_RECORDER_SIZE];
+		uint64_t words[sizeof(RUDP_flight_record) / sizeof(uint64_t)];
+
+		// A seqlock read: the slot must hold packet i, completely written, before and after the copy.
+		// The oldest packets may have been overwritten since, those are left out.
+		uint64_t seq = slot.seq.load(std::memory_order_acquire);
+
+		if (seq != 2 * i + 2) continue;
+
+		for (size_t w = 0; w < sizeof(words) / sizeof(uint64_t); w++) words[w] = slot.words[w].load(std::memory_order_relaxed);
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+
+		if (slot.seq.load(std::memory_order_relaxed) != seq) continue;
+
+		records.emplace_back();
+		memcpy(&records.back(), words, sizeof(words));
+	}
+
+	std::ofstream file(path, std::ios::binary | std::ios::trunc);
+
+	if (!file) throw std::runtime_error("Failed to open " + std::string(path) + ": " + strerror(errno));
+
+	// The classic pcap format, in the byte order of this machine, which readers tell by the magic number.
+	struct {
+		uint32_t magic = 0xa1b2c3d4;
+		uint16_t version_major = 2;
+		uint16_t version_minor = 4;
+		int32_t thiszone = 0;
+		uint32_t sigfigs = 0;
+		uint32_t snaplen = RUDP_FLIGHT_RECORDER_PSEUDO_HEADER_SIZE + sizeof(RUDP_header);
+		uint32_t network = RUDP_FLIGHT_RECORDER_LINKTYPE;
+	} pcap_header;
+
+	file.write((const char *)&pcap_header, sizeof(pcap_header));
+
+	// The records are timed by the steady clock, pcap wants the time of day.
+	int64_t wall_offset_us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count() -
+		std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+
+	for (size_t i = 0; i < records.size(); i++)
+	{
+		const RUDP_flight_record &record = records[i];
+		uint64_t time_us = record.time_us + wall_offset_us;
+
+		struct {
+			uint32_t ts_sec;
+			uint32_t ts_usec;
+			uint32_t incl_len;
+			uint32_t orig_len;
+		} pcap_record = {
+			(uint32_t)(time_us / 1000000),
+			(uint32_t)(time_us % 1000000),
+			RUDP_FLIGHT_RECORDER_PSEUDO_HEADER_SIZE + (uint32_t)record.header_size,
+			RUDP_FLIGHT_RECORDER_PSEUDO_HEADER_SIZE + record.size
+		};
+
+		uint8_t pseudo_header[RUDP_FLIGHT_RECORDER_PSEUDO_HEADER_SIZE] = { record.direction, 0, 0, 0 };
+
+		file.write((const char *)&pcap_record, sizeof(pcap_record));
+		file.write((const char *)pseudo_header, sizeof(pseudo_header));
+		file.write((const char *)record.header, record.header_size);
+	}
+
+	file.close();
+
+	if (!file) throw std::runtime_error("Failed to write " + std::string(path) + ": " + strerror(errno));
+
+	return (uint32_t)records.size();
+}
+
+void RUDP_Socket_p::_flight_recorder_dump_on_failure()
+{
+	if (m_flightRecorderFile.empty()) return;
+
+	try
+	{
+		uint32_t packets = dumpFlightRecorder(m_flightRecorderFile.c_str());
+		RUDP_LOG_WARNING("The last {} packets of the connection were written to {}.", packets, m_flightRecorderFile);
+	}
+
+	catch (const std::exception &e)
+	{
+		RUDP_LOG_ERROR("Failed to dump the flight recorder: {}", e.what());
+	}
+}
@@ -100,9 +100,9 @@ extern "C"
 		return ret;
 	}
 
-	int rudp_recv(RUDP_socket socket, void *buffer, uint32_t buffer_size)
+	int64_t rudp_recv(RUDP_socket socket, void *buffer, uint64_t buffer_size)
 	{
-		int ret = -1;
+		int64_t ret = -1;
 
 		RUDP_Socket_p *sock = dynamic_cast<RUDP_Socket_p *>((RUDP_Socket_p *)socket);
 
@@ -120,7 +120,7 @@ extern "C"
 
 		catch (const std::exception &e)
 		{
-			typedef int (RUDP_Socket_p::*RecvMethod)(void *, uint32_t);
+			typedef int64_t (RUDP_Socket_p::*RecvMethod)(void *, uint64_t);
 			RecvMethod recvMethod = &RUDP_Socket_p::recv;
 			std::cerr << "rudp_recv() exception at " << static_cast<void *>(sock) << " in " << reinterpret_cast<void *&>(recvMethod) << " (recv):" << std::endl;
 			std::cerr << "\t" << e.what() << std::endl;
@@ -130,9 +130,9 @@ extern "C"
 		return ret;
 	}
 
-	int rudp_send(RUDP_socket socket, void *buffer, uint32_t buffer_size)
+	int64_t rudp_send(RUDP_socket socket, void *buffer, uint64_t buffer_size)
 	{
-		int ret = -1;
+		int64_t ret = -1;
 
 		RUDP_Socket_p *sock = dynamic_cast<RUDP_Socket_p *>((RUDP_Socket_p *)socket);
 
@@ -150,7 +150,7 @@ extern "C"
 
 		catch (const std::exception &e)
 		{
-			typedef int (RUDP_Socket_p::*SendMethod)(void *, uint32_t);
+			typedef int64_t (RUDP_Socket_p::*SendMethod)(void *, uint64_t);
 			SendMethod sendMethod = &RUDP_Socket_p::send;
 			std::cerr << "rudp_send() exception at " << static_cast<void *>(sock) << " in " << reinterpret_cast<void *&>(sendMethod) << " (send):" << std::endl;
 			std::cerr << "\t" << e.what() << std::endl;
@@ -160,6 +160,78 @@ extern "C"
 		return ret;
 	}
 
+	int64_t rudp_send_async(RUDP_socket socket, const void *buffer, uint64_t buffer_size)
+	{
+		int64_t ret = -1;
+
+		RUDP_Socket_p *sock = dynamic_cast<RUDP_Socket_p *>((RUDP_Socket_p *)socket);
+
+		if (sock == nullptr)
+		{
+			std::cerr << "rudp_send_async() exception at access to socket pointer:" << std::endl;
+			std::cerr << "\tInvalid socket pointer: Expected RUDP_Socket_p*, instead got NULL/invalid pointer." << std::endl;
+			return -1;
+		}
+
+		try
+		{
+			ret = sock->sendAsync(buffer, buffer_size);
+		}
+
+		catch (const std::exception &e)
+		{
+			typedef int64_t (RUDP_Socket_p::*SendAsyncMethod)(const void *, uint64_t);
+			SendAsyncMethod sendAsyncMethod = &RUDP_Socket_p::sendAsync;
+			std::cerr << "rudp_send_async() exception at " << static_cast<void *>(sock) << " in " << reinterpret_cast<void *&>(sendAsyncMethod) << " (sendAsync):" << std::endl;
+			std::cerr << "\t" << e.what() << std::endl;
+			return -1;
+		}
+
+		return ret;
+	}
+
+	void rudp_cork(RUDP_socket socket)
+	{
+		RUDP_Socket_p *sock = dynamic_cast<RUDP_Socket_p *>((RUDP_Socket_p *)socket);
+
+		if (sock == nullptr)
+		{
+			std::cerr << "rudp_cork() exception at access to socket pointer:" << std::endl;
+			std::cerr << "\tInvalid socket pointer: Expected RUDP_Socket_p*, instead got NULL/invalid pointer." << std::endl;
+			return;
+		}
+
+		sock->cork();
+	}
+
+	void rudp_uncork(RUDP_socket socket)
+	{
+		RUDP_Socket_p *sock = dynamic_cast<RUDP_Socket_p *>((RUDP_Socket_p *)socket);
+
+		if (sock == nullptr)
+		{
+			std::cerr << "rudp_uncork() exception at access to socket pointer:" << std::endl;
+			std::cerr << "\tInvalid socket pointer: Expected RUDP_Socket_p*, instead got NULL/invalid pointer." << std::endl;
+			return;
+		}
+
+		sock->uncork();
+	}
+
+	void rudp_flush(RUDP_socket socket)
+	{
+		RUDP_Socket_p *sock = dynamic_cast<RUDP_Socket_p *>((RUDP_Socket_p *)socket);
+
+		if (sock == nullptr)
+		{
+			std::cerr << "rudp_flush() exception at access to socket pointer:" << std::endl;
+			std::cerr << "\tInvalid socket pointer: Expected RUDP_Socket_p*, instead got NULL/invalid pointer." << std::endl;
+			return;
+		}
+
+		sock->flush();
+	}
+
 	bool rudp_disconnect(RUDP_socket socket)
 	{
 		bool ret = false;
@@ -256,6 +328,48 @@ extern "C"
 		return sock->getMaxRetries();
 	}
 
+	uint16_t rudp_get_window_size(RUDP_socket socket)
+	{
+		RUDP_Socket_p *sock = dynamic_cast<RUDP_Socket_p *>((RUDP_Socket_p *)socket);
+
+		if (sock == nullptr)
+		{
+			std::cerr << "rudp_get_window_size() exception at access to socket pointer:" << std::endl;
+			std::cerr << "\tInvalid socket pointer: Expected RUDP_Socket_p*, instead got NULL/invalid pointer." << std::endl;
+			return 0;
+		}
+
+		return sock->getWindowSize();
+	}
+
+	uint16_t rudp_get_ack_ratio(RUDP_socket socket)
+	{
+		RUDP_Socket_p *sock = dynamic_cast<RUDP_Socket_p *>((RUDP_Socket_p *)socket);
+
+		if (sock == nullptr)
+		{
+			std::cerr << "rudp_get_ack_ratio() exception at access to socket pointer:" << std::endl;
+			std::cerr << "\tInvalid socket pointer: Expected RUDP_Socket_p*, instead got NULL/invalid pointer." << std::endl;
+			return 0;
+		}
+
+		return sock->getAckRatio();
+	}
+
+	uint16_t rudp_get_ack_delay(RUDP_socket socket)
+	{
+		RUDP_Socket_p *sock = dynamic_cast<RUDP_Socket_p *>((RUDP_Socket_p *)socket);
+
+		if (sock == nullptr)
+		{
+			std::cerr << "rudp_get_ack_delay() exception at access to socket pointer:" << std::endl;
+			std::cerr << "\tInvalid socket pointer: Expected RUDP_Socket_p*, instead got NULL/invalid pointer." << std::endl;
+			return 0;
+		}
+
+		return sock->getAckDelay();
+	}
+
 	uint16_t rudp_get_peers_MTU(RUDP_socket socket)
 	{
 		RUDP_Socket_p *sock = dynamic_cast<RUDP_Socket_p *>((RUDP_Socket_p *)socket);
@@ -282,6 +396,32 @@ extern "C"
 		}
 	}
 
+	uint16_t rudp_get_path_MTU(RUDP_socket socket)
+	{
+		RUDP_Socket_p *sock = dynamic_cast<RUDP_Socket_p *>((RUDP_Socket_p *)socket);
+
+		if (sock == nullptr)
+		{
+			std::cerr << "rudp_get_path_MTU() exception at access to socket pointer:" << std::endl;
+			std::cerr << "\tInvalid socket pointer: Expected RUDP_Socket_p*, instead got NULL/invalid pointer." << std::endl;
+			return 0;
+		}
+
+		try
+		{
+			return sock->getPathMTU();
+		}
+
+		catch (const std::exception &e)
+		{
+			typedef uint16_t (RUDP_Socket_p::*GetPathMTUMethod)() const;
+			GetPathMTUMethod getPathMTUMethod = &RUDP_Socket_p::getPathMTU;
+			std::cerr << "rudp_get_path_MTU() exception at " << static_cast<void *>(sock) << " in " << reinterpret_cast<void *&>(getPathMTUMethod) << " (getPathMTU):" << std::endl;
+			std::cerr << "\t" << e.what() << std::endl;
+			return 0;
+		}
+	}
+
 	bool rudp_is_debug_mode(RUDP_socket socket)
 	{
 		RUDP_Socket_p *sock = dynamic_cast<RUDP_Socket_p *>((RUDP_Socket_p *)socket);
@@ -296,121 +436,722 @@ extern "C"
 		return sock->isDebugMode();
 	}
 
-	bool rudp_is_connected(RUDP_socket socket)
+	bool rudp_is_path_MTU_discovery(RUDP_socket socket)
 	{
 		RUDP_Socket_p *sock = dynamic_cast<RUDP_Socket_p *>((RUDP_Socket_p *)socket);
 
 		if (sock == nullptr)
 		{
-			std::cerr << "rudp_is_connected() exception at access to socket pointer:" << std::endl;
+			std::cerr << "rudp_is_path_MTU_discovery() exception at access to socket pointer:" << std::endl;
 			std::cerr << "\tInvalid socket pointer: Expected RUDP_Socket_p*, instead got NULL/invalid pointer." << std::endl;
 			return false;
 		}
 
-		return sock->isConnected();
+		return sock->isPathMTUDiscovery();
 	}
 
-	bool rudp_is_server(RUDP_socket socket)
+	bool rudp_is_send_buffering(RUDP_socket socket)
 	{
 		RUDP_Socket_p *sock = dynamic_cast<RUDP_Socket_p *>((RUDP_Socket_p *)socket);
 
 		if (sock == nullptr)
 		{
-			std::cerr << "rudp_is_server() exception at access to socket pointer:" << std::endl;
+			std::cerr << "rudp_is_send_buffering() exception at access to socket pointer:" << std::endl;
 			std::cerr << "\tInvalid socket pointer: Expected RUDP_Socket_p*, instead got NULL/invalid pointer." << std::endl;
 			return false;
 		}
 
-		return sock->isServer();
+		return sock->isSendBuffering();
 	}
 
-	void rudp_set_debug_mode(RUDP_socket socket, bool debug_mode)
+	uint16_t rudp_get_send_buffer_delay(RUDP_socket socket)
 	{
 		RUDP_Socket_p *sock = dynamic_cast<RUDP_Socket_p *>((RUDP_Socket_p *)socket);
 
 		if (sock == nullptr)
 		{
-			std::cerr << "rudp_set_debug_mode() exception at access to socket pointer:" << std::endl;
+			std::cerr << "rudp_get_send_buffer_delay() exception at access to socket pointer:" << std::endl;
 			std::cerr << "\tInvalid socket pointer: Expected RUDP_Socket_p*, instead got NULL/invalid pointer." << std::endl;
-			return;
+			return 0;
 		}
 
-		sock->setDebugMode(debug_mode);
+		return sock->getSendBufferDelay();
 	}
 
-	void rudp_set_MTU(RUDP_socket socket, uint16_t MTU)
+	uint64_t rudp_get_max_rate(RUDP_socket socket)
 	{
 		RUDP_Socket_p *sock = dynamic_cast<RUDP_Socket_p *>((RUDP_Socket_p *)socket);
 
 		if (sock == nullptr)
 		{
-			std::cerr << "rudp_set_MTU() exception at access to socket pointer:" << std::endl;
+			std::cerr << "rudp_get_max_rate() exception at access to socket pointer:" << std::endl;
 			std::cerr << "\tInvalid socket pointer: Expected RUDP_Socket_p*, instead got NULL/invalid pointer." << std::endl;
-			return;
+			return 0;
 		}
 
-		try
+		return sock->getMaxRate();
+	}
+
+	bool rudp_is_kernel_pacing(RUDP_socket socket)
+	{
+		RUDP_Socket_p *sock = dynamic_cast<RUDP_Socket_p *>((RUDP_Socket_p *)socket);
+
+		if (sock == nullptr)
 		{
-			sock->setMTU(MTU);
+			std::cerr << "rudp_is_kernel_pacing() exception at access to socket pointer:" << std::endl;
+			std::cerr << "\tInvalid socket pointer: Expected RUDP_Socket_p*, instead got NULL/invalid pointer." << std::endl;
+			return false;
 		}
 
-		catch (const std::exception &e)
+		return sock->isKernelPacing();
+	}
+
+	uint64_t rudp_get_recv_window(RUDP_socket socket)
+	{
+		RUDP_Socket_p *sock = dynamic_cast<RUDP_Socket_p *>((RUDP_Socket_p *)socket);
+
+		if (sock == nullptr)
 		{
-			typedef void (RUDP_Socket_p::*SetMTUMethod)(uint16_t);
-			SetMTUMethod setMTUMethod = &RUDP_Socket_p::setMTU;
-			std::cerr << "rudp_set_MTU() exception at " << static_cast<void *>(sock) << " in " << reinterpret_cast<void *&>(setMTUMethod) << " (setMTU):" << std::endl;
-			std::cerr << "\t" << e.what() << std::endl;
-			return;
+			std::cerr << "rudp_get_recv_window() exception at access to socket pointer:" << std::endl;
+			std::cerr << "\tInvalid socket pointer: Expected RUDP_Socket_p*, instead got NULL/invalid pointer." << std::endl;
+			return 0;
 		}
+
+		return sock->getRecvWindow();
 	}
 
-	void rudp_set_timeout(RUDP_socket socket, uint16_t timeout)
+	bool rudp_is_buffer_auto_tuning(RUDP_socket socket)
 	{
 		RUDP_Socket_p *sock = dynamic_cast<RUDP_Socket_p *>((RUDP_Socket_p *)socket);
 
 		if (sock == nullptr)
 		{
-			std::cerr << "rudp_set_timeout() exception at access to socket pointer:" << std::endl;
+			std::cerr << "rudp_is_buffer_auto_tuning() exception at access to socket pointer:" << std::endl;
 			std::cerr << "\tInvalid socket pointer: Expected RUDP_Socket_p*, instead got NULL/invalid pointer." << std::endl;
-			return;
+			return false;
 		}
 
-		try
+		return sock->isBufferAutoTuning();
+	}
+
+	bool rudp_get_stats(RUDP_socket socket, RUDP_stats *stats)
+	{
+		RUDP_Socket_p *sock = dynamic_cast<RUDP_Socket_p *>((RUDP_Socket_p *)socket);
+
+		if (sock == nullptr)
 		{
-			sock->setTimeout(timeout);
+			std::cerr << "rudp_get_stats() exception at access to socket pointer:" << std::endl;
+			std::cerr << "\tInvalid socket pointer: Expected RUDP_Socket_p*, instead got NULL/invalid pointer." << std::endl;
+			return false;
 		}
 
-		catch (const std::exception &e)
+		if (stats == nullptr)
 		{
-			typedef void (RUDP_Socket_p::*SetTimeoutMethod)(uint16_t);
-			SetTimeoutMethod setTimeoutMethod = &RUDP_Socket_p::setTimeout;
-			std::cerr << "rudp_set_timeout() exception at " << static_cast<void *>(sock) << " in " << reinterpret_cast<void *&>(setTimeoutMethod) << " (setTimeout):" << std::endl;
-			std::cerr << "\t" << e.what() << std::endl;
-			return;
+			std::cerr << "rudp_get_stats() exception at access to stats pointer:" << std::endl;
+			std::cerr << "\tInvalid stats pointer: Expected RUDP_stats*, instead got NULL." << std::endl;
+			return false;
 		}
+
+		*stats = sock->getStats();
+
+		return true;
 	}
 
-	void rudp_set_max_retries(RUDP_socket socket, uint16_t max_retries)
+	bool rudp_get_rtt_histogram(RUDP_socket socket, RUDP_histogram *histogram)
 	{
 		RUDP_Socket_p *sock = dynamic_cast<RUDP_Socket_p *>((RUDP_Socket_p *)socket);
 
 		if (sock == nullptr)
 		{
-			std::cerr << "rudp_set_max_retries() exception at access to socket pointer:" << std::endl;
+			std::cerr << "rudp_get_rtt_histogram() exception at access to socket pointer:" << std::endl;
+			std::cerr << "\tInvalid socket pointer: Expected RUDP_Socket_p*, instead got NULL/invalid pointer." << std::endl;
+			return false;
+		}
+
+		if (histogram == nullptr)
+		{
+			std::cerr << "rudp_get_rtt_histogram() exception at access to histogram pointer:" << std::endl;
+			std::cerr << "\tInvalid histogram pointer: Expected RUDP_histogram*, instead got NULL." << std::endl;
+			return false;
+		}
+
+		*histogram = sock->getRttHistogram();
+
+		return true;
+	}
+
+	bool rudp_get_latency_histogram(RUDP_socket socket, RUDP_histogram *histogram)
+	{
+		RUDP_Socket_p *sock = dynamic_cast<RUDP_Socket_p *>((RUDP_Socket_p *)socket);
+
+		if (sock == nullptr)
+		{
+			std::cerr << "rudp_get_latency_histogram() exception at access to socket pointer:" << std::endl;
 			std::cerr << "\tInvalid socket pointer: Expected RUDP_Socket_p*, instead got NULL/invalid pointer." << std::endl;
+			return false;
+		}
+
+		if (histogram == nullptr)
+		{
+			std::cerr << "rudp_get_latency_histogram() exception at access to histogram pointer:" << std::endl;
+			std::cerr << "\tInvalid histogram pointer: Expected RUDP_histogram*, instead got NULL." << std::endl;
+			return false;
+		}
+
+		*histogram = sock->getLatencyHistogram();
+
+		return true;
+	}
+
+	void rudp_merge_histogram(RUDP_histogram *into, const RUDP_histogram *from)
+	{
+		if (into == nullptr || from == nullptr)
+		{
+			std::cerr << "rudp_merge_histogram() exception at access to histogram pointer:" << std::endl;
+			std::cerr << "\tInvalid histogram pointer: Expected RUDP_histogram*, instead got NULL." << std::endl;
 			return;
 		}
 
+		RUDP_Histogram::mergeHistogram(*into, *from);
+	}
+
+	uint64_t rudp_get_histogram_percentile(const RUDP_histogram *histogram, double percentile)
+	{
+		if (histogram == nullptr)
+		{
+			std::cerr << "rudp_get_histogram_percentile() exception at access to histogram pointer:" << std::endl;
+			std::cerr << "\tInvalid histogram pointer: Expected RUDP_histogram*, instead got NULL." << std::endl;
+			return 0;
+		}
+
+		return RUDP_Histogram::getPercentile(*histogram, percentile);
+	}
+
+	bool rudp_is_tracing(RUDP_socket socket)
+	{
+		RUDP_Socket_p *sock = dynamic_cast<RUDP_Socket_p *>((RUDP_Socket_p *)socket);
+
+		if (sock == nullptr)
+		{
+			std::cerr << "rudp_is_tracing() exception at access to socket pointer:" << std::endl;
+			std::cerr << "\tInvalid socket pointer: Expected RUDP_Socket_p*, instead got NULL/invalid pointer." << std::endl;
+			return false;
+		}
+
+		return sock->isTracing();
+	}
+
+	bool rudp_is_phase_timing(RUDP_socket socket)
+	{
+		RUDP_Socket_p *sock = dynamic_cast<RUDP_Socket_p *>((RUDP_Socket_p *)socket);
+
+		if (sock == nullptr)
+		{
+			std::cerr << "rudp_is_phase_timing() exception at access to socket pointer:" << std::endl;
+			std::cerr << "\tInvalid socket pointer: Expected RUDP_Socket_p*, instead got NULL/invalid pointer." << std::endl;
+			return false;
+		}
+
+		return sock->isPhaseTiming();
+	}
+
+	uint32_t rudp_read_trace(RUDP_socket socket, RUDP_trace_event *events, uint32_t max_events)
+	{
+		RUDP_Socket_p *sock = dynamic_cast<RUDP_Socket_p *>((RUDP_Socket_p *)socket);
+
+		if (sock == nullptr)
+		{
+			std::cerr << "rudp_read_trace() exception at access to socket pointer:" << std::endl;
+			std::cerr << "\tInvalid socket pointer: Expected RUDP_Socket_p*, instead got NULL/invalid pointer." << std::endl;
+			return 0;
+		}
+
 		try
 		{
-			sock->setMaxRetries(max_retries);
+			return sock->readTrace(events, max_events);
 		}
 
 		catch (const std::exception &e)
 		{
-			typedef void (RUDP_Socket_p::*SetMaxRetriesMethod)(uint16_t);
-			SetMaxRetriesMethod setMaxRetriesMethod = &RUDP_Socket_p::setMaxRetries;
-			std::cerr << "rudp_set_max_retries() exception at " << static_cast<void *>(sock) << " in " << reinterpret_cast<void *&>(setMaxRetriesMethod) << " (setMaxRetries):" << std::endl;
+			typedef uint32_t (RUDP_Socket_p::*ReadTraceMethod)(RUDP_trace_event *, uint32_t);
+			ReadTraceMethod readTraceMethod = &RUDP_Socket_p::readTrace;
+			std::cerr << "rudp_read_trace() exception at " << static_cast<void *>(sock) << " in " << reinterpret_cast<void *&>(readTraceMethod) << " (readTrace):" << std::endl;
+			std::cerr << "\t" << e.what() << std::endl;
+			return 0;
+		}
+	}
+
+	const char *rudp_get_flight_recorder_file(RUDP_socket socket)
+	{
+		RUDP_Socket_p *sock = dynamic_cast<RUDP_Socket_p *>((RUDP_Socket_p *)socket);
+
+		if (sock == nullptr)
+		{
+			std::cerr << "rudp_get_flight_recorder_file() exception at access to socket pointer:" << std::endl;
+			std::cerr << "\tInvalid socket pointer: Expected RUDP_Socket_p*, instead got NULL/invalid pointer." << std::endl;
+			return nullptr;
+		}
+
+		return sock->getFlightRecorderFile();
+	}
+
+	uint32_t rudp_dump_flight_recorder(RUDP_socket socket, const char *path)
+	{
+		RUDP_Socket_p *sock = dynamic_cast<RUDP_Socket_p *>((RUDP_Socket_p *)socket);
+
+		if (sock == nullptr)
+		{
+			std::cerr << "rudp_dump_flight_recorder() exception at access to socket pointer:" << std::endl;
+			std::cerr << "\tInvalid socket pointer: Expected RUDP_Socket_p*, instead got NULL/invalid pointer." << std::endl;
+			return 0;
+		}
+
+		try
+		{
+			return sock->dumpFlightRecorder(path);
+		}
+
+		catch (const std::exception &e)
+		{
+			typedef uint32_t (RUDP_Socket_p::*DumpFlightRecorderMethod)(const char *) const;
+			DumpFlightRecorderMethod dumpFlightRecorderMethod = &RUDP_Socket_p::dumpFlightRecorder;
+			std::cerr << "rudp_dump_flight_recorder() exception at " << static_cast<void *>(sock) << " in " << reinterpret_cast<void *&>(dumpFlightRecorderMethod) << " (dumpFlightRecorder):" << std::endl;
+			std::cerr << "\t" << e.what() << std::endl;
+			return 0;
+		}
+	}
+
+	bool rudp_is_connected(RUDP_socket socket)
+	{
+		RUDP_Socket_p *sock = dynamic_cast<RUDP_Socket_p *>((RUDP_Socket_p *)socket);
+
+		if (sock == nullptr)
+		{
+			std::cerr << "rudp_is_connected() exception at access to socket pointer:" << std::endl;
+			std::cerr << "\tInvalid socket pointer: Expected RUDP_Socket_p*, instead got NULL/invalid pointer." << std::endl;
+			return false;
+		}
+
+		return sock->isConnected();
+	}
+
+	bool rudp_is_server(RUDP_socket socket)
+	{
+		RUDP_Socket_p *sock = dynamic_cast<RUDP_Socket_p *>((RUDP_Socket_p *)socket);
+
+		if (sock == nullptr)
+		{
+			std::cerr << "rudp_is_server() exception at access to socket pointer:" << std::endl;
+			std::cerr << "\tInvalid socket pointer: Expected RUDP_Socket_p*, instead got NULL/invalid pointer." << std::endl;
+			return false;
+		}
+
+		return sock->isServer();
+	}
+
+	void rudp_set_debug_mode(RUDP_socket socket, bool debug_mode)
+	{
+		RUDP_Socket_p *sock = dynamic_cast<RUDP_Socket_p *>((RUDP_Socket_p *)socket);
+
+		if (sock == nullptr)
+		{
+			std::cerr << "rudp_set_debug_mode() exception at access to socket pointer:" << std::endl;
+			std::cerr << "\tInvalid socket pointer: Expected RUDP_Socket_p*, instead got NULL/invalid pointer." << std::endl;
+			return;
+		}
+
+		sock->setDebugMode(debug_mode);
+	}
+
+	void rudp_set_progress_callback(RUDP_socket socket, RUDP_progress_callback callback, void *user_data)
+	{
+		RUDP_Socket_p *sock = dynamic_cast<RUDP_Socket_p *>((RUDP_Socket_p *)socket);
+
+		if (sock == nullptr)
+		{
+			std::cerr << "rudp_set_progress_callback() exception at access to socket pointer:" << std::endl;
+			std::cerr << "\tInvalid socket pointer: Expected RUDP_Socket_p*, instead got NULL/invalid pointer." << std::endl;
+			return;
+		}
+
+		sock->setProgressCallback(callback, user_data);
+	}
+
+	void rudp_set_MTU(RUDP_socket socket, uint16_t MTU)
+	{
+		RUDP_Socket_p *sock = dynamic_cast<RUDP_Socket_p *>((RUDP_Socket_p *)socket);
+
+		if (sock == nullptr)
+		{
+			std::cerr << "rudp_set_MTU() exception at access to socket pointer:" << std::endl;
+			std::cerr << "\tInvalid socket pointer: Expected RUDP_Socket_p*, instead got NULL/invalid pointer." << std::endl;
+			return;
+		}
+
+		try
+		{
+			sock->setMTU(MTU);
+		}
+
+		catch (const std::exception &e)
+		{
+			typedef void (RUDP_Socket_p::*SetMTUMethod)(uint16_t);
+			SetMTUMethod setMTUMethod = &RUDP_Socket_p::setMTU;
+			std::cerr << "rudp_set_MTU() exception at " << static_cast<void *>(sock) << " in " << reinterpret_cast<void *&>(setMTUMethod) << " (setMTU):" << std::endl;
+			std::cerr << "\t" << e.what() << std::endl;
+			return;
+		}
+	}
+
+	void rudp_set_timeout(RUDP_socket socket, uint16_t timeout)
+	{
+		RUDP_Socket_p *sock = dynamic_cast<RUDP_Socket_p *>((RUDP_Socket_p *)socket);
+
+		if (sock == nullptr)
+		{
+			std::cerr << "rudp_set_timeout() exception at access to socket pointer:" << std::endl;
+			std::cerr << "\tInvalid socket pointer: Expected RUDP_Socket_p*, instead got NULL/invalid pointer." << std::endl;
+			return;
+		}
+
+		try
+		{
+			sock->setTimeout(timeout);
+		}
+
+		catch (const std::exception &e)
+		{
+			typedef void (RUDP_Socket_p::*SetTimeoutMethod)(uint16_t);
+			SetTimeoutMethod setTimeoutMethod = &RUDP_Socket_p::setTimeout;
+			std::cerr << "rudp_set_timeout() exception at " << static_cast<void *>(sock) << " in " << reinterpret_cast<void *&>(setTimeoutMethod) << " (setTimeout):" << std::endl;
+			std::cerr << "\t" << e.what() << std::endl;
+			return;
+		}
+	}
+
+	void rudp_set_max_retries(RUDP_socket socket, uint16_t max_retries)
+	{
+		RUDP_Socket_p *sock = dynamic_cast<RUDP_Socket_p *>((RUDP_Socket_p *)socket);
+
+		if (sock == nullptr)
+		{
+			std::cerr << "rudp_set_max_retries() exception at access to socket pointer:" << std::endl;
+			std::cerr << "\tInvalid socket pointer: Expected RUDP_Socket_p*, instead got NULL/invalid pointer." << std::endl;
+			return;
+		}
+
+		try
+		{
+			sock->setMaxRetries(max_retries);
+		}
+
+		catch (const std::exception &e)
+		{
+			typedef void (RUDP_Socket_p::*SetMaxRetriesMethod)(uint16_t);
+			SetMaxRetriesMethod setMaxRetriesMethod = &RUDP_Socket_p::setMaxRetries;
+			std::cerr << "rudp_set_max_retries() exception at " << static_cast<void *>(sock) << " in " << reinterpret_cast<void *&>(setMaxRetriesMethod) << " (setMaxRetries):" << std::endl;
+			std::cerr << "\t" << e.what() << std::endl;
+			return;
+		}
+	}
+
+	void rudp_set_window_size(RUDP_socket socket, uint16_t window_size)
+	{
+		RUDP_Socket_p *sock = dynamic_cast<RUDP_Socket_p *>((RUDP_Socket_p *)socket);
+
+		if (sock == nullptr)
+		{
+			std::cerr << "rudp_set_window_size() exception at access to socket pointer:" << std::endl;
+			std::cerr << "\tInvalid socket pointer: Expected RUDP_Socket_p*, instead got NULL/invalid pointer." << std::endl;
+			return;
+		}
+
+		try
+		{
+			sock->setWindowSize(window_size);
+		}
+
+		catch (const std::exception &e)
+		{
+			typedef void (RUDP_Socket_p::*SetWindowSizeMethod)(uint16_t);
+			SetWindowSizeMethod setWindowSizeMethod = &RUDP_Socket_p::setWindowSize;
+			std::cerr << "rudp_set_window_size() exception at " << static_cast<void *>(sock) << " in " << reinterpret_cast<void *&>(setWindowSizeMethod) << " (setWindowSize):" << std::endl;
+			std::cerr << "\t" << e.what() << std::endl;
+			return;
+		}
+	}
+
+	void rudp_set_ack_ratio(RUDP_socket socket, uint16_t ack_ratio)
+	{
+		RUDP_Socket_p *sock = dynamic_cast<RUDP_Socket_p *>((RUDP_Socket_p *)socket);
+
+		if (sock == nullptr)
+		{
+			std::cerr << "rudp_set_ack_ratio() exception at access to socket pointer:" << std::endl;
+			std::cerr << "\tInvalid socket pointer: Expected RUDP_Socket_p*, instead got NULL/invalid pointer." << std::endl;
+			return;
+		}
+
+		try
+		{
+			sock->setAckRatio(ack_ratio);
+		}
+
+		catch (const std::exception &e)
+		{
+			typedef void (RUDP_Socket_p::*SetAckRatioMethod)(uint16_t);
+			SetAckRatioMethod setAckRatioMethod = &RUDP_Socket_p::setAckRatio;
+			std::cerr << "rudp_set_ack_ratio() exception at " << static_cast<void *>(sock) << " in " << reinterpret_cast<void *&>(setAckRatioMethod) << " (setAckRatio):" << std::endl;
+			std::cerr << "\t" << e.what() << std::endl;
+			return;
+		}
+	}
+
+	void rudp_set_ack_delay(RUDP_socket socket, uint16_t ack_delay)
+	{
+		RUDP_Socket_p *sock = dynamic_cast<RUDP_Socket_p *>((RUDP_Socket_p *)socket);
+
+		if (sock == nullptr)
+		{
+			std::cerr << "rudp_set_ack_delay() exception at access to socket pointer:" << std::endl;
+			std::cerr << "\tInvalid socket pointer: Expected RUDP_Socket_p*, instead got NULL/invalid pointer." << std::endl;
+			return;
+		}
+
+		try
+		{
+			sock->setAckDelay(ack_delay);
+		}
+
+		catch (const std::exception &e)
+		{
+			typedef void (RUDP_Socket_p::*SetAckDelayMethod)(uint16_t);
+			SetAckDelayMethod setAckDelayMethod = &RUDP_Socket_p::setAckDelay;
+			std::cerr << "rudp_set_ack_delay() exception at " << static_cast<void *>(sock) << " in " << reinterpret_cast<void *&>(setAckDelayMethod) << " (setAckDelay):" << std::endl;
+			std::cerr << "\t" << e.what() << std::endl;
+			return;
+		}
+	}
+
+	void rudp_set_path_MTU_discovery(RUDP_socket socket, bool enable)
+	{
+		RUDP_Socket_p *sock = dynamic_cast<RUDP_Socket_p *>((RUDP_Socket_p *)socket);
+
+		if (sock == nullptr)
+		{
+			std::cerr << "rudp_set_path_MTU_discovery() exception at access to socket pointer:" << std::endl;
+			std::cerr << "\tInvalid socket pointer: Expected RUDP_Socket_p*, instead got NULL/invalid pointer." << std::endl;
+			return;
+		}
+
+		try
+		{
+			sock->setPathMTUDiscovery(enable);
+		}
+
+		catch (const std::exception &e)
+		{
+			typedef void (RUDP_Socket_p::*SetPathMTUDiscoveryMethod)(bool);
+			SetPathMTUDiscoveryMethod setPathMTUDiscoveryMethod = &RUDP_Socket_p::setPathMTUDiscovery;
+			std::cerr << "rudp_set_path_MTU_discovery() exception at " << static_cast<void *>(sock) << " in " << reinterpret_cast<void *&>(setPathMTUDiscoveryMethod) << " (setPathMTUDiscovery):" << std::endl;
+			std::cerr << "\t" << e.what() << std::endl;
+			return;
+		}
+	}
+
+	void rudp_set_send_buffering(RUDP_socket socket, bool enable)
+	{
+		RUDP_Socket_p *sock = dynamic_cast<RUDP_Socket_p *>((RUDP_Socket_p *)socket);
+
+		if (sock == nullptr)
+		{
+			std::cerr << "rudp_set_send_buffering() exception at access to socket pointer:" << std::endl;
+			std::cerr << "\tInvalid socket pointer: Expected RUDP_Socket_p*, instead got NULL/invalid pointer." << std::endl;
+			return;
+		}
+
+		sock->setSendBuffering(enable);
+	}
+
+	void rudp_set_send_buffer_delay(RUDP_socket socket, uint16_t delay)
+	{
+		RUDP_Socket_p *sock = dynamic_cast<RUDP_Socket_p *>((RUDP_Socket_p *)socket);
+
+		if (sock == nullptr)
+		{
+			std::cerr << "rudp_set_send_buffer_delay() exception at access to socket pointer:" << std::endl;
+			std::cerr << "\tInvalid socket pointer: Expected RUDP_Socket_p*, instead got NULL/invalid pointer." << std::endl;
+			return;
+		}
+
+		sock->setSendBufferDelay(delay);
+	}
+
+	void rudp_set_max_rate(RUDP_socket socket, uint64_t rate)
+	{
+		RUDP_Socket_p *sock = dynamic_cast<RUDP_Socket_p *>((RUDP_Socket_p *)socket);
+
+		if (sock == nullptr)
+		{
+			std::cerr << "rudp_set_max_rate() exception at access to socket pointer:" << std::endl;
+			std::cerr << "\tInvalid socket pointer: Expected RUDP_Socket_p*, instead got NULL/invalid pointer." << std::endl;
+			return;
+		}
+
+		sock->setMaxRate(rate);
+	}
+
+	void rudp_set_kernel_pacing(RUDP_socket socket, bool enable)
+	{
+		RUDP_Socket_p *sock = dynamic_cast<RUDP_Socket_p *>((RUDP_Socket_p *)socket);
+
+		if (sock == nullptr)
+		{
+			std::cerr << "rudp_set_kernel_pacing() exception at access to socket pointer:" << std::endl;
+			std::cerr << "\tInvalid socket pointer: Expected RUDP_Socket_p*, instead got NULL/invalid pointer." << std::endl;
+			return;
+		}
+
+		try
+		{
+			sock->setKernelPacing(enable);
+		}
+
+		catch (const std::exception &e)
+		{
+			typedef void (RUDP_Socket_p::*SetKernelPacingMethod)(bool);
+			SetKernelPacingMethod setKernelPacingMethod = &RUDP_Socket_p::setKernelPacing;
+			std::cerr << "rudp_set_kernel_pacing() exception at " << static_cast<void *>(sock) << " in " << reinterpret_cast<void *&>(setKernelPacingMethod) << " (setKernelPacing):" << std::endl;
+			std::cerr << "\t" << e.what() << std::endl;
+			return;
+		}
+	}
+
+	void rudp_set_recv_window(RUDP_socket socket, uint64_t bytes)
+	{
+		RUDP_Socket_p *sock = dynamic_cast<RUDP_Socket_p *>((RUDP_Socket_p *)socket);
+
+		if (sock == nullptr)
+		{
+			std::cerr << "rudp_set_recv_window() exception at access to socket pointer:" << std::endl;
+			std::cerr << "\tInvalid socket pointer: Expected RUDP_Socket_p*, instead got NULL/invalid pointer." << std::endl;
+			return;
+		}
+
+		try
+		{
+			sock->setRecvWindow(bytes);
+		}
+
+		catch (const std::exception &e)
+		{
+			typedef void (RUDP_Socket_p::*SetRecvWindowMethod)(uint64_t);
+			SetRecvWindowMethod setRecvWindowMethod = &RUDP_Socket_p::setRecvWindow;
+			std::cerr << "rudp_set_recv_window() exception at " << static_cast<void *>(sock) << " in " << reinterpret_cast<void *&>(setRecvWindowMethod) << " (setRecvWindow):" << std::endl;
+			std::cerr << "\t" << e.what() << std::endl;
+			return;
+		}
+	}
+
+	void rudp_set_buffer_auto_tuning(RUDP_socket socket, bool enable)
+	{
+		RUDP_Socket_p *sock = dynamic_cast<RUDP_Socket_p *>((RUDP_Socket_p *)socket);
+
+		if (sock == nullptr)
+		{
+			std::cerr << "rudp_set_buffer_auto_tuning() exception at access to socket pointer:" << std::endl;
+			std::cerr << "\tInvalid socket pointer: Expected RUDP_Socket_p*, instead got NULL/invalid pointer." << std::endl;
+			return;
+		}
+
+		try
+		{
+			sock->setBufferAutoTuning(enable);
+		}
+
+		catch (const std::exception &e)
+		{
+			typedef void (RUDP_Socket_p::*SetBufferAutoTuningMethod)(bool);
+			SetBufferAutoTuningMethod setBufferAutoTuningMethod = &RUDP_Socket_p::setBufferAutoTuning;
+			std::cerr << "rudp_set_buffer_auto_tuning() exception at " << static_cast<void *>(sock) << " in " << reinterpret_cast<void *&>(setBufferAutoTuningMethod) << " (setBufferAutoTuning):" << std::endl;
+			std::cerr << "\t" << e.what() << std::endl;
+			return;
+		}
+	}
+
+	void rudp_set_tracing(RUDP_socket socket, bool enable)
+	{
+		RUDP_Socket_p *sock = dynamic_cast<RUDP_Socket_p *>((RUDP_Socket_p *)socket);
+
+		if (sock == nullptr)
+		{
+			std::cerr << "rudp_set_tracing() exception at access to socket pointer:" << std::endl;
+			std::cerr << "\tInvalid socket pointer: Expected RUDP_Socket_p*, instead got NULL/invalid pointer." << std::endl;
+			return;
+		}
+
+		try
+		{
+			sock->setTracing(enable);
+		}
+
+		catch (const std::exception &e)
+		{
+			typedef void (RUDP_Socket_p::*SetTracingMethod)(bool);
+			SetTracingMethod setTracingMethod = &RUDP_Socket_p::setTracing;
+			std::cerr << "rudp_set_tracing() exception at " << static_cast<void *>(sock) << " in " << reinterpret_cast<void *&>(setTracingMethod) << " (setTracing):" << std::endl;
+			std::cerr << "\t" << e.what() << std::endl;
+			return;
+		}
+	}
+
+	void rudp_set_phase_timing(RUDP_socket socket, bool enable)
+	{
+		RUDP_Socket_p *sock = dynamic_cast<RUDP_Socket_p *>((RUDP_Socket_p *)socket);
+
+		if (sock == nullptr)
+		{
+			std::cerr << "rudp_set_phase_timing() exception at access to socket pointer:" << std::endl;
+			std::cerr << "\tInvalid socket pointer: Expected RUDP_Socket_p*, instead got NULL/invalid pointer." << std::endl;
+			return;
+		}
+
+		try
+		{
+			sock->setPhaseTiming(enable);
+		}
+
+		catch (const std::exception &e)
+		{
+			typedef void (RUDP_Socket_p::*SetPhaseTimingMethod)(bool);
+			SetPhaseTimingMethod setPhaseTimingMethod = &RUDP_Socket_p::setPhaseTiming;
+			std::cerr << "rudp_set_phase_timing() exception at " << static_cast<void *>(sock) << " in " << reinterpret_cast<void *&>(setPhaseTimingMethod) << " (setPhaseTiming):" << std::endl;
+			std::cerr << "\t" << e.what() << std::endl;
+			return;
+		}
+	}
+
+	void rudp_set_flight_recorder_file(RUDP_socket socket, const char *path)
+	{
+		RUDP_Socket_p *sock = dynamic_cast<RUDP_Socket_p *>((RUDP_Socket_p *)socket);
+
+		if (sock == nullptr)
+		{
+			std::cerr << "rudp_set_flight_recorder_file() exception at access to socket pointer:" << std::endl;
+			std::cerr << "\tInvalid socket pointer: Expected RUDP_Socket_p*, instead got NULL/invalid pointer." << std::endl;
+			return;
+		}
+
+		try
+		{
+			sock->setFlightRecorderFile(path);
+		}
+
+		catch (const std::exception &e)
+		{
+			typedef void (RUDP_Socket_p::*SetFlightRecorderFileMethod)(const char *);
+			SetFlightRecorderFileMethod setFlightRecorderFileMethod = &RUDP_Socket_p::setFlightRecorderFile;
+			std::cerr << "rudp_set_flight_recorder_file() exception at " << static_cast<void *>(sock) << " in " << reinterpret_cast<void *&>(setFlightRecorderFileMethod) << " (setFlightRecorderFile):" << std::endl;
 			std::cerr << "\t" << e.what() << std::endl;
 			return;
 		}
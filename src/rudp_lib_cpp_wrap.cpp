@@ -27,9 +27,17 @@ bool RUDP_Socket::connect(const char *dest_ip, uint16_t dest_port) { return _soc
 
 bool RUDP_Socket::accept() { return _socket->accept(); }
 
-int RUDP_Socket::recv(void *buffer, uint32_t buffer_size) { return _socket->recv(buffer, buffer_size); }
+int64_t RUDP_Socket::recv(void *buffer, uint64_t buffer_size) { return _socket->recv(buffer, buffer_size); }
 
-int RUDP_Socket::send(void *buffer, uint32_t buffer_size) { return _socket->send(buffer, buffer_size); }
+int64_t RUDP_Socket::send(void *buffer, uint64_t buffer_size) { return _socket->send(buffer, buffer_size); }
+
+int64_t RUDP_Socket::sendAsync(const void *buffer, uint64_t buffer_size) { return _socket->sendAsync(buffer, buffer_size); }
+
+void RUDP_Socket::cork() { _socket->cork(); }
+
+void RUDP_Socket::uncork() { _socket->uncork(); }
+
+void RUDP_Socket::flush() { _socket->flush(); }
 
 bool RUDP_Socket::disconnect() { return _socket->disconnect(); }
 
@@ -39,8 +47,50 @@ uint16_t RUDP_Socket::getTimeout() const { return _socket->getTimeout(); }
 
 uint16_t RUDP_Socket::getMaxRetries() const { return _socket->getMaxRetries(); }
 
+uint16_t RUDP_Socket::getWindowSize() const { return _socket->getWindowSize(); }
+
+uint16_t RUDP_Socket::getAckRatio() const { return _socket->getAckRatio(); }
+
+uint16_t RUDP_Socket::getAckDelay() const { return _socket->getAckDelay(); }
+
 uint16_t RUDP_Socket::getPeersMTU() const { return _socket->getPeersMTU(); }
 
+uint16_t RUDP_Socket::getPathMTU() const { return _socket->getPathMTU(); }
+
+bool RUDP_Socket::isPathMTUDiscovery() const { return _socket->isPathMTUDiscovery(); }
+
+bool RUDP_Socket::isSendBuffering() const { return _socket->isSendBuffering(); }
+
+uint16_t RUDP_Socket::getSendBufferDelay() const { return _socket->getSendBufferDelay(); }
+
+uint64_t RUDP_Socket::getMaxRate() const { return _socket->getMaxRate(); }
+
+uint64_t RUDP_Socket::getRecvWindow() const { return _socket->getRecvWindow(); }
+
+bool RUDP_Socket::isBufferAutoTuning() const { return _socket->isBufferAutoTuning(); }
+
+RUDP_stats RUDP_Socket::getStats() const { return _socket->getStats(); }
+
+RUDP_histogram RUDP_Socket::getRttHistogram() const { return _socket->getRttHistogram(); }
+
+RUDP_histogram RUDP_Socket::getLatencyHistogram() const { return _socket->getLatencyHistogram(); }
+
+void RUDP_Socket::mergeHistogram(RUDP_histogram &into, const RUDP_histogram &from) { RUDP_Histogram::mergeHistogram(into, from); }
+
+uint64_t RUDP_Socket::getHistogramPercentile(const RUDP_histogram &histogram, double percentile) { return RUDP_Histogram::getPercentile(histogram, percentile); }
+
+bool RUDP_Socket::isTracing() const { return _socket->isTracing(); }
+
+bool RUDP_Socket::isPhaseTiming() const { return _socket->isPhaseTiming(); }
+
+uint32_t RUDP_Socket::readTrace(RUDP_trace_event *events, uint32_t max_events) { return _socket->readTrace(events, max_events); }
+
+const char *RUDP_Socket::getFlightRecorderFile() const { return _socket->getFlightRecorderFile(); }
+
+uint32_t RUDP_Socket::dumpFlightRecorder(const char *path) const { return _socket->dumpFlightRecorder(path); }
+
+bool RUDP_Socket::isKernelPacing() const { return _socket->isKernelPacing(); }
+
 bool RUDP_Socket::isDebugMode() const { return _socket->isDebugMode(); }
 
 bool RUDP_Socket::isConnected() const { return _socket->isConnected(); }
@@ -49,10 +99,38 @@ bool RUDP_Socket::isServer() const { return _socket->isServer(); }
 
 void RUDP_Socket::setDebugMode(bool debug_mode) { _socket->setDebugMode(debug_mode); }
 
+void RUDP_Socket::setProgressCallback(RUDP_progress_callback callback, void *user_data) { _socket->setProgressCallback(callback, user_data); }
+
 void RUDP_Socket::setMTU(uint16_t MTU) { _socket->setMTU(MTU); }
 
 void RUDP_Socket::setTimeout(uint16_t timeout) { _socket->setTimeout(timeout); }
 
 void RUDP_Socket::setMaxRetries(uint16_t max_retries) { _socket->setMaxRetries(max_retries); }
 
-void RUDP_Socket::forceUseOwnMTU() { _socket->forceUseOwnMTU(); }
\ No newline at end of file
+void RUDP_Socket::setWindowSize(uint16_t window_size) { _socket->setWindowSize(window_size); }
+
+void RUDP_Socket::setAckRatio(uint16_t ack_ratio) { _socket->setAckRatio(ack_ratio); }
+
+void RUDP_Socket::setAckDelay(uint16_t ack_delay) { _socket->setAckDelay(ack_delay); }
+
+void RUDP_Socket::forceUseOwnMTU() { _socket->forceUseOwnMTU(); }
+
+void RUDP_Socket::setPathMTUDiscovery(bool enable) { _socket->setPathMTUDiscovery(enable); }
+
+void RUDP_Socket::setSendBuffering(bool enable) { _socket->setSendBuffering(enable); }
+
+void RUDP_Socket::setSendBufferDelay(uint16_t delay) { _socket->setSendBufferDelay(delay); }
+
+void RUDP_Socket::setMaxRate(uint64_t rate) { _socket->setMaxRate(rate); }
+
+void RUDP_Socket::setKernelPacing(bool enable) { _socket->setKernelPacing(enable); }
+
+void RUDP_Socket::setRecvWindow(uint64_t bytes) { _socket->setRecvWindow(bytes); }
+
+void RUDP_Socket::setBufferAutoTuning(bool enable) { _socket->setBufferAutoTuning(enable); }
+
+void RUDP_Socket::setTracing(bool enable) { _socket->setTracing(enable); }
+
+void RUDP_Socket::setPhaseTiming(bool enable) { _socket->setPhaseTiming(enable); }
+
+void RUDP_Socket::setFlightRecorderFile(const char *path) { _socket->setFlightRecorderFile(path); }
\ No newline at end of file
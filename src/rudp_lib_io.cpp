@@ -0,0 +1,1570 @@
+/*
+ *  Reliable UDP implementation
+ *  Copyright (C) 2024  Roy Simanovich
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <bitset>
+#include <errno.h>
+#include "include/RUDP_API_wrap.hpp"
+
+/*
+ * @brief Checks if the last socket error only means "try again later".
+ * @return True if the error is transient (no data, interrupted or an ICMP error from a stale peer), false otherwise.
+ */
+static bool rudp_is_transient_error() {
+#if defined(_OPSYS_WINDOWS)
+	int last_error = WSAGetLastError();
+	return (last_error == WSAEWOULDBLOCK || last_error == WSAECONNRESET || last_error == WSAEINTR);
+#elif defined(_OPSYS_UNIX)
+	return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR || errno == ECONNREFUSED);
+#endif
+}
+
+/*
+ * @brief Checks if the last socket error means the packet is larger than the path MTU known to the kernel.
+ * @return True if the packet was too large, false otherwise.
+ */
+static bool rudp_is_message_too_long() {
+#if defined(_OPSYS_WINDOWS)
+	return (WSAGetLastError() == WSAEMSGSIZE);
+#elif defined(_OPSYS_UNIX)
+	return (errno == EMSGSIZE);
+#endif
+}
+
+/*
+ * @brief Converts a 64-bit number between host and network byte order (both ways).
+ * @param value The number to convert.
+ * @return The converted number.
+ */
+static uint64_t rudp_byte_order64(uint64_t value) {
+	if (htonl(1) == 1) return value;
+	return (((uint64_t)htonl((uint32_t)value)) << 32) | htonl((uint32_t)(value >> 32));
+}
+
+/*
+ * @brief Sends a packet on a connected socket, to leave at a given time (SO_TXTIME must be set on the socket).
+ * @param socket The socket.
+ * @param data The packet.
+ * @param size Size of the packet in bytes.
+ * @param departure When the kernel should send the packet.
+ * @return Number of bytes sent, or SOCKET_ERROR.
+ */
+static int rudp_send_at(SOCKET socket, const uint8_t *data, uint32_t size, std::chrono::steady_clock::time_point departure) {
+#if defined(SO_TXTIME) && defined(__linux__)
+	uint64_t txtime = (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(departure.time_since_epoch()).count();
+	char control[CMSG_SPACE(sizeof(txtime))] = {0};
+	struct iovec iov = {
+		.iov_base = (void *)data,
+		.iov_len = size
+	};
+	struct msghdr message;
+
+	memset(&message, 0, sizeof(message));
+	message.msg_iov = &iov;
+	message.msg_iovlen = 1;
+	message.msg_control = control;
+	message.msg_controllen = sizeof(control);
+
+	struct cmsghdr *cmsg = CMSG_FIRSTHDR(&message);
+	cmsg->cmsg_level = SOL_SOCKET;
+	cmsg->cmsg_type = SCM_TXTIME;
+	cmsg->cmsg_len = CMSG_LEN(sizeof(txtime));
+	memcpy(CMSG_DATA(cmsg), &txtime, sizeof(txtime));
+
+	return (int)sendmsg(socket, &message, 0);
+#else
+	(void)departure;
+	return ::send(socket, (const char *)data, size, 0);
+#endif
+}
+
+/*
+ * @brief Receives a packet on a connected socket, together with the kernel's count of dropped packets (SO_RXQ_OVFL must be set on the socket).
+ * @param socket The socket.
+ * @param buffer Where to store the packet.
+ * @param size Size of the buffer in bytes.
+ * @param drop_count Set to the number of packets the kernel dropped on the socket so far, left as is if the kernel didn't report it.
+ * @return Number of bytes received, or SOCKET_ERROR.
+ */
+static int rudp_recv_counting_drops(SOCKET socket, uint8_t *buffer, uint32_t size, uint32_t &drop_count) {
+#if defined(SO_RXQ_OVFL) && defined(__linux__)
+	char control[CMSG_SPACE(sizeof(uint32_t))];
+	struct iovec iov = {
+		.iov_base = buffer,
+		.iov_len = size
+	};
+	struct msghdr message;
+
+	memset(&message, 0, sizeof(message));
+	message.msg_iov = &iov;
+	message.msg_iovlen = 1;
+	message.msg_control = control;
+	message.msg_controllen = sizeof(control);
+
+	int bytes_recv = (int)recvmsg(socket, &message, 0);
+
+	// The count comes only once the kernel dropped something, and it counts since the socket was created.
+	for (struct cmsghdr *cmsg = (bytes_recv == SOCKET_ERROR ? nullptr : CMSG_FIRSTHDR(&message)); cmsg != nullptr; cmsg = CMSG_NXTHDR(&message, cmsg))
+	{
+		if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL) memcpy(&drop_count, CMSG_DATA(cmsg), sizeof(drop_count));
+	}
+
+	return bytes_recv;
+#else
+	(void)drop_count;
+	return ::recv(socket, (char *)buffer, size, 0);
+#endif
+}
+
+void RUDP_Socket_p::_engine_start() {
+	struct sockaddr_in wake_addr;
+	socklen_t wake_addr_len = sizeof(wake_addr);
+	memset(&wake_addr, 0, sizeof(wake_addr));
+	wake_addr.sin_family = AF_INET;
+	wake_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	wake_addr.sin_port = 0;
+
+	if ((m_wakeSocket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP)) == INVALID_SOCKET ||
+		bind(m_wakeSocket, (struct sockaddr *)&wake_addr, sizeof(wake_addr)) == SOCKET_ERROR ||
+		getsockname(m_wakeSocket, (struct sockaddr *)&wake_addr, &wake_addr_len) == SOCKET_ERROR ||
+		::connect(m_wakeSocket, (struct sockaddr *)&wake_addr, wake_addr_len) == SOCKET_ERROR)
+	{
+		m_isConnected = false;
+		_print_socket_error("Failed to create the I/O engine wake up socket", true);
+	}
+
+	_set_non_blocking(m_wakeSocket, true);
+	_set_non_blocking(m_socketHandle, true);
+
+	// Drop anything left over from a previous connection.
+	std::vector<uint8_t> *message = nullptr;
+	while (m_recvQueue.pop(message)) delete message;
+	for (auto stale : m_rxBacklog) delete stale;
+	m_rxBacklog.clear();
+	m_rxBacklogged = false;
+	m_rxBufferedBytes = 0;
+	m_rxWindowLow = false;
+	delete m_rxMessage;
+	m_rxMessage = nullptr;
+
+	m_engineBuffer.resize(RUDP_ENGINE_BUFFER_SIZE);
+
+	// Both sides number their data packets and messages from 1, so an ACK of 0 means nothing was received yet.
+	m_txWindowSize = std::min(m_windowSize, m_peersWindowSize);
+
+	// A ratio above half of the window would leave the sender waiting for the delayed ACK.
+	m_rxAckDelay = std::chrono::microseconds(std::min(m_ackDelay, m_peersAckDelay));
+	m_rxAckRatio = (m_rxAckDelay.count() == 0) ? 1 : std::max(1, std::min<int>(std::min(m_ackRatio, m_peersAckRatio), m_txWindowSize / 2));
+	m_rxUnacked = 0;
+	m_pathMTU = std::min(m_protocolMTU, m_peersMTU.load());
+	m_txBytesInFlight = 0;
+	m_txBytesBudget = (uint64_t)m_txWindowSize * m_pathMTU;
+
+	// Until the first ACK, the peer has room for its whole window.
+	m_txPeerWindow = m_txBytesBudget;
+	m_txPersisting = false;
+	m_txPersistInterval = std::chrono::milliseconds(m_protocolTimeout);
+
+	// Path MTU discovery needs the don't fragment bit, without it the probes would just be fragmented.
+	bool probing = (m_pathMTUDiscovery && _set_dont_fragment(m_socketHandle, true));
+
+	if (m_pathMTUDiscovery && !probing) RUDP_LOG_DEBUG("Warning: Can't set the don't fragment bit on this platform, path MTU discovery is disabled.");
+
+	m_txSlots.assign(m_txWindowSize, RUDP_tx_slot());
+	for (auto &slot : m_txSlots) slot.packet.resize(m_protocolMTU);
+
+	m_txInFlight.clear();
+	m_txRequest = nullptr;
+	m_txOffset = 0;
+	m_txStaged.clear();
+	m_txStagedBytes = 0;
+	m_txHolding = false;
+	m_txFlushing = false;
+	m_txPaceTokens = 0;
+	m_txPaceUpdatedAt = std::chrono::steady_clock::now();
+	m_txPaced = false;
+	m_txNextDeparture = std::chrono::steady_clock::time_point();
+	m_txTimeEnabled = (m_kernelPacing && _set_txtime(m_socketHandle));
+
+	if (m_kernelPacing && !m_txTimeEnabled) RUDP_LOG_DEBUG("Warning: Can't set SO_TXTIME on this platform, the I/O engine paces the packets itself.");
+
+	m_rxSocketBuffer = 0;
+
+	// A whole window can arrive (or be sent) back to back, and the kernel charges more than the packet size for each packet.
+	// With kernel pacing, the packets scheduled ahead wait in the send buffer too.
+	if (m_bufferAutoTuning)
+	{
+		uint64_t bytes = RUDP_SOCKET_BUFFER_WINDOWS * m_txBytesBudget;
+		uint64_t scheduled = m_txTimeEnabled ? m_maxRate.load(std::memory_order_relaxed) * RUDP_TXTIME_HORIZON_USEC / 1000000 : 0;
+
+		m_rxSocketBuffer = _grow_socket_buffer(m_socketHandle, true, (uint32_t)std::min<uint64_t>(bytes, RUDP_SOCKET_BUFFER_MAX));
+		uint32_t send_buffer = _grow_socket_buffer(m_socketHandle, false, (uint32_t)std::min<uint64_t>(bytes + scheduled, RUDP_SOCKET_BUFFER_MAX));
+
+		RUDP_LOG_DEBUG("Socket buffers: {} bytes to receive, {} bytes to send.", m_rxSocketBuffer, send_buffer);
+	}
+
+	m_rxDropCounting = _set_drop_counting(m_socketHandle);
+	m_rxKernelDrops = 0;
+
+	m_txNextMsgId = 1;
+	m_txNextSeqNum = 1;
+	m_txUnackedSeqNum = 1;
+	m_txDupAcks = 0;
+	m_txProgressReported = 0;
+	m_txActualPackets = 0;
+	m_txActualBytes = 0;
+	m_txRetryPackets = 0;
+	m_txTimeouts = 0;
+	m_txMessages = 0;
+	m_txMessageBytes = 0;
+	m_txSrtt = 0;
+	m_txRttVar = 0;
+	m_txRttHistogram.reset();
+	m_txLatencyHistogram.reset();
+
+	for (int phase = 0; phase < RUDP_PHASE_COUNT; phase++)
+	{
+		m_phaseNs[phase] = 0;
+		m_phaseCount[phase] = 0;
+	}
+
+	// An empty probe packet means path MTU discovery is off for this connection.
+	m_probePacket.clear();
+	m_probeSeqNum = 0;
+	m_probeSearching = false;
+	m_probeSize = 0;
+	m_txFragmenting = false;
+
+	if (probing)
+	{
+		// Sized for our own MTU, the largest the cap can grow to (with forceUseOwnMTU()).
+		m_probePacket.resize(std::min<uint16_t>(m_protocolMTU, RUDP_PMTU_MAX));
+		_engine_probe_start(m_pathMTU, _engine_probe_max());
+	}
+
+	m_rxOutOfOrder.clear();
+	m_rxMessageId = 0;
+	m_rxExpectedSeqNum = 1;
+	m_rxHighestSeqNum = 0;
+	m_rxAdvertisedWindow = m_windowSize;
+	m_rxAckHeldLast = false;
+	m_rxReplyExpected = false;
+	m_rxMessageEndedAt = std::chrono::steady_clock::time_point();
+	m_rxProgressReported = 0;
+	m_rxActualPackets = 0;
+	m_rxActualBytes = 0;
+	m_rxDupPackets = 0;
+	m_rxChecksumFailures = 0;
+	m_rxMessages = 0;
+
+	{
+		std::lock_guard<std::mutex> lock(m_waitMutex);
+		m_engineError.clear();
+	}
+
+	m_engineStop = false;
+	m_engineDraining = false;
+	m_useOwnMTU = false;
+	m_engineDiscarded = 0;
+	m_wakePending = false;
+	m_engineStartedAt = std::chrono::steady_clock::now();
+	m_engineRunning = true;
+	m_engineThread = std::thread(&RUDP_Socket_p::_engine_main, this);
+}
+
+void RUDP_Socket_p::_engine_stop(bool drain) {
+	if (m_engineThread.joinable())
+	{
+		// A draining engine stops by itself, once the peer acknowledged everything or the time is up.
+		if (drain)
+		{
+			m_engineDrainUntil = std::chrono::steady_clock::now() + std::chrono::milliseconds((uint32_t)m_protocolTimeout * m_protocolMaximumRetries);
+			m_engineDraining.store(true, std::memory_order_release);
+		}
+
+		else m_engineStop = true;
+
+		_engine_wake();
+		m_engineThread.join();
+	}
+
+	if (m_wakeSocket != INVALID_SOCKET)
+	{
+		closesocket(m_wakeSocket);
+		m_wakeSocket = INVALID_SOCKET;
+	}
+
+	if (m_socketHandle != INVALID_SOCKET)
+	{
+		_set_non_blocking(m_socketHandle, false);
+		if (!m_probePacket.empty()) _set_dont_fragment(m_socketHandle, false);
+	}
+}
+
+bool RUDP_Socket_p::_engine_submit(RUDP_send_request *request, bool wait_for_room) {
+	// Announce ourselves before checking the engine, so it can't exit between the check and the push.
+	m_sendersInside++;
+
+	if (!m_engineRunning)
+	{
+		m_sendersInside--;
+		throw std::runtime_error("There is no active connection to send data to.");
+	}
+
+	bool queued = m_sendQueue.push(request);
+
+	while (!queued && wait_for_room && m_engineRunning)
+	{
+		std::this_thread::yield();
+		queued = m_sendQueue.push(request);
+	}
+
+	if (queued) _engine_wake();
+	m_sendersInside--;
+
+	if (!queued && wait_for_room) throw std::runtime_error("There is no active connection to send data to.");
+	return queued;
+}
+
+void RUDP_Socket_p::_engine_wake() {
+	if (m_wakePending.exchange(true, std::memory_order_acq_rel)) return;
+
+	char wake_byte = 0;
+	::send(m_wakeSocket, &wake_byte, sizeof(wake_byte), 0);
+}
+
+void RUDP_Socket_p::_engine_main() {
+	bool failed = false;
+
+	_engine_trace(RUDP_TRACE_CONNECTED, RUDP_TRACE_REASON_NONE, 0, m_pathMTU, m_windowSize);
+
+	try
+	{
+		while (!m_engineStop.load(std::memory_order_acquire) && m_isConnected)
+		{
+			if (m_useOwnMTU.exchange(false, std::memory_order_acq_rel)) _engine_use_own_mtu();
+
+			_engine_fill_window();
+			_engine_probe();
+
+			// Every message taken from the queue stays in m_txInFlight until the peer acknowledged it.
+			bool draining = m_engineDraining.load(std::memory_order_acquire);
+			if (draining && ((m_txInFlight.empty() && m_sendQueue.empty()) || std::chrono::steady_clock::now() >= m_engineDrainUntil)) break;
+
+			int timeout = -1;
+			auto deadline = std::chrono::steady_clock::time_point::max();
+
+			// The retransmission timer runs for the oldest unacknowledged packet only.
+			if (m_txUnackedSeqNum != m_txNextSeqNum) deadline = m_txSlots[m_txUnackedSeqNum % m_txWindowSize].sent_at + std::chrono::milliseconds(m_protocolTimeout);
+			if (m_txHolding) deadline = std::min(deadline, m_txHoldUntil);
+			if (m_txPaced) deadline = std::min(deadline, m_txPaceNextAt);
+			if (m_txPersisting && !m_txHolding && !m_txPaced) deadline = std::min(deadline, m_txPersistAt);
+			if (m_rxUnacked != 0) deadline = std::min(deadline, m_rxAckDue);
+
+			// No probes go out while the don't fragment bit is off, see m_txFragmenting.
+			if (!m_txFragmenting && m_probeSize != 0) deadline = std::min(deadline, m_probeSentAt + std::chrono::milliseconds(m_protocolTimeout));
+			else if (!m_txFragmenting && !m_probePacket.empty() && !m_probeSearching) deadline = std::min(deadline, m_probeNextSearch);
+
+			if (draining) deadline = std::min(deadline, m_engineDrainUntil);
+
+			if (deadline != std::chrono::steady_clock::time_point::max())
+			{
+				auto now = std::chrono::steady_clock::now();
+				timeout = (deadline <= now) ? 0 : (int)std::chrono::ceil<std::chrono::milliseconds>(deadline - now).count();
+			}
+
+			// poll() can't time a pacing gap shorter than a millisecond, so it only checks the sockets, and the gap is waited below.
+			bool pace_wait = (m_txPaced && !m_txTimeEnabled && deadline == m_txPaceNextAt && timeout <= 1);
+			if (pace_wait) timeout = 0;
+
+			pollfd poll_fd[2] = {
+				{.fd = m_socketHandle, .events = POLLIN, .revents = 0 },
+				{.fd = m_wakeSocket, .events = POLLIN, .revents = 0 }
+			};
+
+			int ret = poll(poll_fd, 2, timeout);
+
+			if (ret == SOCKET_ERROR)
+			{
+				if (rudp_is_transient_error()) continue;
+				_print_socket_error("Failed to poll the socket", true);
+			}
+
+			if (pace_wait && ret == 0) _engine_pace_wait();
+
+			if (poll_fd[1].revents & POLLIN)
+			{
+				char wake_byte = 0;
+
+				// Only the thread that raised the flag sends a wake up byte, so there is exactly one to read before clearing it.
+				::recv(m_wakeSocket, &wake_byte, sizeof(wake_byte), 0);
+				m_wakePending.store(false, std::memory_order_release);
+			}
+
+			if (poll_fd[0].revents & (POLLIN | POLLERR)) _engine_receive();
+			if (m_rxUnacked != 0 && std::chrono::steady_clock::now() >= m_rxAckDue)
+			{
+				// No reply came in time to carry the ACK, so the next messages are acknowledged right away again.
+				if (m_rxAckHeldLast) m_rxReplyExpected = false;
+				_engine_send_ack();
+			}
+
+			// The application made room since a small window was advertised, tell the peer before it has to probe for it.
+			if (m_rxWindowLow.load(std::memory_order_acquire) && _engine_rx_window() >= std::max(1, m_windowSize / 2)) _engine_send_ack();
+
+			if (m_txUnackedSeqNum != m_txNextSeqNum &&
+				std::chrono::steady_clock::now() >= m_txSlots[m_txUnackedSeqNum % m_txWindowSize].sent_at + std::chrono::milliseconds(m_protocolTimeout))
+			{
+				const RUDP_tx_slot &slot = m_txSlots[m_txUnackedSeqNum % m_txWindowSize];
+
+				// A large packet that keeps timing out may be black-holed by a smaller link on the path.
+				if (!m_probePacket.empty() && slot.tries == RUDP_PMTU_BLACK_HOLE_TIMEOUTS) _engine_lower_path_mtu(slot.size);
+
+				m_txTimeouts++;
+				_engine_trace(RUDP_TRACE_TIMER_FIRED, RUDP_TRACE_REASON_TIMEOUT, m_txUnackedSeqNum, 0, 0);
+				_engine_trace(RUDP_TRACE_PACKET_LOST, RUDP_TRACE_REASON_TIMEOUT, m_txUnackedSeqNum, (uint16_t)slot.size, 0);
+				_engine_transmit(m_txUnackedSeqNum);
+			}
+
+			_engine_deliver();
+		}
+	}
+
+	catch (const std::exception &e)
+	{
+		// A lost packet leaves a hole that every later message depends on, so the whole connection is lost.
+		m_isConnected = false;
+		failed = true;
+
+		{
+			std::lock_guard<std::mutex> lock(m_waitMutex);
+			m_engineError = e.what();
+		}
+
+		// Keep the packets that led to the failure, before the waiting senders learn about it.
+		_flight_recorder_dump_on_failure();
+	}
+
+	// Don't leave the peer waiting for an ACK that was held back.
+	if (m_isConnected && m_rxUnacked != 0) _engine_send_ack();
+
+	// Hand over everything that is complete before announcing that the engine is gone.
+	_engine_deliver();
+
+	if (!m_rxBacklog.empty())
+	{
+		RUDP_LOG_DEBUG("Warning: Dropping {} received messages, the application didn't read them in time.", m_rxBacklog.size());
+		for (auto message : m_rxBacklog) delete message;
+		m_rxBacklog.clear();
+		m_rxBacklogged = false;
+	}
+
+	delete m_rxMessage;
+	m_rxMessage = nullptr;
+	m_rxOutOfOrder.clear();
+
+	_engine_trace(RUDP_TRACE_CLOSED, failed ? RUDP_TRACE_REASON_ERROR : RUDP_TRACE_REASON_NONE, 0, 0, 0);
+
+	m_engineStoppedAt = std::chrono::steady_clock::now();
+	m_engineRunning = false;
+
+	// Wait for senders that saw the engine running to finish pushing their requests.
+	while (m_sendersInside.load() != 0) std::this_thread::yield();
+
+	std::string error;
+
+	{
+		std::lock_guard<std::mutex> lock(m_waitMutex);
+		error = m_engineError;
+	}
+
+	int state = error.empty() ? RUDP_REQUEST_CLOSED : RUDP_REQUEST_FAILED;
+	RUDP_send_request *request = nullptr;
+
+	m_engineDiscarded = m_txInFlight.size();
+
+	for (auto in_flight : m_txInFlight) _engine_complete_request(in_flight, state, error);
+	m_txInFlight.clear();
+	m_txRequest = nullptr;
+	m_txStaged.clear();
+
+	while (m_sendQueue.pop(request))
+	{
+		m_engineDiscarded++;
+		_engine_complete_request(request, state, error);
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_waitMutex);
+	}
+
+	m_sendCondition.notify_all();
+	m_recvCondition.notify_all();
+}
+
+void RUDP_Socket_p::_engine_receive() {
+	// The socket is connected to the peer, so the kernel already dropped packets from anyone else.
+	while (m_isConnected)
+	{
+		uint32_t drop_count = m_rxDropCountSeen;
+		uint64_t phase = _phase_start();
+		int bytes_recv = m_rxDropCounting ? rudp_recv_counting_drops(m_socketHandle, m_engineBuffer.data(), m_engineBuffer.size(), drop_count) : ::recv(m_socketHandle, (char *)m_engineBuffer.data(), m_engineBuffer.size(), 0);
+
+		_phase_end(RUDP_PHASE_RECEIVE, phase);
+
+		if (drop_count != m_rxDropCountSeen) _engine_count_drops(drop_count);
+
+		if (bytes_recv == SOCKET_ERROR)
+		{
+			if (rudp_is_transient_error()) break;
+
+			// An ICMP "fragmentation needed" is reported on connected sockets too, the next oversized send handles it.
+			if (rudp_is_message_too_long()) continue;
+
+			_print_socket_error("Failed to receive a packet", true);
+		}
+
+		// Before the validity check, which overwrites the checksum.
+		_flight_record(RUDP_FLIGHT_RECORDER_RECEIVED, m_engineBuffer.data(), bytes_recv);
+
+		phase = _phase_start();
+		int packet_validity = _check_packet_validity(m_engineBuffer.data(), bytes_recv, 0);
+		_phase_end(RUDP_PHASE_CHECKSUM, phase);
+
+		if (packet_validity == 0)
+		{
+			RUDP_LOG_DEBUG("Warning: Dropping an invalid packet.");
+
+			m_rxChecksumFailures++;
+			_engine_trace(RUDP_TRACE_PACKET_DROPPED, RUDP_TRACE_REASON_CORRUPTED, 0, (uint16_t)bytes_recv, 0);
+
+			// Only the peer can reach a connected socket, so a damaged packet is most likely one of its data packets.
+			if (bytes_recv >= (int)sizeof(RUDP_header)) _engine_handle_corrupt((RUDP_header *)m_engineBuffer.data());
+			continue;
+		}
+
+		else if (packet_validity == -1) return;
+
+		RUDP_header *header = (RUDP_header *)m_engineBuffer.data();
+
+		if (header->flags & RUDP_FLAG_FIN) continue;
+
+		if (header->flags & RUDP_FLAG_SYN)
+		{
+			// The peer didn't get our SYN-ACK and is still trying to connect.
+			if (m_isServer && header->flags == RUDP_FLAG_SYN) _send_control_packet(RUDP_FLAG_SYN | RUDP_FLAG_ACK, 0, nullptr, 0);
+			continue;
+		}
+
+		if (header->flags & RUDP_FLAG_PROBE)
+		{
+			if (header->flags & RUDP_FLAG_ACK) _engine_handle_probe_ack(header);
+			else _send_control_packet(RUDP_FLAG_PROBE | RUDP_FLAG_ACK, ntohl(header->seq_num), nullptr, 0);
+			continue;
+		}
+
+		// Data packets may carry an ACK for our own data, which goes first.
+		if (header->flags & RUDP_FLAG_ACK) _engine_handle_ack(header);
+		if (header->flags & RUDP_FLAG_NAK) _engine_handle_nak(m_engineBuffer.data());
+		if (header->flags & RUDP_FLAG_PSH) _engine_handle_data(m_engineBuffer.data());
+	}
+}
+
+void RUDP_Socket_p::_engine_count_drops(uint32_t drop_count) {
+	// The kernel's count wraps around at 2^32.
+	uint32_t dropped = drop_count - m_rxDropCountSeen;
+	m_rxDropCountSeen = drop_count;
+	m_rxKernelDrops.fetch_add(dropped, std::memory_order_relaxed);
+
+	if (!m_bufferAutoTuning || m_rxSocketBuffer == 0 || m_rxSocketBuffer >= RUDP_SOCKET_BUFFER_MAX)
+	{
+		RUDP_LOG_DEBUG("Warning: The kernel dropped {} packets, the socket receive buffer was full.", dropped);
+		return;
+	}
+
+	// Packets arrived faster than the engine read them, so the buffer has to absorb longer bursts.
+	m_rxSocketBuffer = _grow_socket_buffer(m_socketHandle, true, std::min<uint32_t>(2 * m_rxSocketBuffer, RUDP_SOCKET_BUFFER_MAX));
+
+	RUDP_LOG_DEBUG("Warning: The kernel dropped {} packets, the socket receive buffer was full. Grew it to {} bytes.", dropped, m_rxSocketBuffer);
+}
+
+void RUDP_Socket_p::_engine_handle_ack(RUDP_header *header) {
+	// The ACK carries the last packet the peer received in order, everything up to it is acknowledged.
+	uint32_t ack_seq_num = ntohl(header->ack_seq_num);
+	int32_t advance = (int32_t)(ack_seq_num + 1 - m_txUnackedSeqNum);
+
+	// Every data packet of the peer repeats its ACK, so only ACK packets count as duplicates.
+	bool piggybacked = (header->flags & RUDP_FLAG_PSH);
+
+	// A NAK names the missing packets itself and _engine_handle_nak() resends them, so it is no loss signal here.
+	bool nak = (header->flags & RUDP_FLAG_NAK);
+
+	// The window counts from the ACK, so only the latest ACK tells how much room the peer has now.
+	uint64_t peer_window = (uint64_t)ntohs(header->window) * std::min(m_protocolMTU, m_peersMTU.load());
+
+	if (advance <= 0)
+	{
+		if (advance == 0 && peer_window != m_txPeerWindow)
+		{
+			_engine_trace(RUDP_TRACE_WINDOW_UPDATED, RUDP_TRACE_REASON_NONE, ack_seq_num, 0, peer_window);
+			m_txPeerWindow = peer_window;
+		}
+
+		// The peer is still missing the oldest packet, but the packets after it keep arriving.
+		if (advance == 0 && m_txUnackedSeqNum != m_txNextSeqNum)
+		{
+			if (nak) return;
+			if (!piggybacked) m_txDupAcks++;
+			_engine_fast_retransmit(ntohl(header->sack));
+		}
+
+		else if (!piggybacked && !nak) RUDP_LOG_DEBUG("Warning: Received a duplicate ACK packet with sequence number {}, ignoring it.", ack_seq_num);
+		return;
+	}
+
+	if ((int32_t)(ack_seq_num + 1 - m_txNextSeqNum) > 0)
+	{
+		RUDP_LOG_DEBUG("Warning: Received an ACK packet for sequence number {}, which wasn't sent yet, ignoring it.", ack_seq_num);
+		return;
+	}
+
+	if (peer_window != m_txPeerWindow)
+	{
+		_engine_trace(RUDP_TRACE_WINDOW_UPDATED, RUDP_TRACE_REASON_NONE, ack_seq_num, 0, peer_window);
+		m_txPeerWindow = peer_window;
+	}
+
+	// Karn's algorithm: the ACK of a retransmitted packet may be for any of its copies, so it can't be timed.
+	// The ACK of a later packet waited for the retransmission too, so only an ACK that covers no retransmission is.
+	bool timed = true;
+
+	for (; m_txUnackedSeqNum != ack_seq_num + 1; m_txUnackedSeqNum++)
+	{
+		const RUDP_tx_slot &slot = m_txSlots[m_txUnackedSeqNum % m_txWindowSize];
+
+		m_txBytesInFlight -= slot.size;
+		if (slot.tries != 1) timed = false;
+	}
+
+	_engine_trace(RUDP_TRACE_PACKET_ACKED, RUDP_TRACE_REASON_NONE, ack_seq_num, (uint16_t)advance, m_txBytesInFlight);
+
+	// The packets larger than the path MTU are all through, the don't fragment bit goes back on for the probes.
+	if (m_txFragmenting && (int32_t)(m_txUnackedSeqNum - m_txFragmentUntil) >= 0)
+	{
+		_set_dont_fragment(m_socketHandle, true);
+		m_txFragmenting = false;
+	}
+
+	m_txDupAcks = 0;
+
+	// The slot of the last acknowledged packet stays untouched until the window is filled again.
+	const RUDP_tx_slot &acked_slot = m_txSlots[ack_seq_num % m_txWindowSize];
+
+	auto now = std::chrono::steady_clock::now();
+	if (timed && now > acked_slot.sent_at) _engine_sample_rtt(now - acked_slot.sent_at);
+
+	while (!m_txInFlight.empty())
+	{
+		RUDP_send_request *request = m_txInFlight.front();
+
+		if (!request->packetized || (int32_t)(request->last_seq_num - ack_seq_num) > 0)
+		{
+			if (acked_slot.request == request && acked_slot.end_offset - m_txProgressReported >= RUDP_PROGRESS_INTERVAL)
+			{
+				m_txProgressReported = acked_slot.end_offset;
+				_engine_report_progress(true, acked_slot.end_offset, request->size);
+			}
+
+			break;
+		}
+
+		m_txInFlight.pop_front();
+		m_txProgressReported = 0;
+		m_txMessages++;
+		m_txMessageBytes += request->size;
+		m_txLatencyHistogram.record((uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(now - request->submitted_at).count());
+
+		// The slots acknowledged by this ACK aren't reused yet, so the last packet of the message is still there.
+		if (_phase_timing()) _phase_add(RUDP_PHASE_ACK_WAIT, (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(now - m_txSlots[request->last_seq_num % m_txWindowSize].first_sent_at).count());
+		_engine_report_progress(true, request->size, request->size);
+
+		RUDP_LOG_DEBUG("Sent message {} of {} bytes.\nActual overhead so far: {} bytes over {} packets, of which {} are retransmissions.", request->msg_id, request->size, m_txActualBytes, m_txActualPackets, m_txRetryPackets);
+
+		request->result = (int64_t)request->size;
+		_engine_complete_request(request, RUDP_REQUEST_DONE);
+	}
+
+	// The SACK hint may already show that the next packet is missing too.
+	if (m_txUnackedSeqNum != m_txNextSeqNum && !nak) _engine_fast_retransmit(ntohl(header->sack));
+}
+
+void RUDP_Socket_p::_engine_trace_record(uint8_t type, uint8_t reason, uint32_t seq_num, uint16_t size, uint64_t value) {
+	uint64_t time_us = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+
+	// The events that found the ring full are reported once the application makes room again.
+	if (m_traceLost != 0)
+	{
+		if (!m_traceRing->push({time_us, m_traceLost, 0, 0, RUDP_TRACE_EVENTS_LOST, RUDP_TRACE_REASON_NONE}))
+		{
+			m_traceLost++;
+			return;
+		}
+
+		m_traceLost = 0;
+	}
+
+	if (!m_traceRing->push({time_us, value, seq_num, size, type, reason})) m_traceLost++;
+}
+
+void RUDP_Socket_p::_engine_sample_rtt(std::chrono::steady_clock::duration rtt) {
+	// A sample under a microsecond still counts as one, 0 means no sample yet.
+	uint64_t sample = std::max<uint64_t>(1, (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(rtt).count());
+	uint64_t srtt = m_txSrtt.load(std::memory_order_relaxed);
+	uint64_t rttvar = m_txRttVar.load(std::memory_order_relaxed);
+
+	if (srtt == 0)
+	{
+		srtt = sample;
+		rttvar = sample / 2;
+	}
+
+	else
+	{
+		rttvar = (3 * rttvar + (srtt > sample ? srtt - sample : sample - srtt)) / 4;
+		srtt = (7 * srtt + sample) / 8;
+	}
+
+	m_txSrtt.store(srtt, std::memory_order_relaxed);
+	m_txRttVar.store(rttvar, std::memory_order_relaxed);
+	m_txRttHistogram.record(sample);
+}
+
+void RUDP_Socket_p::_engine_fast_retransmit(uint32_t sack) {
+	// Enough packets after the oldest one got through, by duplicate ACKs or by the SACK hint, to take it as lost.
+	RUDP_tx_slot &slot = m_txSlots[m_txUnackedSeqNum % m_txWindowSize];
+
+	if (slot.fast_retransmitted || (m_txDupAcks < RUDP_FAST_RETRANSMIT_THRESHOLD && std::bitset<32>(sack).count() < RUDP_FAST_RETRANSMIT_THRESHOLD)) return;
+
+	RUDP_LOG_DEBUG("Warning: The peer is missing packet {} ({} duplicate ACKs, {} later packets received), retransmitting it without waiting for the timeout.", m_txUnackedSeqNum, m_txDupAcks, std::bitset<32>(sack).count());
+
+	slot.fast_retransmitted = true;
+	_engine_trace(RUDP_TRACE_PACKET_LOST, RUDP_TRACE_REASON_DUP_ACKS, m_txUnackedSeqNum, (uint16_t)slot.size, 0);
+	_engine_transmit(m_txUnackedSeqNum);
+}
+
+void RUDP_Socket_p::_engine_handle_nak(const uint8_t *packet) {
+	const RUDP_header *header = (const RUDP_header *)packet;
+	uint16_t ranges = ntohs(header->length) / sizeof(RUDP_NAK_range);
+
+	for (uint16_t i = 0; i < ranges; i++)
+	{
+		RUDP_NAK_range range;
+		memcpy(&range, packet + sizeof(RUDP_header) + i * sizeof(RUDP_NAK_range), sizeof(range));
+
+		uint32_t first = ntohl(range.first), last = ntohl(range.last);
+
+		// Only the packets still in flight can be resent, the rest were acknowledged since or were never sent.
+		if ((int32_t)(first - m_txUnackedSeqNum) < 0) first = m_txUnackedSeqNum;
+		if ((int32_t)(last - m_txNextSeqNum) >= 0) last = m_txNextSeqNum - 1;
+
+		for (uint32_t seq_num = first; (int32_t)(last - seq_num) >= 0; seq_num++)
+		{
+			// Every NAK reports a new loss, even of a retransmission, but the duplicate ACKs of the same hole must not resend it once more.
+			m_txSlots[seq_num % m_txWindowSize].fast_retransmitted = true;
+
+			RUDP_LOG_DEBUG("Warning: The peer reported packet {} as missing or corrupted, retransmitting it without waiting for the timeout.", seq_num);
+
+			_engine_trace(RUDP_TRACE_PACKET_LOST, RUDP_TRACE_REASON_NAK, seq_num, (uint16_t)m_txSlots[seq_num % m_txWindowSize].size, 0);
+			_engine_transmit(seq_num);
+		}
+	}
+}
+
+void RUDP_Socket_p::_engine_handle_data(uint8_t *packet) {
+	RUDP_header *header = (RUDP_header *)packet;
+	uint32_t packet_seq_num = ntohl(header->seq_num);
+	uint16_t packet_size = ntohs(header->length);
+	int32_t distance = (int32_t)(packet_seq_num - m_rxExpectedSeqNum);
+
+	m_rxActualBytes += (sizeof(RUDP_header) + packet_size);
+	m_rxActualPackets++;
+
+	_engine_trace(RUDP_TRACE_PACKET_RECEIVED, distance < 0 ? RUDP_TRACE_REASON_DUPLICATE : distance >= m_windowSize ? RUDP_TRACE_REASON_BEYOND_WINDOW : distance > 0 ? RUDP_TRACE_REASON_OUT_OF_ORDER : RUDP_TRACE_REASON_NONE, packet_seq_num, (uint16_t)(sizeof(RUDP_header) + packet_size), 0);
+
+	if (distance < 0)
+	{
+		// A retransmission of a packet we already have, its ACK was lost.
+		RUDP_LOG_DEBUG("Warning: Received a duplicate packet with sequence number {}, send duplicate ACK packet.", packet_seq_num);
+		m_rxDupPackets++;
+	}
+
+	else if (distance >= m_windowSize)
+	{
+		RUDP_LOG_DEBUG("Warning: Received a packet with sequence number {}, which is beyond the window (expected {}), dropping it.", packet_seq_num, m_rxExpectedSeqNum);
+	}
+
+	else if (distance > 0)
+	{
+		RUDP_LOG_DEBUG("Warning: Received an out-of-order packet with sequence number {}, expected {}, keeping it until the missing packets arrive.", packet_seq_num, m_rxExpectedSeqNum);
+		if (!m_rxOutOfOrder.emplace(packet_seq_num, std::vector<uint8_t>(packet, packet + sizeof(RUDP_header) + packet_size)).second) m_rxDupPackets++;
+
+		// The packets between the highest one seen so far and this one are missing, ask for them right away.
+		uint32_t first_missing = ((int32_t)(m_rxHighestSeqNum + 1 - m_rxExpectedSeqNum) > 0 ? m_rxHighestSeqNum + 1 : m_rxExpectedSeqNum);
+
+		if ((int32_t)(packet_seq_num - first_missing) >= 0) m_rxHighestSeqNum = packet_seq_num;
+
+		if ((int32_t)(packet_seq_num - first_missing) > 0)
+		{
+			_engine_send_nak(first_missing, packet_seq_num - 1);
+			return;
+		}
+	}
+
+	else
+	{
+		// A filled gap and the end of a message are acknowledged right away, the sender is waiting for them.
+		bool filled_gap = !m_rxOutOfOrder.empty(), last = (header->flags & RUDP_FLAG_LAST);
+		uint64_t phase = _phase_start();
+
+		_engine_accept_data(packet);
+		m_rxExpectedSeqNum++;
+
+		auto next = m_rxOutOfOrder.find(m_rxExpectedSeqNum);
+
+		while (next != m_rxOutOfOrder.end())
+		{
+			_engine_accept_data(next->second.data());
+			m_rxOutOfOrder.erase(next);
+			next = m_rxOutOfOrder.find(++m_rxExpectedSeqNum);
+		}
+
+		_phase_end(RUDP_PHASE_REASSEMBLY, phase);
+
+		if ((int32_t)(m_rxExpectedSeqNum - 1 - m_rxHighestSeqNum) > 0) m_rxHighestSeqNum = m_rxExpectedSeqNum - 1;
+
+		if (!filled_gap && last)
+		{
+			m_rxMessageEndedAt = std::chrono::steady_clock::now();
+
+			// A peer that gets a quick reply gets the ACK on the reply, if it comes within the ACK delay.
+			if (m_rxReplyExpected)
+			{
+				if (m_rxUnacked++ == 0) m_rxAckDue = m_rxMessageEndedAt + m_rxAckDelay;
+				m_rxAckHeldLast = true;
+				return;
+			}
+		}
+
+		else if (!filled_gap && ++m_rxUnacked < m_rxAckRatio)
+		{
+			if (m_rxUnacked == 1) m_rxAckDue = std::chrono::steady_clock::now() + m_rxAckDelay;
+			return;
+		}
+	}
+
+	// Duplicates and out-of-order packets repeat the last ACK, which tells the sender about the hole.
+	_engine_send_ack();
+}
+
+void RUDP_Socket_p::_engine_send_ack() {
+	RUDP_header header;
+
+	_engine_fill_ack(&header, false);
+	header.checksum = htons(RUDP_Socket_p::_calculate_checksum(&header, sizeof(header)));
+
+	_engine_trace(RUDP_TRACE_ACK_SENT, RUDP_TRACE_REASON_NONE, m_rxExpectedSeqNum - 1, 0, m_rxAdvertisedWindow);
+
+	int bytes_sent = ::send(m_socketHandle, (char *)&header, sizeof(header), 0);
+
+	if (bytes_sent == SOCKET_ERROR) _print_socket_error("Failed to send an ACK packet", false);
+	else _flight_record(RUDP_FLIGHT_RECORDER_SENT, &header, bytes_sent);
+}
+
+void RUDP_Socket_p::_engine_send_nak(uint32_t first, uint32_t last) {
+	uint8_t packet[sizeof(RUDP_header) + sizeof(RUDP_NAK_range)] = {0};
+	RUDP_header *header = (RUDP_header *)packet;
+	RUDP_NAK_range range;
+
+	range.first = htonl(first);
+	range.last = htonl(last);
+	memcpy(packet + sizeof(RUDP_header), &range, sizeof(range));
+
+	header->flags = RUDP_FLAG_NAK;
+	header->length = htons(sizeof(RUDP_NAK_range));
+	_engine_fill_ack(header, false);
+	header->checksum = htons(RUDP_Socket_p::_calculate_checksum(packet, sizeof(packet)));
+
+	RUDP_LOG_DEBUG("Warning: Packets {} to {} are missing, sending a NAK packet.", first, last);
+
+	_engine_trace(RUDP_TRACE_NAK_SENT, RUDP_TRACE_REASON_NONE, first, 0, last);
+
+	int bytes_sent = ::send(m_socketHandle, (char *)packet, sizeof(packet), 0);
+
+	if (bytes_sent == SOCKET_ERROR) _print_socket_error("Failed to send a NAK packet", false);
+	else _flight_record(RUDP_FLIGHT_RECORDER_SENT, packet, bytes_sent);
+}
+
+void RUDP_Socket_p::_engine_handle_corrupt(const RUDP_header *header) {
+	uint32_t seq_num = ntohl(header->seq_num);
+	int32_t distance = (int32_t)(seq_num - m_rxExpectedSeqNum);
+
+	// The damage may be in the header itself, so a sequence number outside of our window isn't trusted.
+	if ((header->flags & (RUDP_FLAG_PSH | RUDP_FLAG_PROBE)) != RUDP_FLAG_PSH || distance < 0 || distance >= m_windowSize || m_rxOutOfOrder.count(seq_num) != 0)
+	{
+		// Without a sequence number, the packet we wait for is the most likely one.
+		_engine_send_nak(m_rxExpectedSeqNum, m_rxExpectedSeqNum);
+		return;
+	}
+
+	// Like an out-of-order packet, it also tells that the packets before it are missing.
+	uint32_t first_missing = ((int32_t)(m_rxHighestSeqNum + 1 - m_rxExpectedSeqNum) > 0 ? m_rxHighestSeqNum + 1 : m_rxExpectedSeqNum);
+
+	if ((int32_t)(seq_num - first_missing) >= 0)
+	{
+		m_rxHighestSeqNum = seq_num;
+		_engine_send_nak(first_missing, seq_num);
+	}
+
+	else _engine_send_nak(seq_num, seq_num);
+}
+
+void RUDP_Socket_p::_engine_fill_ack(RUDP_header *header, bool with_data) {
+	// Data going out shortly after a message arrived is taken as a reply, so the ACKs of the next messages wait for the replies.
+	if (with_data && !m_rxReplyExpected && m_rxAckDelay.count() != 0 && m_rxMessageEndedAt != std::chrono::steady_clock::time_point())
+	{
+		m_rxReplyExpected = (std::chrono::steady_clock::now() - m_rxMessageEndedAt <= m_rxAckDelay);
+		if (!m_rxReplyExpected) m_rxMessageEndedAt = std::chrono::steady_clock::time_point();
+	}
+
+	uint32_t sack = 0;
+
+	// Bit i stands for the packet i + 1 places after the missing one.
+	for (const auto &held : m_rxOutOfOrder)
+	{
+		uint32_t distance = held.first - m_rxExpectedSeqNum - 1;
+		if (distance < 32) sack |= (1U << distance);
+	}
+
+	m_rxAdvertisedWindow = _engine_rx_window();
+	m_rxWindowLow.store(m_rxAdvertisedWindow < std::max(1, m_windowSize / 2), std::memory_order_release);
+
+	header->flags |= RUDP_FLAG_ACK;
+	header->ack_seq_num = htonl(m_rxExpectedSeqNum - 1);
+	header->sack = htonl(sack);
+	header->window = htons(m_rxAdvertisedWindow);
+
+	m_rxUnacked = 0;
+	m_rxAckHeldLast = false;
+}
+
+uint16_t RUDP_Socket_p::_engine_rx_window() {
+	uint64_t buffered = m_rxBufferedBytes.load(std::memory_order_acquire);
+
+	// An application that read everything keeps up, whatever the size of the message being reassembled.
+	if (buffered == 0) return m_windowSize;
+
+	uint64_t used = buffered + (m_rxMessage != nullptr ? m_rxMessage->size() : 0), limit = m_recvWindow.load(std::memory_order_relaxed);
+
+	if (used >= limit) return 0;
+	return (uint16_t)std::min<uint64_t>((limit - used) / std::min(m_protocolMTU, m_peersMTU.load()), m_windowSize);
+}
+
+void RUDP_Socket_p::_engine_accept_data(const uint8_t *packet) {
+	const RUDP_header *header = (const RUDP_header *)packet;
+	uint32_t msg_id = ntohl(header->msg_id);
+	uint64_t offset = rudp_byte_order64(header->offset);
+	uint16_t packet_size = ntohs(header->length);
+
+	if (m_rxMessage != nullptr && msg_id != m_rxMessageId)
+	{
+		RUDP_LOG_DEBUG("Warning: Message {} ended without a LAST packet, dropping its {} bytes.", m_rxMessageId, m_rxMessage->size());
+		delete m_rxMessage;
+		m_rxMessage = nullptr;
+	}
+
+	if (header->flags & RUDP_FLAG_BATCH)
+	{
+		_engine_accept_batch(packet);
+		return;
+	}
+
+	// A message that fits in one packet is taken as is, without going through the reassembly.
+	if (m_rxMessage == nullptr && offset == 0 && (header->flags & RUDP_FLAG_LAST))
+	{
+		m_rxMessageId = msg_id;
+		m_rxBacklog.push_back(new std::vector<uint8_t>(packet + sizeof(RUDP_header), packet + sizeof(RUDP_header) + packet_size));
+		m_rxBufferedBytes.fetch_add(packet_size, std::memory_order_acq_rel);
+		_engine_report_progress(false, packet_size, packet_size);
+
+		RUDP_LOG_DEBUG("Received message {} of {} bytes.\nActual overhead so far: {} bytes over {} packets, of which {} are duplicate packets.", msg_id, packet_size, m_rxActualBytes, m_rxActualPackets, m_rxDupPackets);
+
+		return;
+	}
+
+	if (m_rxMessage == nullptr)
+	{
+		m_rxMessage = new std::vector<uint8_t>();
+		m_rxMessageId = msg_id;
+		m_rxProgressReported = 0;
+	}
+
+	// Packets are handed over in sequence order, so each one must carry on right where the message ended so far (they may be of any size).
+	// An offset anywhere else only comes from a broken peer, and growing the message to it could take any amount of memory.
+	if (offset != m_rxMessage->size() || packet_size > RUDP_MAX_MESSAGE_SIZE - offset)
+		throw std::runtime_error("Protocol error: packet " + std::to_string(ntohl(header->seq_num)) + " puts " + std::to_string(packet_size) + " bytes at offset " + std::to_string(offset) + " of message " + std::to_string(msg_id) + ", which has " + std::to_string(m_rxMessage->size()) + " bytes so far.");
+
+	m_rxMessage->insert(m_rxMessage->end(), packet + sizeof(RUDP_header), packet + sizeof(RUDP_header) + packet_size);
+
+	if ((header->flags & RUDP_FLAG_LAST) == 0)
+	{
+		if (offset + packet_size - m_rxProgressReported >= RUDP_PROGRESS_INTERVAL)
+		{
+			m_rxProgressReported = offset + packet_size;
+			_engine_report_progress(false, m_rxProgressReported, 0);
+		}
+	}
+
+	else
+	{
+		_engine_report_progress(false, m_rxMessage->size(), m_rxMessage->size());
+
+		RUDP_LOG_DEBUG("Received message {} of {} bytes.\nActual overhead so far: {} bytes over {} packets, of which {} are duplicate packets.", m_rxMessageId, m_rxMessage->size(), m_rxActualBytes, m_rxActualPackets, m_rxDupPackets);
+
+		m_rxBacklog.push_back(m_rxMessage);
+		m_rxBufferedBytes.fetch_add(m_rxMessage->size(), std::memory_order_acq_rel);
+		m_rxMessage = nullptr;
+	}
+}
+
+void RUDP_Socket_p::_engine_accept_batch(const uint8_t *packet) {
+	const RUDP_header *header = (const RUDP_header *)packet;
+	const uint8_t *payload = packet + sizeof(RUDP_header);
+	uint32_t msg_id = ntohl(header->msg_id);
+	uint16_t packet_size = ntohs(header->length);
+	uint32_t position = 0;
+
+	// The messages of a batch have consecutive IDs, starting from the one in the header.
+	while (packet_size - position >= RUDP_BATCH_RECORD_HEADER_SIZE)
+	{
+		uint16_t record_size;
+		memcpy(&record_size, payload + position, sizeof(record_size));
+		record_size = ntohs(record_size);
+		position += RUDP_BATCH_RECORD_HEADER_SIZE;
+
+		if (record_size > packet_size - position) break;
+
+		std::vector<uint8_t> *message = new std::vector<uint8_t>(payload + position, payload + position + record_size);
+		position += record_size;
+
+		_engine_report_progress(false, message->size(), message->size());
+		RUDP_LOG_DEBUG("Received message {} of {} bytes (batched).", msg_id, message->size());
+
+		m_rxBacklog.push_back(message);
+		m_rxBufferedBytes.fetch_add(message->size(), std::memory_order_acq_rel);
+		m_rxMessageId = msg_id++;
+	}
+
+	if (position != packet_size) RUDP_LOG_DEBUG("Warning: Malformed BATCH packet, dropping its last {} bytes.", (packet_size - position));
+}
+
+void RUDP_Socket_p::_engine_fill_window() {
+	// Nothing may wait for more messages while disconnect() waits for the last ones.
+	if (m_sendFlush.exchange(false, std::memory_order_acq_rel) || m_engineDraining.load(std::memory_order_relaxed)) m_txFlushing = true;
+
+	m_txHolding = false;
+	m_txPaced = false;
+
+	// A closed peer window lets one packet through as a probe once the persist timer runs out, its ACK brings the current window.
+	bool probe = (m_txPersisting && std::chrono::steady_clock::now() >= m_txPersistAt);
+
+	if (probe) _engine_trace(RUDP_TRACE_TIMER_FIRED, RUDP_TRACE_REASON_PERSIST, m_txNextSeqNum, 0, 0);
+
+	while ((uint32_t)(m_txNextSeqNum - m_txUnackedSeqNum) < m_txWindowSize && m_txBytesInFlight + m_pathMTU <= m_txBytesBudget &&
+		(m_txBytesInFlight + m_pathMTU <= m_txPeerWindow || probe))
+	{
+		if (m_txRequest == nullptr)
+		{
+			uint32_t records = _engine_stage();
+
+			if (m_txStaged.empty()) break;
+
+			// Everything staged fits in one packet with room to spare, so it may wait for more messages.
+			if (records == m_txStaged.size() && _engine_hold_batch())
+			{
+				m_txHolding = true;
+				break;
+			}
+
+			if (!_engine_pace_ready()) break;
+
+			if (records >= 2)
+			{
+				uint32_t seq_num = m_txNextSeqNum;
+				_engine_build_batch(records);
+				_engine_transmit(seq_num);
+				probe = false;
+				continue;
+			}
+
+			// A lone or large message goes as usual, split into packets at its offsets.
+			m_txRequest = m_txStaged.front();
+			m_txStaged.pop_front();
+			m_txStagedBytes -= (RUDP_BATCH_RECORD_HEADER_SIZE + m_txRequest->size);
+			m_txOffset = 0;
+		}
+
+		else if (!_engine_pace_ready()) break;
+
+		uint32_t seq_num = m_txNextSeqNum;
+		_engine_build_packet();
+		_engine_transmit(seq_num);
+		probe = false;
+	}
+
+	if (m_txStaged.empty()) m_txFlushing = false;
+
+	if (m_txBytesInFlight + m_pathMTU <= m_txPeerWindow)
+	{
+		m_txPersisting = false;
+		m_txPersistInterval = std::chrono::milliseconds(m_protocolTimeout);
+		return;
+	}
+
+	// With data in flight, its ACKs bring the window updates. Otherwise the peer's update may get lost, so the window is probed.
+	if (m_txUnackedSeqNum == m_txNextSeqNum && m_txRequest == nullptr && m_txStaged.empty()) _engine_stage();
+
+	if (m_txUnackedSeqNum != m_txNextSeqNum || (m_txRequest == nullptr && m_txStaged.empty()))
+	{
+		m_txPersisting = false;
+		return;
+	}
+
+	if (m_txPersisting) return;
+
+	RUDP_LOG_DEBUG("Warning: The peer's receive window is closed, probing it in {} ms.", m_txPersistInterval.count());
+
+	// Each probe that finds the window still closed doubles the wait for the next one.
+	m_txPersisting = true;
+	m_txPersistAt = std::chrono::steady_clock::now() + m_txPersistInterval;
+	m_txPersistInterval = std::min(m_txPersistInterval * 2, std::chrono::milliseconds(RUDP_WINDOW_PROBE_MAX_INTERVAL));
+}
+
+bool RUDP_Socket_p::_engine_pace_ready() {
+	uint64_t rate = m_maxRate.load(std::memory_order_relaxed);
+	auto now = std::chrono::steady_clock::now();
+
+	// The kernel holds every packet until its departure time, only the schedule must not run too far ahead.
+	if (m_txTimeEnabled)
+	{
+		if (rate == 0 || m_txNextDeparture - now <= std::chrono::microseconds(RUDP_TXTIME_HORIZON_USEC)) return true;
+
+		m_txPaced = true;
+		m_txPaceNextAt = m_txNextDeparture - std::chrono::microseconds(RUDP_TXTIME_HORIZON_USEC);
+		return false;
+	}
+
+	// The tokens come in at the maximum rate, and an idle sender saves up only a short burst.
+	double burst = (double)RUDP_PACER_BURST * m_pathMTU;
+	m_txPaceTokens = std::min(burst, m_txPaceTokens + std::chrono::duration<double>(now - m_txPaceUpdatedAt).count() * rate);
+	m_txPaceUpdatedAt = now;
+
+	// A packet may go out as long as the bucket isn't in debt, it pays for itself when sent.
+	if (rate == 0 || m_txPaceTokens >= 0) return true;
+
+	m_txPaced = true;
+	m_txPaceNextAt = now + std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<double>(-m_txPaceTokens / rate));
+	return false;
+}
+
+void RUDP_Socket_p::_engine_pace_wait() {
+	auto remaining = m_txPaceNextAt - std::chrono::steady_clock::now();
+
+	// A sleep may overshoot by tens of microseconds, so the end of the gap is spun.
+	if (remaining > std::chrono::microseconds(RUDP_PACER_SPIN_USEC)) std::this_thread::sleep_for(remaining - std::chrono::microseconds(RUDP_PACER_SPIN_USEC));
+	while (std::chrono::steady_clock::now() < m_txPaceNextAt);
+}
+
+uint32_t RUDP_Socket_p::_engine_stage() {
+	uint64_t capacity = m_pathMTU - sizeof(RUDP_header);
+	// A flush (or uncork) still packs what is already queued, it only stops waiting for more.
+	bool batching = (m_sendBuffering.load(std::memory_order_relaxed) || m_sendCorked.load(std::memory_order_relaxed) || m_txFlushing);
+	RUDP_send_request *request = nullptr;
+
+	while ((m_txStaged.empty() || (batching && m_txStagedBytes < capacity)) && m_sendQueue.pop(request))
+	{
+		request->msg_id = m_txNextMsgId++;
+		request->staged_at = std::chrono::steady_clock::now();
+		m_txInFlight.push_back(request);
+		m_txStaged.push_back(request);
+		m_txStagedBytes += (RUDP_BATCH_RECORD_HEADER_SIZE + request->size);
+
+		RUDP_LOG_DEBUG("Sending message {} of {} bytes.", request->msg_id, request->size);
+	}
+
+	if (!batching) return 0;
+
+	uint32_t records = 0;
+	uint64_t bytes = 0;
+
+	for (auto staged : m_txStaged)
+	{
+		bytes += (RUDP_BATCH_RECORD_HEADER_SIZE + staged->size);
+		if (bytes > capacity) break;
+		records++;
+	}
+
+	return records;
+}
+
+bool RUDP_Socket_p::_engine_hold_batch() {
+	if (m_txFlushing || m_txStagedBytes >= (uint64_t)(m_pathMTU - sizeof(RUDP_header))) return false;
+
+	// Nagle's algorithm: a partial packet waits only while earlier data is unacknowledged. A corked socket always waits.
+	if (!m_sendCorked.load(std::memory_order_relaxed) && (!m_sendBuffering.load(std::memory_order_relaxed) || m_txUnackedSeqNum == m_txNextSeqNum)) return false;
+
+	uint16_t delay = m_sendBufferDelay.load(std::memory_order_relaxed);
+	m_txHoldUntil = (delay == 0) ? std::chrono::steady_clock::time_point::max() : m_txStaged.front()->staged_at + std::chrono::milliseconds(delay);
+
+	return (std::chrono::steady_clock::now() < m_txHoldUntil);
+}
+
+void RUDP_Socket_p::_engine_build_batch(uint32_t records) {
+	uint64_t phase = _phase_start();
+	RUDP_tx_slot &slot = m_txSlots[m_txNextSeqNum % m_txWindowSize];
+	uint8_t *payload = slot.packet.data() + sizeof(RUDP_header);
+	uint32_t packet_size = 0, msg_id = m_txStaged.front()->msg_id;
+	RUDP_send_request *request = nullptr;
+
+	// Each message goes whole, prefixed by its length, and they all complete once the packet is acknowledged.
+	for (uint32_t i = 0; i < records; i++)
+	{
+		request = m_txStaged.front();
+		m_txStaged.pop_front();
+		m_txStagedBytes -= (RUDP_BATCH_RECORD_HEADER_SIZE + request->size);
+
+		uint16_t record_size = htons((uint16_t)request->size);
+		memcpy(payload + packet_size, &record_size, sizeof(record_size));
+		if (request->size > 0) memcpy(payload + packet_size + RUDP_BATCH_RECORD_HEADER_SIZE, request->data, request->size);
+		packet_size += (RUDP_BATCH_RECORD_HEADER_SIZE + (uint32_t)request->size);
+
+		request->last_seq_num = m_txNextSeqNum;
+		request->packetized = true;
+	}
+
+	memset(slot.packet.data(), 0, sizeof(RUDP_header));
+
+	RUDP_header *header = (RUDP_header *)slot.packet.data();
+	header->flags = (RUDP_FLAG_PSH | RUDP_FLAG_LAST | RUDP_FLAG_BATCH);
+	header->length = htons(packet_size);
+	header->seq_num = htonl(m_txNextSeqNum);
+	header->msg_id = htonl(msg_id);
+	_engine_fill_ack(header, true);
+	phase = _phase_end(RUDP_PHASE_PACKETIZE, phase);
+	header->checksum = htons(RUDP_Socket_p::_calculate_checksum(slot.packet.data(), sizeof(RUDP_header) + packet_size));
+	_phase_end(RUDP_PHASE_CHECKSUM, phase);
+
+	slot.size = sizeof(RUDP_header) + packet_size;
+	slot.tries = 0;
+	slot.fast_retransmitted = false;
+	slot.request = request;
+	slot.end_offset = request->size;
+	m_txBytesInFlight += slot.size;
+	m_txNextSeqNum++;
+}
+
+void RUDP_Socket_p::_engine_build_packet() {
+	uint64_t phase = _phase_start();
+	RUDP_tx_slot &slot = m_txSlots[m_txNextSeqNum % m_txWindowSize];
+	uint32_t packet_size = (uint32_t)std::min(m_txRequest->size - m_txOffset, (uint64_t)(m_pathMTU - sizeof(RUDP_header)));
+	bool last = (m_txOffset + packet_size == m_txRequest->size);
+
+	memset(slot.packet.data(), 0, sizeof(RUDP_header));
+	memcpy(slot.packet.data() + sizeof(RUDP_header), m_txRequest->data + m_txOffset, packet_size);
+
+	RUDP_header *header = (RUDP_header *)slot.packet.data();
+	header->flags = last ? (RUDP_FLAG_PSH | RUDP_FLAG_LAST) : RUDP_FLAG_PSH;
+	header->length = htons(packet_size);
+	header->seq_num = htonl(m_txNextSeqNum);
+	header->msg_id = htonl(m_txRequest->msg_id);
+	header->offset = rudp_byte_order64(m_txOffset);
+	_engine_fill_ack(header, true);
+	phase = _phase_end(RUDP_PHASE_PACKETIZE, phase);
+	header->checksum = htons(RUDP_Socket_p::_calculate_checksum(slot.packet.data(), sizeof(RUDP_header) + packet_size));
+	_phase_end(RUDP_PHASE_CHECKSUM, phase);
+
+	slot.size = sizeof(RUDP_header) + packet_size;
+	slot.tries = 0;
+	slot.fast_retransmitted = false;
+	m_txBytesInFlight += slot.size;
+	m_txOffset += packet_size;
+	slot.request = m_txRequest;
+	slot.end_offset = m_txOffset;
+
+	if (last)
+	{
+		m_txRequest->last_seq_num = m_txNextSeqNum;
+		m_txRequest->packetized = true;
+		m_txRequest = nullptr;
+	}
+
+	m_txNextSeqNum++;
+}
+
+void RUDP_Socket_p::_engine_transmit(uint32_t seq_num) {
+	RUDP_tx_slot &slot = m_txSlots[seq_num % m_txWindowSize];
+
+	if (slot.tries == m_protocolMaximumRetries) throw std::runtime_error("Failed to send the packet with sequence number " + std::to_string(seq_num) + ": maximum number of retries reached (" + std::to_string(m_protocolMaximumRetries) + ").");
+
+	if (slot.tries > 0)
+	{
+		RUDP_LOG_DEBUG("Warning: No ACK for the packet with sequence number {}, retrying to send the packet ({}/{})", seq_num, slot.tries, m_protocolMaximumRetries);
+		m_txRetryPackets++;
+	}
+
+	uint64_t rate = m_maxRate.load(std::memory_order_relaxed);
+	auto departure = std::chrono::steady_clock::now();
+	bool scheduled = false;
+
+	if (m_txTimeEnabled && rate != 0)
+	{
+		// A new packet leaves at its place in the schedule, a retransmission right away, but it still takes its place.
+		auto place = std::max(departure, m_txNextDeparture);
+		m_txNextDeparture = place + std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<double>((double)slot.size / rate));
+
+		scheduled = (slot.tries == 0);
+		if (scheduled) departure = place;
+	}
+
+	uint64_t phase = _phase_start();
+	int bytes_sent = scheduled ? rudp_send_at(m_socketHandle, slot.packet.data(), slot.size, departure) : ::send(m_socketHandle, (char *)slot.packet.data(), slot.size, 0);
+
+	if (bytes_sent == SOCKET_ERROR && rudp_is_message_too_long() && !m_txFragmenting && !m_probePacket.empty())
+	{
+		// The kernel learned of a smaller link on the path (ICMP), so use smaller packets from now on, and let this one through fragmented.
+		_engine_lower_path_mtu(slot.size);
+		_engine_allow_fragments();
+
+		if (m_txFragmenting) bytes_sent = scheduled ? rudp_send_at(m_socketHandle, slot.packet.data(), slot.size, departure) : ::send(m_socketHandle, (char *)slot.packet.data(), slot.size, 0);
+	}
+
+	_phase_end((slot.tries > 0) ? RUDP_PHASE_RETRANSMIT : RUDP_PHASE_SEND, phase);
+	_flight_record(RUDP_FLIGHT_RECORDER_SENT, slot.packet.data(), bytes_sent);
+
+	// A full socket buffer is handled like a lost packet, the retransmission timer takes care of it.
+	if (bytes_sent == SOCKET_ERROR && !rudp_is_transient_error()) _print_socket_error("Failed to send a packet", true);
+
+	m_txActualBytes += (bytes_sent == SOCKET_ERROR ? 0 : bytes_sent);
+	m_txActualPackets++;
+	if (rate != 0 && !m_txTimeEnabled) m_txPaceTokens -= slot.size;
+
+	if (slot.tries > 0) _engine_trace(RUDP_TRACE_PACKET_RETRANSMITTED, RUDP_TRACE_REASON_NONE, seq_num, (uint16_t)slot.size, slot.tries);
+	else _engine_trace(RUDP_TRACE_PACKET_SENT, RUDP_TRACE_REASON_NONE, seq_num, (uint16_t)slot.size, m_txBytesInFlight);
+
+	slot.tries++;
+
+	// The retransmission timer starts once the packet actually leaves.
+	slot.sent_at = std::max(departure, std::chrono::steady_clock::now());
+	if (slot.tries == 1) slot.first_sent_at = slot.sent_at;
+}
+
+void RUDP_Socket_p::_engine_complete_request(RUDP_send_request *request, int state, const std::string &error) {
+	if (request->detached)
+	{
+		if (state == RUDP_REQUEST_FAILED) RUDP_LOG_DEBUG("Warning: Failed to deliver a message of {} bytes queued by sendAsync(): {}", request->size, error);
+		delete request;
+		return;
+	}
+
+	request->error = error;
+
+	// The sending thread may return (and destroy the request) as soon as the state changes.
+	request->state.store(state, std::memory_order_release);
+
+	{
+		std::lock_guard<std::mutex> lock(m_waitMutex);
+	}
+
+	m_sendCondition.notify_all();
+}
+
+void RUDP_Socket_p::_engine_probe_start(uint16_t low, uint16_t high) {
+	m_probeLow = low;
+	m_probeHigh = high;
+	m_probeSize = 0;
+	m_probeSearching = (high > low);
+
+	if (!m_probeSearching) m_probeNextSearch = std::chrono::steady_clock::now() + std::chrono::seconds(RUDP_PMTU_RAISE_INTERVAL);
+}
+
+void RUDP_Socket_p::_engine_probe() {
+	if (m_probePacket.empty() || m_txFragmenting) return;
+
+	auto now = std::chrono::steady_clock::now();
+
+	if (!m_probeSearching)
+	{
+		if (now < m_probeNextSearch) return;
+		_engine_probe_start(m_pathMTU, _engine_probe_max());
+		if (!m_probeSearching) return;
+	}
+
+	if (m_probeSize != 0)
+	{
+		if (now < m_probeSentAt + std::chrono::milliseconds(m_protocolTimeout)) return;
+		if (m_probeTries == RUDP_PMTU_MAX_PROBES) _engine_probe_failed();
+	}
+
+	if (m_probeSize == 0)
+	{
+		if (m_probeHigh - m_probeLow < RUDP_PMTU_SEARCH_GRANULARITY)
+		{
+			RUDP_LOG_DEBUG("Path MTU search complete: {} bytes.", m_pathMTU);
+			m_probeSearching = false;
+			m_probeNextSearch = now + std::chrono::seconds(RUDP_PMTU_RAISE_INTERVAL);
+			return;
+		}
+
+		// Try the largest size first, most paths either carry the negotiated MTU or they don't; then search between the bounds.
+		m_probeSize = (m_probeHigh == _engine_probe_max()) ? m_probeHigh : (uint16_t)(m_probeLow + (m_probeHigh - m_probeLow + 1) / 2);
+		m_probeTries = 0;
+
+		memset(m_probePacket.data(), 0, m_probeSize);
+		RUDP_header *header = (RUDP_header *)m_probePacket.data();
+		header->flags = RUDP_FLAG_PROBE;
+		header->length = htons(m_probeSize - sizeof(RUDP_header));
+		header->seq_num = htonl(++m_probeSeqNum);
+		header->checksum = htons(RUDP_Socket_p::_calculate_checksum(m_probePacket.data(), m_probeSize));
+	}
+
+	int bytes_sent = ::send(m_socketHandle, (char *)m_probePacket.data(), m_probeSize, 0);
+
+	_flight_record(RUDP_FLIGHT_RECORDER_SENT, m_probePacket.data(), bytes_sent);
+
+	if (bytes_sent == SOCKET_ERROR && rudp_is_message_too_long())
+	{
+		// The kernel already knows the probe won't fit, no need to wait for the timeout.
+		_engine_probe_failed();
+		return;
+	}
+
+	if (bytes_sent == SOCKET_ERROR && !rudp_is_transient_error()) _print_socket_error("Failed to send a probe packet", true);
+
+	m_probeTries++;
+	m_probeSentAt = now;
+}
+
+void RUDP_Socket_p::_engine_handle_probe_ack(RUDP_header *header) {
+	if (m_probeSize == 0 || ntohl(header->seq_num) != m_probeSeqNum) return;
+
+	m_probeLow = m_probeSize;
+	m_probeSize = 0;
+
+	if (m_probeLow > m_pathMTU)
+	{
+		m_pathMTU = m_probeLow;
+		_engine_trace(RUDP_TRACE_PATH_MTU_UPDATED, RUDP_TRACE_REASON_NONE, 0, 0, m_probeLow);
+		RUDP_LOG_DEBUG("Path MTU raised to {} bytes.", m_probeLow);
+	}
+}
+
+void RUDP_Socket_p::_engine_probe_failed() {
+	RUDP_LOG_DEBUG("Path MTU probe of {} bytes failed.", m_probeSize);
+	m_probeHigh = m_probeSize - 1;
+	m_probeSize = 0;
+}
+
+void RUDP_Socket_p::_engine_lower_path_mtu(uint16_t failed_size) {
+	uint16_t base = std::min<uint16_t>(RUDP_PMTU_BASE, std::min(m_protocolMTU, m_peersMTU.load()));
+
+	if (m_pathMTU <= base || failed_size <= base) return;
+
+	RUDP_LOG_DEBUG("Warning: Packets of {} bytes don't get through, lowering the path MTU from {} to {} bytes and searching again.", failed_size, m_pathMTU, base);
+
+	m_pathMTU = base;
+	_engine_trace(RUDP_TRACE_PATH_MTU_UPDATED, RUDP_TRACE_REASON_NONE, 0, 0, base);
+	_engine_probe_start(base, failed_size - 1);
+
+	for (uint32_t seq_num = m_txUnackedSeqNum; seq_num != m_txNextSeqNum; seq_num++)
+	{
+		if (m_txSlots[seq_num % m_txWindowSize].size > base)
+		{
+			_engine_allow_fragments();
+			break;
+		}
+	}
+}
+
+void RUDP_Socket_p::_engine_allow_fragments() {
+	// The same packets may hit this again (a retransmission), but the bit is turned off once per MTU change only.
+	m_txFragmentUntil = m_txNextSeqNum;
+	if (m_txFragmenting) return;
+
+	RUDP_LOG_DEBUG("Letting the packets up to {} through fragmented, they were built for a larger path MTU.", m_txNextSeqNum - 1);
+	m_txFragmenting = _set_dont_fragment(m_socketHandle, false);
+}
+
+void RUDP_Socket_p::_engine_use_own_mtu() {
+	// The peer sized its socket buffer for the negotiated MTU, so the budget follows it as in _engine_start().
+	m_txBytesBudget = (uint64_t)m_txWindowSize * m_protocolMTU;
+
+	if (m_probePacket.empty())
+	{
+		m_pathMTU = m_protocolMTU;
+		_engine_trace(RUDP_TRACE_PATH_MTU_UPDATED, RUDP_TRACE_REASON_NONE, 0, 0, m_protocolMTU);
+		RUDP_LOG_DEBUG("Path MTU raised to {} bytes.", m_protocolMTU);
+		return;
+	}
+
+	// The path may not carry our MTU, so search up to it; this also drops an outstanding probe sized for the old cap.
+	RUDP_LOG_DEBUG("Searching for a path MTU up to our own MTU of {} bytes.", _engine_probe_max());
+	_engine_probe_start(m_pathMTU, _engine_probe_max());
+}
+
+void RUDP_Socket_p::_engine_report_progress(bool sending, uint64_t bytes_done, uint64_t bytes_total) {
+	RUDP_progress_callback callback;
+	void *user_data;
+
+	{
+		std::lock_guard<std::mutex> lock(m_progressMutex);
+		callback = m_progressCallback;
+		user_data = m_progressUserData;
+	}
+
+	if (callback != nullptr) callback(sending, bytes_done, bytes_total, user_data);
+}
+
+void RUDP_Socket_p::_engine_deliver() {
+	uint64_t phase = m_rxBacklog.empty() ? 0 : _phase_start();
+	bool delivered = false;
+
+	while (!m_rxBacklog.empty() && m_recvQueue.push(m_rxBacklog.front()))
+	{
+		m_rxBacklog.pop_front();
+		m_rxMessages++;
+		delivered = true;
+	}
+
+	m_rxBacklogged.store(!m_rxBacklog.empty(), std::memory_order_release);
+
+	if (!delivered) return;
+
+	{
+		std::lock_guard<std::mutex> lock(m_waitMutex);
+	}
+
+	m_recvCondition.notify_all();
+	_phase_end(RUDP_PHASE_REASSEMBLY, phase);
+}
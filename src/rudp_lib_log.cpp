@@ -0,0 +1,168 @@
+/*
+ *  Reliable UDP implementation
+ *  Copyright (C) 2024  Roy Simanovich
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include "include/RUDP_Log.hpp"
+
+/*
+ * @brief The most bytes the logger thread formats before it writes them.
+ */
+#define RUDP_LOG_WRITE_SIZE 65536
+
+RUDP_Logger &RUDP_Logger::instance() {
+	// Never destroyed, so messages logged while the process exits (by static destructors, for example) are still safe.
+	static RUDP_Logger *logger = []() {
+		RUDP_Logger *created = new RUDP_Logger();
+		std::atexit([]() { RUDP_Logger::instance().flush(); });
+		return created;
+	}();
+
+	return *logger;
+}
+
+RUDP_Logger::RUDP_Logger() {
+	m_thread = std::thread(&RUDP_Logger::_run, this);
+	m_thread.detach();
+}
+
+void RUDP_Logger::_run() {
+	RUDP_Log_Record record;
+	std::string out, err;
+
+	while (true)
+	{
+		uint64_t written = 0;
+
+		while ((out.size() + err.size()) < RUDP_LOG_WRITE_SIZE && m_queue.pop(record))
+		{
+			_format(record, (record.level == RUDP_LOG_LEVEL_INFO) ? out : err);
+			written++;
+		}
+
+		uint64_t dropped = m_dropped.exchange(0, std::memory_order_relaxed);
+
+		if (dropped != 0)
+			err += "Warning: " + std::to_string(dropped) + " log messages were dropped, the log queue was full.\n";
+
+		if (!out.empty())
+		{
+			fwrite(out.data(), 1, out.size(), stdout);
+			fflush(stdout);
+			out.clear();
+		}
+
+		if (!err.empty())
+		{
+			fwrite(err.data(), 1, err.size(), stderr);
+			fflush(stderr);
+			err.clear();
+		}
+
+		if (written != 0)
+		{
+			m_written.fetch_add(written, std::memory_order_release);
+
+			// Taking the lock makes sure flush() either sees the new count or already waits for the notification.
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+			}
+
+			m_writtenCondition.notify_all();
+			continue;
+		}
+
+		// Nothing to write, sleep until a message is logged. The fence pairs with the one in log(), so either the
+		// logging thread sees m_sleeping and wakes this thread up, or this thread sees its message in the queue.
+		m_sleeping.store(true, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+
+		if (!m_queue.empty())
+		{
+			m_sleeping.store(false, std::memory_order_relaxed);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_wakeCondition.wait_for(lock, std::chrono::milliseconds(100), [this]() { return !m_sleeping.load(std::memory_order_relaxed); });
+		m_sleeping.store(false, std::memory_order_relaxed);
+	}
+}
+
+void RUDP_Logger::_format(const RUDP_Log_Record &record, std::string &out) {
+	char number[32];
+	uint8_t next_arg = 0;
+
+	for (const char *current = record.format; *current != '\0'; current++)
+	{
+		const char *end = (*current == '{') ? strchr(current, '}') : nullptr;
+
+		if (end == nullptr || next_arg >= record.arg_count)
+		{
+			out += *current;
+			continue;
+		}
+
+		bool hex = (strncmp(current, "{:#x}", 5) == 0);
+		uint8_t index = next_arg++;
+
+		switch (record.arg_types[index])
+		{
+			case RUDP_Log_Record::ARG_SIGNED:
+				snprintf(number, sizeof(number), hex ? "%#llx" : "%lld", (long long)record.args[index].i);
+				out += number;
+				break;
+
+			case RUDP_Log_Record::ARG_UNSIGNED:
+				snprintf(number, sizeof(number), hex ? "%#llx" : "%llu", (unsigned long long)record.args[index].u);
+				out += number;
+				break;
+
+			case RUDP_Log_Record::ARG_DOUBLE:
+				snprintf(number, sizeof(number), "%g", record.args[index].d);
+				out += number;
+				break;
+
+			case RUDP_Log_Record::ARG_POINTER:
+				snprintf(number, sizeof(number), "%#llx", (unsigned long long)record.args[index].u);
+				out += number;
+				break;
+
+			case RUDP_Log_Record::ARG_TEXT:
+				out.append(record.text + record.args[index].text.offset, record.args[index].text.length);
+				break;
+		}
+
+		current = end;
+	}
+
+	out += '\n';
+}
+
+void RUDP_Logger::flush() {
+	uint64_t pushed = m_pushed.load(std::memory_order_acquire);
+
+	if (m_sleeping.exchange(false))
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_wakeCondition.notify_one();
+	}
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_writtenCondition.wait_for(lock, std::chrono::seconds(1), [this, pushed]() { return m_written.load(std::memory_order_acquire) >= pushed; });
+}
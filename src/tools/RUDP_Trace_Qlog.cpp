@@ -0,0 +1,240 @@
+/*
+ *  Reliable UDP implementation
+ *  Copyright (C) 2024  Roy Simanovich
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation, either version 3 of the License, or
+ *  (at your option) any later version.
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Trace to qlog converter.
+ *
+ * Reads a trace file, the RUDP_trace_event records returned by readTrace() written back to back,
+ * and writes it as a qlog (JSON) file, which tools like qvis can show. Every connection in the
+ * trace (from RUDP_TRACE_CONNECTED to RUDP_TRACE_CLOSED) becomes a trace of its own, with the
+ * times relative to its start. RUDP specific events use the "rudp" category.
+ */
+
+#include "include/RUDP_API.hpp"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <vector>
+#include <map>
+#include <cstring>
+
+/*
+ * @brief Gets the qlog name of a loss reason.
+ * @param reason The reason, see RUDP_trace_reason.
+ * @return The trigger of the qlog packet_lost event.
+ */
+static const char *loss_trigger(uint8_t reason)
+{
+	switch (reason)
+	{
+		case RUDP_TRACE_REASON_TIMEOUT:
+			return "pto_expired";
+
+		case RUDP_TRACE_REASON_DUP_ACKS:
+			return "reordering_threshold";
+
+		case RUDP_TRACE_REASON_NAK:
+			return "nak";
+
+		default:
+			return "unknown";
+	}
+}
+
+/*
+ * @brief Writes an event in qlog form, some events are written as two qlog events.
+ * @param out Where to write.
+ * @param event The event.
+ * @param time The time of the event, in milliseconds since the connection started.
+ * @param lost_reasons The reason each lost packet was taken as lost, to tell why it was retransmitted.
+ * @return False if the event isn't known.
+ */
+static bool write_event(std::ostream &out, const RUDP_trace_event &event, double time, std::map<uint32_t, uint8_t> &lost_reasons)
+{
+	out << "{\"time\": " << time << ", ";
+
+	switch (event.type)
+	{
+		case RUDP_TRACE_CONNECTED:
+			out << "\"name\": \"connectivity:connection_started\", \"data\": {\"path_mtu\": " << event.size << ", \"window_size\": " << event.value << "}";
+			break;
+
+		case RUDP_TRACE_CLOSED:
+			out << "\"name\": \"connectivity:connection_closed\", \"data\": {\"trigger\": \"" << (event.reason == RUDP_TRACE_REASON_ERROR ? "error" : "clean") << "\"}";
+			break;
+
+		case RUDP_TRACE_PACKET_SENT:
+			out << "\"name\": \"transport:packet_sent\", \"data\": {\"header\": {\"packet_type\": \"data\", \"packet_number\": " << event.seq_num << "}, \"raw\": {\"length\": " << event.size << "}}},\n";
+			out << "\t\t\t\t{\"time\": " << time << ", \"name\": \"recovery:metrics_updated\", \"data\": {\"bytes_in_flight\": " << event.value << "}";
+			break;
+
+		case RUDP_TRACE_PACKET_RETRANSMITTED:
+		{
+			auto lost = lost_reasons.find(event.seq_num);
+			const char *trigger = (lost != lost_reasons.end() && lost->second == RUDP_TRACE_REASON_TIMEOUT) ? "retransmit_timeout" : "retransmit_reordered";
+
+			if (lost != lost_reasons.end()) lost_reasons.erase(lost);
+
+			out << "\"name\": \"transport:packet_sent\", \"data\": {\"header\": {\"packet_type\": \"data\", \"packet_number\": " << event.seq_num << "}, \"raw\": {\"length\": " << event.size << "}, \"trigger\": \"" << trigger << "\", \"times_sent\": " << event.value << "}";
+			break;
+		}
+
+		case RUDP_TRACE_PACKET_RECEIVED:
+			if (event.reason == RUDP_TRACE_REASON_BEYOND_WINDOW)
+			{
+				out << "\"name\": \"transport:packet_dropped\", \"data\": {\"header\": {\"packet_type\": \"data\", \"packet_number\": " << event.seq_num << "}, \"raw\": {\"length\": " << event.size << "}, \"trigger\": \"beyond_window\"}";
+				break;
+			}
+
+			out << "\"name\": \"transport:packet_received\", \"data\": {\"header\": {\"packet_type\": \"data\", \"packet_number\": " << event.seq_num << "}, \"raw\": {\"length\": " << event.size << "}";
+			if (event.reason == RUDP_TRACE_REASON_OUT_OF_ORDER) out << ", \"out_of_order\": true";
+			if (event.reason == RUDP_TRACE_REASON_DUPLICATE) out << ", \"duplicate\": true";
+			out << "}";
+			break;
+
+		case RUDP_TRACE_PACKET_DROPPED:
+			out << "\"name\": \"transport:packet_dropped\", \"data\": {\"raw\": {\"length\": " << event.size << "}, \"trigger\": \"invalid_checksum\"}";
+			break;
+
+		case RUDP_TRACE_PACKET_ACKED:
+			out << "\"name\": \"transport:packets_acked\", \"data\": {\"acked_ranges\": [[" << (event.seq_num - event.size + 1) << ", " << event.seq_num << "]]}},\n";
+			out << "\t\t\t\t{\"time\": " << time << ", \"name\": \"recovery:metrics_updated\", \"data\": {\"bytes_in_flight\": " << event.value << "}";
+			break;
+
+		case RUDP_TRACE_PACKET_LOST:
+			lost_reasons[event.seq_num] = event.reason;
+			out << "\"name\": \"recovery:packet_lost\", \"data\": {\"header\": {\"packet_type\": \"data\", \"packet_number\": " << event.seq_num << "}, \"trigger\": \"" << loss_trigger(event.reason) << "\"}";
+			break;
+
+		case RUDP_TRACE_ACK_SENT:
+			out << "\"name\": \"rudp:ack_sent\", \"data\": {\"ack_seq_num\": " << event.seq_num << ", \"window\": " << event.value << "}";
+			break;
+
+		case RUDP_TRACE_NAK_SENT:
+			out << "\"name\": \"rudp:nak_sent\", \"data\": {\"first\": " << event.seq_num << ", \"last\": " << event.value << "}";
+			break;
+
+		case RUDP_TRACE_TIMER_FIRED:
+			out << "\"name\": \"recovery:loss_timer_updated\", \"data\": {\"event_type\": \"expired\", \"timer_type\": \"" << (event.reason == RUDP_TRACE_REASON_PERSIST ? "persist" : "pto") << "\"}";
+			break;
+
+		case RUDP_TRACE_WINDOW_UPDATED:
+			out << "\"name\": \"rudp:peer_window_updated\", \"data\": {\"bytes\": " << event.value << "}";
+			break;
+
+		case RUDP_TRACE_PATH_MTU_UPDATED:
+			out << "\"name\": \"transport:mtu_updated\", \"data\": {\"new\": " << event.value << "}";
+			break;
+
+		case RUDP_TRACE_EVENTS_LOST:
+			out << "\"name\": \"rudp:events_lost\", \"data\": {\"count\": " << event.value << "}";
+			break;
+
+		default:
+			return false;
+	}
+
+	out << "}";
+
+	return true;
+}
+
+int main(int argc, char **argv)
+{
+	if (argc < 2 || argc > 3)
+	{
+		std::cerr << "Usage: " << *argv << " <TRACE FILE> [<QLOG FILE>]" << std::endl;
+		std::cerr << "Writes the qlog to the standard output if no qlog file is given." << std::endl;
+		return 1;
+	}
+
+	std::ifstream input(argv[1], std::ios::binary);
+
+	if (!input)
+	{
+		std::cerr << "Failed to open " << argv[1] << ": " << strerror(errno) << std::endl;
+		return 1;
+	}
+
+	std::vector<RUDP_trace_event> events;
+	RUDP_trace_event event;
+
+	while (input.read((char *)&event, sizeof(event))) events.push_back(event);
+
+	if (input.gcount() != 0) std::cerr << "Warning: Ignoring " << input.gcount() << " bytes at the end of the trace file, it isn't a whole event." << std::endl;
+
+	std::ofstream file;
+
+	if (argc == 3)
+	{
+		file.open(argv[2]);
+
+		if (!file)
+		{
+			std::cerr << "Failed to open " << argv[2] << ": " << strerror(errno) << std::endl;
+			return 1;
+		}
+	}
+
+	std::ostream &out = (argc == 3) ? file : std::cout;
+	std::map<uint32_t, uint8_t> lost_reasons;
+	uint64_t reference_us = events.empty() ? 0 : events.front().time_us;
+	size_t traces = 0, unknown = 0;
+	bool first_event = true;
+
+	out << std::fixed << std::setprecision(3);
+	out << "{\n\t\"qlog_version\": \"0.3\",\n\t\"qlog_format\": \"JSON\",\n\t\"title\": \"RUDP trace\",\n\t\"traces\": [";
+
+	for (const auto &current : events)
+	{
+		// Every connection starts a trace of its own, events before the first one get a trace too.
+		if (current.type == RUDP_TRACE_CONNECTED || traces == 0)
+		{
+			if (traces != 0) out << "\n\t\t\t]\n\t\t},";
+
+			reference_us = current.time_us;
+			lost_reasons.clear();
+			first_event = true;
+
+			out << "\n\t\t{\n\t\t\t\"title\": \"Connection " << traces++ << "\",\n";
+			out << "\t\t\t\"vantage_point\": {\"type\": \"unknown\"},\n";
+			out << "\t\t\t\"common_fields\": {\"time_format\": \"relative\", \"reference_time\": " << (double)reference_us / 1000.0 << "},\n";
+			out << "\t\t\t\"events\": [";
+		}
+
+		std::ostringstream text;
+		text << std::fixed << std::setprecision(3);
+
+		if (!write_event(text, current, (double)(int64_t)(current.time_us - reference_us) / 1000.0, lost_reasons))
+		{
+			unknown++;
+			continue;
+		}
+
+		out << (first_event ? "\n" : ",\n") << "\t\t\t\t" << text.str();
+		first_event = false;
+	}
+
+	if (traces != 0) out << "\n\t\t\t]\n\t\t}\n\t";
+	out << "]\n}\n";
+
+	if (unknown != 0) std::cerr << "Warning: Skipped " << unknown << " events of unknown types." << std::endl;
+	if (argc == 3) std::cerr << "Converted " << events.size() << " events of " << traces << " connections to " << argv[2] << "." << std::endl;
+
+	return 0;
+}
@@ -0,0 +1,164 @@
+--[[
+	Reliable UDP implementation
+	Copyright (C) 2024  Roy Simanovich
+
+	This program is free software: you can redistribute it and/or modify
+	it under the terms of the GNU General Public License as published by
+	the Free Software Foundation, either version 3 of the License, or
+	(at your option) any later version.
+	This program is distributed in the hope that it will be useful,
+	but WITHOUT ANY WARRANTY; without even the implied warranty of
+	MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+	GNU General Public License for more details.
+
+	You should have received a copy of the GNU General Public License
+	along with this program.  If not, see <https://www.gnu.org/licenses/>.
+]]
+
+--[[
+	Wireshark dissector for RUDP.
+
+	Dissects the flight recorder dumps (pcap files of link type USER0, written by dumpFlightRecorder()),
+	and RUDP over UDP in any capture, with "Decode As..." on the UDP port.
+
+	Install it by copying it into the Wireshark personal plugins folder (Help > About Wireshark > Folders),
+	or load it for one run: wireshark -X lua_script:RUDP_Wireshark.lua rudp.pcap
+]]
+
+local rudp = Proto("rudp", "Reliable UDP")
+local rudp_fr = Proto("rudp_fr", "RUDP Flight Recorder")
+
+-- The flags of the RUDP header, RUDP_FLAG_* in RUDP_API_wrap.hpp.
+local flag_names = {
+	[0x01] = "SYN", [0x02] = "ACK", [0x04] = "PSH", [0x08] = "LAST",
+	[0x10] = "FIN", [0x20] = "PROBE", [0x40] = "BATCH", [0x80] = "NAK"
+}
+
+local fields = {
+	seq_num = ProtoField.uint32("rudp.seq", "Sequence number"),
+	msg_id = ProtoField.uint32("rudp.msg_id", "Message ID"),
+	offset = ProtoField.uint64("rudp.offset", "Offset"),
+	ack_seq_num = ProtoField.uint32("rudp.ack", "Acknowledgement number"),
+	sack = ProtoField.uint32("rudp.sack", "Selective acknowledgement hint", base.HEX),
+	length = ProtoField.uint16("rudp.length", "Length"),
+	checksum = ProtoField.uint16("rudp.checksum", "Checksum", base.HEX),
+	flags = ProtoField.uint8("rudp.flags", "Flags", base.HEX),
+	flag_syn = ProtoField.bool("rudp.flags.syn", "SYN", 8, nil, 0x01),
+	flag_ack = ProtoField.bool("rudp.flags.ack", "ACK", 8, nil, 0x02),
+	flag_psh = ProtoField.bool("rudp.flags.psh", "PSH", 8, nil, 0x04),
+	flag_last = ProtoField.bool("rudp.flags.last", "LAST", 8, nil, 0x08),
+	flag_fin = ProtoField.bool("rudp.flags.fin", "FIN", 8, nil, 0x10),
+	flag_probe = ProtoField.bool("rudp.flags.probe", "PROBE", 8, nil, 0x20),
+	flag_batch = ProtoField.bool("rudp.flags.batch", "BATCH", 8, nil, 0x40),
+	flag_nak = ProtoField.bool("rudp.flags.nak", "NAK", 8, nil, 0x80),
+	reserved = ProtoField.uint8("rudp.reserved", "Reserved", base.HEX),
+	window = ProtoField.uint16("rudp.window", "Receive window"),
+	nak_first = ProtoField.uint32("rudp.nak.first", "First missing packet"),
+	nak_last = ProtoField.uint32("rudp.nak.last", "Last missing packet"),
+	payload = ProtoField.bytes("rudp.payload", "Payload")
+}
+
+rudp.fields = {
+	fields.seq_num, fields.msg_id, fields.offset, fields.ack_seq_num, fields.sack, fields.length, fields.checksum,
+	fields.flags, fields.flag_syn, fields.flag_ack, fields.flag_psh, fields.flag_last, fields.flag_fin, fields.flag_probe,
+	fields.flag_batch, fields.flag_nak, fields.reserved, fields.window, fields.nak_first, fields.nak_last, fields.payload
+}
+
+local fr_fields = {
+	direction = ProtoField.uint8("rudp_fr.direction", "Direction", base.DEC, { [0] = "Received", [1] = "Sent" }),
+	reserved = ProtoField.bytes("rudp_fr.reserved", "Reserved")
+}
+
+rudp_fr.fields = { fr_fields.direction, fr_fields.reserved }
+
+-- The RUDP header is 32 bytes, in network byte order (struct RUDP_header in RUDP_API_wrap.hpp).
+local RUDP_HEADER_SIZE = 32
+
+local function flag_string(flags)
+	local names = {}
+
+	for bit = 0, 7 do
+		local mask = 2 ^ bit
+
+		if math.floor(flags / mask) % 2 == 1 then table.insert(names, flag_names[mask]) end
+	end
+
+	return table.concat(names, ", ")
+end
+
+function rudp.dissector(buffer, pinfo, tree)
+	if buffer:len() < RUDP_HEADER_SIZE then return 0 end
+
+	pinfo.cols.protocol = "RUDP"
+
+	local flags = buffer(28, 1):uint()
+	local subtree = tree:add(rudp, buffer(), "Reliable UDP, Seq: " .. buffer(0, 4):uint() .. " [" .. flag_string(flags) .. "]")
+
+	subtree:add(fields.seq_num, buffer(0, 4))
+	subtree:add(fields.msg_id, buffer(4, 4))
+	subtree:add(fields.offset, buffer(8, 8))
+	subtree:add(fields.ack_seq_num, buffer(16, 4))
+	subtree:add(fields.sack, buffer(20, 4))
+	subtree:add(fields.length, buffer(24, 2))
+	subtree:add(fields.checksum, buffer(26, 2))
+
+	local flags_tree = subtree:add(fields.flags, buffer(28, 1))
+
+	flags_tree:append_text(" (" .. flag_string(flags) .. ")")
+
+	for _, field in ipairs({ fields.flag_syn, fields.flag_ack, fields.flag_psh, fields.flag_last, fields.flag_fin, fields.flag_probe, fields.flag_batch, fields.flag_nak }) do
+		flags_tree:add(field, buffer(28, 1))
+	end
+
+	subtree:add(fields.reserved, buffer(29, 1))
+	subtree:add(fields.window, buffer(30, 2))
+
+	local info = "Seq=" .. buffer(0, 4):uint() .. " [" .. flag_string(flags) .. "]"
+
+	if math.floor(flags / 0x02) % 2 == 1 then info = info .. " Ack=" .. buffer(16, 4):uint() .. " Win=" .. buffer(30, 2):uint() end
+	if math.floor(flags / 0x04) % 2 == 1 then info = info .. " Msg=" .. buffer(4, 4):uint() .. " Off=" .. buffer(8, 8):uint64():tonumber() end
+
+	info = info .. " Len=" .. buffer(24, 2):uint()
+
+	-- A NAK lists the ranges of packets to resend, the flight recorder keeps only the header.
+	if flags >= 0x80 then
+		local at = RUDP_HEADER_SIZE
+
+		while at + 8 <= buffer:len() do
+			subtree:add(fields.nak_first, buffer(at, 4))
+			subtree:add(fields.nak_last, buffer(at + 4, 4))
+			info = info .. " Missing=" .. buffer(at, 4):uint() .. "-" .. buffer(at + 4, 4):uint()
+			at = at + 8
+		end
+	elseif buffer:len() > RUDP_HEADER_SIZE then
+		subtree:add(fields.payload, buffer(RUDP_HEADER_SIZE))
+	end
+
+	pinfo.cols.info = info
+
+	return buffer:len()
+end
+
+function rudp_fr.dissector(buffer, pinfo, tree)
+	if buffer:len() < 4 then return 0 end
+
+	local direction = buffer(0, 1):uint()
+	local subtree = tree:add(rudp_fr, buffer(0, 4), "RUDP Flight Recorder, " .. (direction == 1 and "Sent" or "Received"))
+
+	subtree:add(fr_fields.direction, buffer(0, 1))
+	subtree:add(fr_fields.reserved, buffer(1, 3))
+
+	pinfo.p2p_dir = (direction == 1) and P2P_DIR_SENT or P2P_DIR_RECV
+	pinfo.cols.src = (direction == 1) and "local" or "peer"
+	pinfo.cols.dst = (direction == 1) and "peer" or "local"
+
+	rudp.dissector(buffer(4):tvb(), pinfo, tree)
+
+	return buffer:len()
+end
+
+-- The flight recorder dumps use LINKTYPE_USER0 (147), which Wireshark calls WTAP_ENCAP_USER0.
+local user0 = (wtap_encaps ~= nil) and wtap_encaps.USER0 or wtap.USER0
+
+DissectorTable.get("wtap_encap"):add(user0, rudp_fr)
+DissectorTable.get("udp.port"):add_for_decode_as(rudp)